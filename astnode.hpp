@@ -13,8 +13,8 @@
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Type.h"
-#include "llvm/IR/Verifier.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/TimeProfiler.h"
 #include "llvm/TargetParser/Host.h"
 #include "llvm/MC/TargetRegistry.h"
 #include "llvm/Support/TargetSelect.h"
@@ -25,29 +25,76 @@
 #include <cstdlib>
 #include <string>
 #include <map>
+#include <set>
 #include <vector>
 #include <iostream>
 
+#include "debuginfo.hpp"
+#include "fastmath.hpp"
+#include "multiversion.hpp"
+#include "pgo.hpp"
 #include "token.hpp"
 
 using namespace llvm;
 
-// AST node base class
+// what the code of a function does, collected for attribute inference
+// (see attributes.hpp)
+struct Effects
+{
+    std::set<std::string> Calls, Reads, Writes; // functions called, and variables read and written that aren't local
+    bool Loops = false;
+    std::vector<std::set<std::string>> Locals; // parameters and locals in scope, innermost last
+
+    bool isLocal(const std::string &Name) const
+    {
+        for (auto &Scope : Locals)
+        {
+            if (Scope.count(Name))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+// "[[cold, noinline]] ", or "" for no attributes
+static std::string attributesToString(const std::vector<std::string> &Attrs)
+{
+    std::string out;
+    for (auto &a : Attrs)
+    {
+        out += (out.empty() ? "[[" : ", ") + a;
+    }
+    return out.empty() ? out : out + "]] ";
+}
+
+// __likely(c), __unlikely(c), __assume(c) and __unreachable() look like calls
+// but are hints to the optimiser, generated in place and never declared
+static bool isBuiltin(const std::string &Name)
+{
+    return Name == "__likely" || Name == "__unlikely" || Name == "__assume" || Name == "__unreachable";
+}
+
+// AST node base class, every node class also has a static Kind, its name
 class ASTnode
 {
 public:
     virtual ~ASTnode(){};
     virtual llvm::Value *codegen() = 0;
     virtual std::string to_string() const;
-    virtual std::string to_tree(std::string prefix, bool end) const = 0;
+    // appends the tree below this node to out, rather than returning it, so
+    // printing a deep tree does not copy every subtree on the way up
+    virtual void to_tree(std::string &out, const std::string &prefix, bool end) const = 0;
+    // collect names of called functions and referenced variables in this subtree
+    virtual void collectDeps(std::set<std::string> &Calls, std::set<std::string> &Vars) const {};
+    virtual void collectEffects(Effects &E) const {};
+    virtual bool isFunction() const { return false; }
+    virtual bool isExtern() const { return false; }
 };
 
-// global variables
-static LLVMContext TheContext;
-static IRBuilder<> Builder(TheContext);
-static std::unique_ptr<Module> TheModule;
-static std::vector<std::map<std::string, AllocaInst *>> NamedValues; // local var tables, cleared at end of blocks
-static std::map<std::string, GlobalVariable *> GlobalNamedValues;    // global var table
+// codegen state (TheContext, Builder, TheModule, NamedValues,
+// GlobalNamedValues) lives in CompilerState, see compiler.hpp
 
 // helper codegen functions
 AllocaInst *CreateEntryBlockAlloca(Function *TheFunction, const std::string &VarName, Type *type);
@@ -56,27 +103,54 @@ Type *getWidestType(Type *type1, Type *type2);
 std::string typeToString(Type *type);
 Type *getLLVMType(std::string Val);
 
+// textual signature of a top-level function, extern or global variable
+// used to re-declare it in modules other than the one that defines it
+struct Prototype
+{
+    std::string Name;
+    std::string Type; // return type for functions, variable type for globals
+    std::vector<std::string> ParamTypes;
+    std::vector<std::string> ParamNames;
+    bool IsFunction = true;
+
+    std::string to_string() const
+    {
+        if (!IsFunction)
+        {
+            return Type + " " + Name;
+        }
+        std::string out = Type + " " + Name + "(";
+        for (unsigned i = 0; i < ParamTypes.size(); i++)
+        {
+            out += (i ? "," : "") + ParamTypes[i];
+        }
+        return out + ")";
+    }
+};
+Value *declarePrototype(const Prototype &P);
+
 // lazy operations
-Value *lazyAnd(std::unique_ptr<ASTnode> LHS, std::unique_ptr<ASTnode> RHS, TOKEN tok);
-Value *lazyOr(std::unique_ptr<ASTnode> LHS, std::unique_ptr<ASTnode> RHS, TOKEN tok);
+Value *lazyAnd(ASTnode &LHS, ASTnode &RHS, TOKEN tok);
+Value *lazyOr(ASTnode &LHS, ASTnode &RHS, TOKEN tok);
 
 // Generate LHS, if false, immediately jump to end and return false, otherwise generate RHS, and return true if RHS is true
 // It's lazy because there is NO LEFT RECURSION so only RHS would be "nested" in this case
-Value *lazyAnd(std::unique_ptr<ASTnode> LHS, std::unique_ptr<ASTnode> RHS, TOKEN tok)
+Value *lazyAnd(ASTnode &LHS, ASTnode &RHS, TOKEN tok)
 {
-    Function *TheFunction = Builder.GetInsertBlock()->getParent();
-    BasicBlock *LHSBB = BasicBlock::Create(TheContext, "lhs", TheFunction);
-    BasicBlock *RHSBB = BasicBlock::Create(TheContext, "rhs", TheFunction);
-    BasicBlock *EndBB = BasicBlock::Create(TheContext, "end", TheFunction);
-    BasicBlock *SetFalseBB = BasicBlock::Create(TheContext, "setfalse", TheFunction);
-    BasicBlock *SetTrueBB = BasicBlock::Create(TheContext, "settrue", TheFunction);
+    Function *TheFunction = CS->Builder->GetInsertBlock()->getParent();
+    BasicBlock *LHSBB = BasicBlock::Create(*CS->TheContext, "lhs", TheFunction);
+    BasicBlock *RHSBB = BasicBlock::Create(*CS->TheContext, "rhs", TheFunction);
+    BasicBlock *EndBB = BasicBlock::Create(*CS->TheContext, "end", TheFunction);
+    BasicBlock *SetFalseBB = BasicBlock::Create(*CS->TheContext, "setfalse", TheFunction);
+    BasicBlock *SetTrueBB = BasicBlock::Create(*CS->TheContext, "settrue", TheFunction);
 
     // temp variable to store result of lazy and
-    AllocaInst *temp = CreateEntryBlockAlloca(TheFunction, "andtmp", Type::getInt1Ty(TheContext));
+    AllocaInst *temp = CreateEntryBlockAlloca(TheFunction, "andtmp", Type::getInt1Ty(*CS->TheContext));
 
-    Builder.CreateBr(LHSBB);
-    Builder.SetInsertPoint(LHSBB);
-    Value *L = LHS->codegen();
+    emitLocation(tok);
+    CS->Builder->CreateBr(LHSBB);
+    CS->Builder->SetInsertPoint(LHSBB);
+    Value *L = LHS.codegen();
     if (!L)
     {
         error(tok, "Unexpected error in lazyAnd(): L is nullptr");
@@ -86,12 +160,13 @@ Value *lazyAnd(std::unique_ptr<ASTnode> LHS, std::unique_ptr<ASTnode> RHS, TOKEN
         error(tok, "LHS is void! Cannot perform operation");
     }
     // convert result to bool
-    L = castToType(L, Type::getInt1Ty(TheContext), tok);
+    emitLocation(tok);
+    L = castToType(L, Type::getInt1Ty(*CS->TheContext), tok);
 
     // branch to RHS if L is true, otherwise branch to set temp variable to false and end
-    Builder.CreateCondBr(L, RHSBB, SetFalseBB);
-    Builder.SetInsertPoint(RHSBB);
-    Value *R = RHS->codegen();
+    createProfiledCondBr(L, RHSBB, SetFalseBB, '&');
+    CS->Builder->SetInsertPoint(RHSBB);
+    Value *R = RHS.codegen();
     if (!R)
     {
         error(tok, "Error in lazyAnd(): R is nullptr");
@@ -101,41 +176,43 @@ Value *lazyAnd(std::unique_ptr<ASTnode> LHS, std::unique_ptr<ASTnode> RHS, TOKEN
         error(tok, "RHS is void! Cannot perform operation");
     }
     // convert result to bool
-    R = castToType(R, Type::getInt1Ty(TheContext), tok);
+    emitLocation(tok);
+    R = castToType(R, Type::getInt1Ty(*CS->TheContext), tok);
 
-    Builder.CreateCondBr(R, SetTrueBB, SetFalseBB);
+    createProfiledCondBr(R, SetTrueBB, SetFalseBB, '&');
 
     // set temp variable to true
-    Builder.SetInsertPoint(SetTrueBB);
-    Builder.CreateStore(ConstantInt::get(TheContext, APInt(1, 1, true)), temp);
-    Builder.CreateBr(EndBB);
+    CS->Builder->SetInsertPoint(SetTrueBB);
+    CS->Builder->CreateStore(ConstantInt::get(*CS->TheContext, APInt(1, 1, true)), temp);
+    CS->Builder->CreateBr(EndBB);
 
     // set temp variable to false
-    Builder.SetInsertPoint(SetFalseBB);
-    Builder.CreateStore(ConstantInt::get(TheContext, APInt(1, 0, true)), temp);
-    Builder.CreateBr(EndBB);
+    CS->Builder->SetInsertPoint(SetFalseBB);
+    CS->Builder->CreateStore(ConstantInt::get(*CS->TheContext, APInt(1, 0, true)), temp);
+    CS->Builder->CreateBr(EndBB);
 
     // exit and return temp variable
-    Builder.SetInsertPoint(EndBB);
-    return Builder.CreateLoad(Type::getInt1Ty(TheContext), temp, "andtmp");
+    CS->Builder->SetInsertPoint(EndBB);
+    return CS->Builder->CreateLoad(Type::getInt1Ty(*CS->TheContext), temp, "andtmp");
 }
 
 // Same principle as lazy and
-Value *lazyOr(std::unique_ptr<ASTnode> LHS, std::unique_ptr<ASTnode> RHS, TOKEN tok)
+Value *lazyOr(ASTnode &LHS, ASTnode &RHS, TOKEN tok)
 {
-    Function *TheFunction = Builder.GetInsertBlock()->getParent();
-    BasicBlock *LHSBB = BasicBlock::Create(TheContext, "lhs", TheFunction);
-    BasicBlock *RHSBB = BasicBlock::Create(TheContext, "rhs", TheFunction);
-    BasicBlock *EndBB = BasicBlock::Create(TheContext, "end", TheFunction);
-    BasicBlock *SetTrueBB = BasicBlock::Create(TheContext, "settrue", TheFunction);
-    BasicBlock *SetFalseBB = BasicBlock::Create(TheContext, "setfalse", TheFunction);
+    Function *TheFunction = CS->Builder->GetInsertBlock()->getParent();
+    BasicBlock *LHSBB = BasicBlock::Create(*CS->TheContext, "lhs", TheFunction);
+    BasicBlock *RHSBB = BasicBlock::Create(*CS->TheContext, "rhs", TheFunction);
+    BasicBlock *EndBB = BasicBlock::Create(*CS->TheContext, "end", TheFunction);
+    BasicBlock *SetTrueBB = BasicBlock::Create(*CS->TheContext, "settrue", TheFunction);
+    BasicBlock *SetFalseBB = BasicBlock::Create(*CS->TheContext, "setfalse", TheFunction);
 
     // temp variable to store result of lazy or
-    AllocaInst *temp = CreateEntryBlockAlloca(TheFunction, "ortmp", Type::getInt1Ty(TheContext));
+    AllocaInst *temp = CreateEntryBlockAlloca(TheFunction, "ortmp", Type::getInt1Ty(*CS->TheContext));
 
-    Builder.CreateBr(LHSBB);
-    Builder.SetInsertPoint(LHSBB);
-    Value *L = LHS->codegen();
+    emitLocation(tok);
+    CS->Builder->CreateBr(LHSBB);
+    CS->Builder->SetInsertPoint(LHSBB);
+    Value *L = LHS.codegen();
     if (!L)
     {
         error(tok, "Error in lazyOr(): L is nullptr");
@@ -145,12 +222,13 @@ Value *lazyOr(std::unique_ptr<ASTnode> LHS, std::unique_ptr<ASTnode> RHS, TOKEN
         error(tok, "LHS is void! Cannot perform operation");
     }
     // convert result to bool
-    L = castToType(L, Type::getInt1Ty(TheContext), tok);
+    emitLocation(tok);
+    L = castToType(L, Type::getInt1Ty(*CS->TheContext), tok);
 
     // branch to set temp variable to true and end if L is true, otherwise branch to RHS
-    Builder.CreateCondBr(L, SetTrueBB, RHSBB);
-    Builder.SetInsertPoint(RHSBB);
-    Value *R = RHS->codegen();
+    createProfiledCondBr(L, SetTrueBB, RHSBB, '|');
+    CS->Builder->SetInsertPoint(RHSBB);
+    Value *R = RHS.codegen();
     if (!R)
     {
         error(tok, "Error in lazyOr(): R is nullptr");
@@ -160,23 +238,24 @@ Value *lazyOr(std::unique_ptr<ASTnode> LHS, std::unique_ptr<ASTnode> RHS, TOKEN
         error(tok, "RHS is void! Cannot perform operation");
     }
     // convert result to bool
-    R = castToType(R, Type::getInt1Ty(TheContext), tok);
+    emitLocation(tok);
+    R = castToType(R, Type::getInt1Ty(*CS->TheContext), tok);
 
-    Builder.CreateCondBr(R, SetTrueBB, SetFalseBB);
+    createProfiledCondBr(R, SetTrueBB, SetFalseBB, '|');
 
     // set temp variable to true
-    Builder.SetInsertPoint(SetTrueBB);
-    Builder.CreateStore(ConstantInt::get(TheContext, APInt(1, 1, true)), temp);
-    Builder.CreateBr(EndBB);
+    CS->Builder->SetInsertPoint(SetTrueBB);
+    CS->Builder->CreateStore(ConstantInt::get(*CS->TheContext, APInt(1, 1, true)), temp);
+    CS->Builder->CreateBr(EndBB);
 
     // set temp variable to false
-    Builder.SetInsertPoint(SetFalseBB);
-    Builder.CreateStore(ConstantInt::get(TheContext, APInt(1, 0, true)), temp);
-    Builder.CreateBr(EndBB);
+    CS->Builder->SetInsertPoint(SetFalseBB);
+    CS->Builder->CreateStore(ConstantInt::get(*CS->TheContext, APInt(1, 0, true)), temp);
+    CS->Builder->CreateBr(EndBB);
 
     // exit and return temp variable
-    Builder.SetInsertPoint(EndBB);
-    return Builder.CreateLoad(Type::getInt1Ty(TheContext), temp, "ortmp");
+    CS->Builder->SetInsertPoint(EndBB);
+    return CS->Builder->CreateLoad(Type::getInt1Ty(*CS->TheContext), temp, "ortmp");
 }
 
 Type *getWidestType(Type *type1, Type *type2)
@@ -186,33 +265,33 @@ Type *getWidestType(Type *type1, Type *type2)
     {
         return type1;
     }
-    if (type1 == Type::getFloatTy(TheContext) || type2 == Type::getFloatTy(TheContext))
+    if (type1 == Type::getFloatTy(*CS->TheContext) || type2 == Type::getFloatTy(*CS->TheContext))
     {
-        return Type::getFloatTy(TheContext);
+        return Type::getFloatTy(*CS->TheContext);
     }
-    if (type1 == Type::getInt32Ty(TheContext) || type2 == Type::getInt32Ty(TheContext))
+    if (type1 == Type::getInt32Ty(*CS->TheContext) || type2 == Type::getInt32Ty(*CS->TheContext))
     {
-        return Type::getInt32Ty(TheContext);
+        return Type::getInt32Ty(*CS->TheContext);
     }
-    return Type::getInt1Ty(TheContext); // bool
+    return Type::getInt1Ty(*CS->TheContext); // bool
 }
 
 // LLVM type to string
 std::string typeToString(Type *type)
 {
-    if (type == Type::getFloatTy(TheContext))
+    if (type == Type::getFloatTy(*CS->TheContext))
     {
         return "float";
     }
-    if (type == Type::getInt32Ty(TheContext))
+    if (type == Type::getInt32Ty(*CS->TheContext))
     {
         return "int";
     }
-    if (type == Type::getInt1Ty(TheContext))
+    if (type == Type::getInt1Ty(*CS->TheContext))
     {
         return "bool";
     }
-    if (type == Type::getVoidTy(TheContext))
+    if (type == Type::getVoidTy(*CS->TheContext))
     {
         return "void";
     }
@@ -225,19 +304,19 @@ Type *getLLVMType(std::string Val)
 {
     if (Val == "int")
     {
-        return Type::getInt32Ty(TheContext);
+        return Type::getInt32Ty(*CS->TheContext);
     }
     else if (Val == "float")
     {
-        return Type::getFloatTy(TheContext);
+        return Type::getFloatTy(*CS->TheContext);
     }
     else if (Val == "bool")
     {
-        return Type::getInt1Ty(TheContext);
+        return Type::getInt1Ty(*CS->TheContext);
     }
     else if (Val == "void")
     {
-        return Type::getVoidTy(TheContext);
+        return Type::getVoidTy(*CS->TheContext);
     }
     else
     {
@@ -255,39 +334,65 @@ Value *castToType(Value *val, Type *type, TOKEN tok)
         return val;
     }
     // narrowing conversions, warn user
-    if (val->getType() == Type::getFloatTy(TheContext) && type == Type::getInt32Ty(TheContext))
+    if (val->getType() == Type::getFloatTy(*CS->TheContext) && type == Type::getInt32Ty(*CS->TheContext))
     {
         addWarning(tok, "Narrowing conversion from float to int");
-        return Builder.CreateFPToSI(val, type, "FPtoSIcast"); // floating point to signed int
+        return CS->Builder->CreateFPToSI(val, type, "FPtoSIcast"); // floating point to signed int
     }
-    if (val->getType() == Type::getFloatTy(TheContext) && type == Type::getInt1Ty(TheContext))
+    if (val->getType() == Type::getFloatTy(*CS->TheContext) && type == Type::getInt1Ty(*CS->TheContext))
     {
         addWarning(tok, "Narrowing conversion from float to bool");
-        return Builder.CreateFPToSI(val, type, "FPtoBcast"); // floating point to bool
+        return CS->Builder->CreateFPToSI(val, type, "FPtoBcast"); // floating point to bool
     }
-    if (val->getType() == Type::getInt32Ty(TheContext) && type == Type::getInt1Ty(TheContext))
+    if (val->getType() == Type::getInt32Ty(*CS->TheContext) && type == Type::getInt1Ty(*CS->TheContext))
     {
         addWarning(tok, "Narrowing conversion from int to bool");
-        return Builder.CreateIntCast(val, type, true, "SItoBcast"); // int to bool
+        return CS->Builder->CreateIntCast(val, type, true, "SItoBcast"); // int to bool
     }
 
     // widening conversions
-    if (val->getType() == Type::getInt32Ty(TheContext) && type == Type::getFloatTy(TheContext))
+    if (val->getType() == Type::getInt32Ty(*CS->TheContext) && type == Type::getFloatTy(*CS->TheContext))
     {
-        return Builder.CreateSIToFP(val, type, "SItoFPcast"); // signed int to float
+        return CS->Builder->CreateSIToFP(val, type, "SItoFPcast"); // signed int to float
     }
-    if (val->getType() == Type::getInt1Ty(TheContext) && type == Type::getFloatTy(TheContext))
+    if (val->getType() == Type::getInt1Ty(*CS->TheContext) && type == Type::getFloatTy(*CS->TheContext))
     {
-        return Builder.CreateSIToFP(val, type, "BtoFPcast"); // bool to float
+        return CS->Builder->CreateSIToFP(val, type, "BtoFPcast"); // bool to float
     }
-    if (val->getType() == Type::getInt1Ty(TheContext) && type == Type::getInt32Ty(TheContext))
+    if (val->getType() == Type::getInt1Ty(*CS->TheContext) && type == Type::getInt32Ty(*CS->TheContext))
     {
-        return Builder.CreateIntCast(val, type, false, "BtoSIcast"); // bool to int
+        return CS->Builder->CreateIntCast(val, type, false, "BtoSIcast"); // bool to int
     }
     error(tok, "Unsupported cast of " + typeToString(val->getType()) + " to " + typeToString(type));
     return nullptr;
 }
 
+// declare a function or global variable defined in another module
+Value *declarePrototype(const Prototype &P)
+{
+    if (!P.IsFunction)
+    {
+        GlobalVariable *G = new GlobalVariable(*CS->TheModule, getLLVMType(P.Type), false, GlobalValue::ExternalLinkage, nullptr, P.Name);
+        CS->GlobalNamedValues[P.Name] = G;
+        return G;
+    }
+
+    std::vector<Type *> paramTypes;
+    for (auto &t : P.ParamTypes)
+    {
+        paramTypes.push_back(getLLVMType(t));
+    }
+    FunctionType *FT = FunctionType::get(getLLVMType(P.Type), paramTypes, false);
+    Function *F = Function::Create(FT, Function::ExternalLinkage, P.Name, CS->TheModule.get());
+
+    unsigned Idx = 0;
+    for (auto &Arg : F->args())
+    {
+        Arg.setName(P.ParamNames[Idx++]);
+    }
+    return F;
+}
+
 // generating allocas from slides
 AllocaInst *CreateEntryBlockAlloca(Function *TheFunction, const std::string &VarName, Type *type)
 {
@@ -301,18 +406,19 @@ class IntASTnode : public ASTnode
     TOKEN Tok;
 
 public:
+    static constexpr const char *Kind = "IntASTnode";
     IntASTnode(int val, TOKEN tok) : Val(val), Tok(tok) {}
     virtual ~IntASTnode() {}
-    Value *codegen() { return ConstantInt::get(TheContext, APInt(32, Val, true)); };
+    Value *codegen() { return ConstantInt::get(*CS->TheContext, APInt(32, Val, true)); };
 
     std::string to_string() const
     {
         return "Int: " + std::to_string(Val) + "\n";
     }
 
-    std::string to_tree(std::string prefix, bool end) const
+    void to_tree(std::string &out, const std::string &prefix, bool end) const
     {
-        return prefix + (end ? "└── " : "├── ") + this->to_string();
+        out += prefix + (end ? "└── " : "├── ") + this->to_string();
     }
 };
 
@@ -323,18 +429,19 @@ class FloatASTnode : public ASTnode
     std::string Name;
 
 public:
+    static constexpr const char *Kind = "FloatASTnode";
     FloatASTnode(float val, TOKEN tok) : Val(val), Tok(tok) {}
     virtual ~FloatASTnode() {}
-    Value *codegen() { return ConstantFP::get(TheContext, APFloat(Val)); };
+    Value *codegen() { return ConstantFP::get(*CS->TheContext, APFloat(Val)); };
 
     std::string to_string() const
     {
         return "Float: " + std::to_string(Val) + "\n";
     }
 
-    std::string to_tree(std::string prefix, bool end) const
+    void to_tree(std::string &out, const std::string &prefix, bool end) const
     {
-        return prefix + (end ? "└── " : "├── ") + this->to_string();
+        out += prefix + (end ? "└── " : "├── ") + this->to_string();
     }
 };
 
@@ -345,17 +452,18 @@ class BoolASTnode : public ASTnode
     std::string Name;
 
 public:
+    static constexpr const char *Kind = "BoolASTnode";
     BoolASTnode(bool val, TOKEN tok) : Val(val), Tok(tok) {}
     virtual ~BoolASTnode() {}
-    Value *codegen() { return ConstantInt::get(TheContext, APInt(1, Val, true)); };
+    Value *codegen() { return ConstantInt::get(*CS->TheContext, APInt(1, Val, true)); };
     std::string to_string() const
     {
         return "Bool: " + std::to_string(Val) + "\n";
     }
 
-    std::string to_tree(std::string prefix, bool end) const
+    void to_tree(std::string &out, const std::string &prefix, bool end) const
     {
-        return prefix + (end ? "└── " : "├── ") + this->to_string();
+        out += prefix + (end ? "└── " : "├── ") + this->to_string();
     }
 };
 
@@ -364,6 +472,7 @@ class TypeASTnode : public ASTnode
     TOKEN Tok;
 
 public:
+    static constexpr const char *Kind = "TypeASTnode";
     std::string Val;
     TypeASTnode(std::string val, TOKEN tok) : Val(val), Tok(tok) {}
     virtual ~TypeASTnode() {}
@@ -371,9 +480,9 @@ public:
     Type *getType() { return getLLVMType(Val); }
     std::string to_string() const { return "Type: " + Val + "\n"; }
 
-    std::string to_tree(std::string prefix, bool end) const
+    void to_tree(std::string &out, const std::string &prefix, bool end) const
     {
-        return prefix + (end ? "└── " : "├── ") + this->to_string();
+        out += prefix + (end ? "└── " : "├── ") + this->to_string();
     }
 };
 
@@ -384,6 +493,7 @@ class BinOpNode : public ASTnode
     std::unique_ptr<ASTnode> LHS, RHS;
 
 public:
+    static constexpr const char *Kind = "BinOpNode";
     BinOpNode(std::string op, std::unique_ptr<ASTnode> lhs, std::unique_ptr<ASTnode> rhs, TOKEN tok) : Op(op), LHS(std::move(lhs)), RHS(std::move(rhs)), Tok(tok) {}
     virtual ~BinOpNode() {}
     Value *codegen()
@@ -391,15 +501,16 @@ public:
         // lazy operations handled separately
         if (Op == "||")
         {
-            return lazyOr(std::move(LHS), std::move(RHS), Tok);
+            return lazyOr(*LHS, *RHS, Tok);
         }
         else if (Op == "&&")
         {
-            return lazyAnd(std::move(LHS), std::move(RHS), Tok);
+            return lazyAnd(*LHS, *RHS, Tok);
         }
 
         Value *L = LHS->codegen();
         Value *R = RHS->codegen();
+        emitLocation(Tok);
 
         // check for void types
         if (L->getType()->isVoidTy())
@@ -424,27 +535,27 @@ public:
         {
         case PLUS:
             if (L->getType()->isIntegerTy())
-                return Builder.CreateAdd(L, R, "addtmp");
+                return CS->Builder->CreateAdd(L, R, "addtmp");
             else if (L->getType()->isFloatingPointTy())
-                return Builder.CreateFAdd(L, R, "addtmp");
+                return createFAddOrFMulAdd(L, R, false, "addtmp");
             else
                 error(Tok, "Cannot add " + typeToString(L->getType()) + " and " + typeToString(R->getType()));
             break;
 
         case MINUS:
             if (L->getType()->isIntegerTy())
-                return Builder.CreateSub(L, R, "subtmp");
+                return CS->Builder->CreateSub(L, R, "subtmp");
             else if (L->getType()->isFloatingPointTy())
-                return Builder.CreateFSub(L, R, "subtmp");
+                return createFAddOrFMulAdd(L, R, true, "subtmp");
             else
                 error(Tok, "Cannot subtract " + typeToString(L->getType()) + " and " + typeToString(R->getType()));
             break;
 
         case ASTERIX:
             if (L->getType()->isIntegerTy())
-                return Builder.CreateMul(L, R, "multmp");
+                return CS->Builder->CreateMul(L, R, "multmp");
             else if (L->getType()->isFloatingPointTy())
-                return Builder.CreateFMul(L, R, "multmp");
+                return CS->Builder->CreateFMul(L, R, "multmp");
             else
                 error(Tok, "Cannot multiply " + typeToString(L->getType()) + " and " + typeToString(R->getType()));
             break;
@@ -467,9 +578,9 @@ public:
             }
 
             if (L->getType()->isIntegerTy())
-                return Builder.CreateSDiv(L, R, "divtmp");
+                return CS->Builder->CreateSDiv(L, R, "divtmp");
             else if (L->getType()->isFloatingPointTy())
-                return Builder.CreateFDiv(L, R, "divtmp");
+                return CS->Builder->CreateFDiv(L, R, "divtmp");
             else
                 error(Tok, "Cannot divide " + typeToString(L->getType()) + " and " + typeToString(R->getType()));
             break;
@@ -492,63 +603,63 @@ public:
             }
 
             if (L->getType()->isIntegerTy())
-                return Builder.CreateSRem(L, R, "modtmp");
+                return CS->Builder->CreateSRem(L, R, "modtmp");
             else if (L->getType()->isFloatingPointTy())
-                return Builder.CreateFRem(L, R, "modtmp");
+                return CS->Builder->CreateFRem(L, R, "modtmp");
             else
                 error(Tok, "Cannot mod " + typeToString(L->getType()) + " and " + typeToString(R->getType()));
             break;
 
         case LT:
             if (L->getType()->isIntegerTy())
-                return Builder.CreateICmpSLT(L, R, "lttmp");
+                return CS->Builder->CreateICmpSLT(L, R, "lttmp");
             else if (L->getType()->isFloatingPointTy())
-                return Builder.CreateFCmpOLT(L, R, "lttmp");
+                return CS->Builder->CreateFCmpOLT(L, R, "lttmp");
             else
                 error(Tok, "Cannot compare " + typeToString(L->getType()) + " and " + typeToString(R->getType()));
             break;
 
         case GT:
             if (L->getType()->isIntegerTy())
-                return Builder.CreateICmpSGT(L, R, "gttmp");
+                return CS->Builder->CreateICmpSGT(L, R, "gttmp");
             else if (L->getType()->isFloatingPointTy())
-                return Builder.CreateFCmpOGT(L, R, "gttmp");
+                return CS->Builder->CreateFCmpOGT(L, R, "gttmp");
             else
                 error(Tok, "Cannot compare " + typeToString(L->getType()) + " and " + typeToString(R->getType()));
             break;
 
         case LE:
             if (L->getType()->isIntegerTy())
-                return Builder.CreateICmpSLE(L, R, "letmp");
+                return CS->Builder->CreateICmpSLE(L, R, "letmp");
             else if (L->getType()->isFloatingPointTy())
-                return Builder.CreateFCmpOLE(L, R, "letmp");
+                return CS->Builder->CreateFCmpOLE(L, R, "letmp");
             else
                 error(Tok, "Cannot compare " + typeToString(L->getType()) + " and " + typeToString(R->getType()));
             break;
 
         case GE:
             if (L->getType()->isIntegerTy())
-                return Builder.CreateICmpSGE(L, R, "getmp");
+                return CS->Builder->CreateICmpSGE(L, R, "getmp");
             else if (L->getType()->isFloatingPointTy())
-                return Builder.CreateFCmpOGE(L, R, "getmp");
+                return CS->Builder->CreateFCmpOGE(L, R, "getmp");
             else
                 error(Tok, "Cannot compare " + typeToString(L->getType()) + " and " + typeToString(R->getType()));
             break;
 
         case EQ:
             if (L->getType()->isIntegerTy())
-                return Builder.CreateICmpEQ(L, R, "eqtmp");
+                return CS->Builder->CreateICmpEQ(L, R, "eqtmp");
             else if (L->getType()->isFloatingPointTy())
-                return Builder.CreateFCmpOEQ(L, R, "eqtmp");
+                return CS->Builder->CreateFCmpOEQ(L, R, "eqtmp");
             else
                 error(Tok, "Cannot compare " + typeToString(L->getType()) + " and " + typeToString(R->getType()));
             break;
 
         case NE:
             if (L->getType()->isIntegerTy())
-                return Builder.CreateICmpNE(L, R, "netmp");
+                return CS->Builder->CreateICmpNE(L, R, "netmp");
             else if (L->getType()->isFloatingPointTy())
-                return Builder.CreateFCmpONE(L, R, "netmp");
+                return CS->Builder->CreateFCmpONE(L, R, "netmp");
             else
                 error(Tok, "Cannot compare " + typeToString(L->getType()) + " and " + typeToString(R->getType()));
             break;
@@ -561,11 +672,24 @@ public:
 
     std::string to_string() const { return "BinOp: " + Op + "\n"; }
 
-    std::string to_tree(std::string prefix, bool end) const
+    void to_tree(std::string &out, const std::string &prefix, bool end) const
     {
-        std::string out = prefix + (end ? "└── " : "├── ") + this->to_string();
+        out += prefix + (end ? "└── " : "├── ") + this->to_string();
         std::string new_prefix = prefix + (end ? "    " : "│   ");
-        return out + LHS->to_tree(new_prefix, false) + RHS->to_tree(new_prefix, true);
+        LHS->to_tree(out, new_prefix, false);
+        RHS->to_tree(out, new_prefix, true);
+    }
+
+    void collectDeps(std::set<std::string> &Calls, std::set<std::string> &Vars) const
+    {
+        LHS->collectDeps(Calls, Vars);
+        RHS->collectDeps(Calls, Vars);
+    }
+
+    void collectEffects(Effects &E) const
+    {
+        LHS->collectEffects(E);
+        RHS->collectEffects(E);
     }
 };
 
@@ -576,12 +700,14 @@ class UnaryOpNode : public ASTnode
     std::unique_ptr<ASTnode> RHS;
 
 public:
+    static constexpr const char *Kind = "UnaryOpNode";
     UnaryOpNode(std::string op, std::unique_ptr<ASTnode> rhs, TOKEN tok) : Op(op), RHS(std::move(rhs)), Tok(tok) {}
     virtual ~UnaryOpNode() {}
 
     Value *codegen()
     {
         Value *R = RHS->codegen();
+        emitLocation(Tok);
         if (!R)
         {
             error(Tok, "Error in UnaryOpNode::codegen(): R is nullptr");
@@ -594,13 +720,13 @@ public:
         {
             if (R->getType()->isIntegerTy())
             {
-                return Builder.CreateNot(R, "nottmp");
+                return CS->Builder->CreateNot(R, "nottmp");
             }
             else if (R->getType()->isFloatingPointTy())
             {
                 // need to cast to bool (i.e. int) to perform not
-                Value *casted = castToType(R, Type::getInt1Ty(TheContext), Tok);
-                return Builder.CreateNot(casted, "nottmp");
+                Value *casted = castToType(R, Type::getInt1Ty(*CS->TheContext), Tok);
+                return CS->Builder->CreateNot(casted, "nottmp");
             }
             else
             {
@@ -613,12 +739,12 @@ public:
             if (R->getType()->isIntegerTy())
             {
                 // cast to an int if bool
-                R = castToType(R, Type::getInt32Ty(TheContext), Tok);
-                return Builder.CreateNeg(R, "negtmp");
+                R = castToType(R, Type::getInt32Ty(*CS->TheContext), Tok);
+                return CS->Builder->CreateNeg(R, "negtmp");
             }
             else if (R->getType()->isFloatingPointTy())
             {
-                return Builder.CreateFNeg(R, "negtmp");
+                return CS->Builder->CreateFNeg(R, "negtmp");
             }
             else
             {
@@ -635,10 +761,20 @@ public:
 
     std::string to_string() const { return "UnaryOp: " + Op + "\n"; }
 
-    std::string to_tree(std::string prefix, bool end) const
+    void to_tree(std::string &out, const std::string &prefix, bool end) const
+    {
+        out += prefix + (end ? "└── " : "├── ") + this->to_string();
+        RHS->to_tree(out, prefix + (end ? "    " : "│   "), true);
+    }
+
+    void collectDeps(std::set<std::string> &Calls, std::set<std::string> &Vars) const
+    {
+        RHS->collectDeps(Calls, Vars);
+    }
+
+    void collectEffects(Effects &E) const
     {
-        std::string out = prefix + (end ? "└── " : "├── ") + this->to_string();
-        return out + RHS->to_tree(prefix + (end ? "    " : "│   "), true);
+        RHS->collectEffects(E);
     }
 };
 
@@ -649,6 +785,7 @@ class ParamASTnode : public ASTnode
     std::string Name;
 
 public:
+    static constexpr const char *Kind = "ParamASTnode";
     ParamASTnode(std::unique_ptr<TypeASTnode> type, std::string name, TOKEN tok) : TypeNode(std::move(type)), Name(name), Tok(tok) {}
     virtual ~ParamASTnode() {}
     Value *codegen()
@@ -658,13 +795,15 @@ public:
         return nullptr;
     };
     Type *getType() { return TypeNode->getType(); }
+    std::string getTypeName() const { return TypeNode->Val; }
     std::string getName() { return Name; }
+    const TOKEN &getTok() const { return Tok; }
     std::string to_string() const { return "Param: " + Name + "\n"; }
 
-    std::string to_tree(std::string prefix, bool end) const
+    void to_tree(std::string &out, const std::string &prefix, bool end) const
     {
-        std::string out = prefix + (end ? "└── " : "├── ") + this->to_string();
-        return out + TypeNode->to_tree(prefix + (end ? "    " : "│   "), true);
+        out += prefix + (end ? "└── " : "├── ") + this->to_string();
+        TypeNode->to_tree(out, prefix + (end ? "    " : "│   "), true);
     }
 };
 
@@ -675,28 +814,41 @@ class FunctionASTnode : public ASTnode
     std::string Name;
     std::vector<std::unique_ptr<ParamASTnode>> Params;
     std::unique_ptr<ASTnode> Body;
+    std::vector<std::string> Attrs; // [[attributes]] as written, see attributes.hpp
+    std::string TokenHash; // hash of the tokens this function was parsed from, if recorded
+    int TokenLine = 0;     // the line the first of them is on, their lines are hashed relative to it
 
 public:
+    static constexpr const char *Kind = "FunctionASTnode";
     FunctionASTnode(std::unique_ptr<TypeASTnode> type,
                     std::string name,
                     std::vector<std::unique_ptr<ParamASTnode>> params,
-                    std::unique_ptr<ASTnode> body, TOKEN tok) : TypeNode(std::move(type)),
-                                                                Name(name),
-                                                                Params(std::move(params)),
-                                                                Body(std::move(body)),
-                                                                Tok(tok) {}
+                    std::unique_ptr<ASTnode> body, TOKEN tok,
+                    std::vector<std::string> attrs = {}) : TypeNode(std::move(type)),
+                                                           Name(name),
+                                                           Params(std::move(params)),
+                                                           Body(std::move(body)),
+                                                           Attrs(std::move(attrs)),
+                                                           Tok(tok) {}
 
     virtual ~FunctionASTnode() {}
 
     Value *codegen()
     {
+        TimeTraceScope Trace("Generate function", Name);
+
         // check if function already exists, prevent function overloading
-        Function *F = TheModule->getFunction(Name);
+        Function *F = CS->TheModule->getFunction(Name);
         if (F)
         {
             error(Tok, "Function `" + Name + "` already exists or trying to overload the function which is not allowed.");
             return nullptr;
         }
+        if (isBuiltin(Name))
+        {
+            error(Tok, "`" + Name + "` is a builtin and can't be declared");
+            return nullptr;
+        }
 
         // create param types
         std::vector<Type *> paramTypes;
@@ -707,11 +859,15 @@ public:
 
         // create function type
         FunctionType *FT = FunctionType::get(TypeNode->getType(), paramTypes, false);
-        F = Function::Create(FT, Function::ExternalLinkage, Name, TheModule.get());
-        Builder.SetInsertPoint(BasicBlock::Create(TheContext, "entry", F));
+        F = Function::Create(FT, Function::ExternalLinkage, Name, CS->TheModule.get());
+        CS->Builder->SetInsertPoint(BasicBlock::Create(*CS->TheContext, "entry", F));
+        beginFunctionDebugInfo(F, Tok);
+        beginFunctionProfile(F);
+        beginFunctionFastMath(F, Attrs);
+        beginFunctionMultiversion(F, Attrs, Tok);
 
         // set var table for function
-        NamedValues.push_back(std::map<std::string, AllocaInst *>());
+        CS->NamedValues.push_back(std::map<std::string, AllocaInst *>());
 
         // handle function parameters
         unsigned Idx = 0;
@@ -719,45 +875,92 @@ public:
         {
             Arg.setName(Params[Idx]->getName());
             AllocaInst *Alloca = CreateEntryBlockAlloca(F, Arg.getName().str(), Arg.getType());
-            Builder.CreateStore(&Arg, Alloca);
-            NamedValues.back()[Arg.getName().str()] = Alloca;
+            CS->Builder->CreateStore(&Arg, Alloca);
+            CS->NamedValues.back()[Arg.getName().str()] = Alloca;
+            declareVariable(Alloca, Params[Idx]->getName(), Params[Idx]->getTok(), Idx + 1);
             Idx++;
         }
 
         // generate function body
         Value *RetVal = Body->codegen();
 
-        // check if function ends with a return
-        if (verifyFunction(*F)) // If there are no errors, the verifyFunction returns false
+        // every block but the one code is being inserted into ends in a branch or
+        // a return (blocks stop generating after a return), so the function falls
+        // off its end exactly when that block has no terminator
+        if (!CS->Builder->GetInsertBlock()->getTerminator())
         {
             // create return instruction
-            if (TypeNode.get()->getType() == Type::getVoidTy(TheContext))
+            if (TypeNode.get()->getType() == Type::getVoidTy(*CS->TheContext))
             {
-                Builder.CreateRetVoid();
+                CS->Builder->CreateRetVoid();
             }
             else
             {
-                Builder.CreateRet(Constant::getNullValue(TypeNode->getType()));
+                CS->Builder->CreateRet(Constant::getNullValue(TypeNode->getType()));
             }
         }
 
         // clear local vars
-        NamedValues.pop_back();
+        CS->NamedValues.pop_back();
+        endFunctionProfile(F, Tok);
+        endFunctionFastMath();
+        endFunctionDebugInfo();
         return F;
     };
 
-    std::string to_string() const { return "Function: " + Name + "\n"; }
+    std::string to_string() const { return "Function: " + attributesToString(Attrs) + Name + "\n"; }
 
-    std::string to_tree(std::string prefix, bool end) const
+    void to_tree(std::string &out, const std::string &prefix, bool end) const
     {
-        std::string out = prefix + (end ? "└── " : "├── ") + this->to_string();
+        out += prefix + (end ? "└── " : "├── ") + this->to_string();
         std::string new_prefix = prefix + (end ? "    " : "│   ");
-        out += TypeNode->to_tree(new_prefix, false);
+        TypeNode->to_tree(out, new_prefix, false);
         for (auto &p : Params)
         {
-            out += p->to_tree(new_prefix, false);
+            p->to_tree(out, new_prefix, false);
         }
-        return out + Body->to_tree(new_prefix, true);
+        Body->to_tree(out, new_prefix, true);
+    }
+
+    void collectDeps(std::set<std::string> &Calls, std::set<std::string> &Vars) const
+    {
+        Body->collectDeps(Calls, Vars);
+    }
+
+    void collectEffects(Effects &E) const
+    {
+        E.Locals.emplace_back();
+        for (auto &p : Params)
+        {
+            E.Locals.back().insert(p->getName());
+        }
+        Body->collectEffects(E);
+        E.Locals.pop_back();
+    }
+
+    bool isFunction() const { return true; }
+    std::string getName() const { return Name; }
+    const TOKEN &getTok() const { return Tok; }
+    const std::vector<std::string> &getAttributes() const { return Attrs; }
+    void setTokenHash(std::string hash, int line)
+    {
+        TokenHash = hash;
+        TokenLine = line;
+    }
+    std::string getTokenHash() const { return TokenHash; }
+    int getTokenLine() const { return TokenLine; }
+
+    Prototype getPrototype() const
+    {
+        Prototype P;
+        P.Name = Name;
+        P.Type = TypeNode->Val;
+        for (auto &p : Params)
+        {
+            P.ParamTypes.push_back(p->getTypeName());
+            P.ParamNames.push_back(p->getName());
+        }
+        return P;
     }
 };
 
@@ -767,26 +970,35 @@ class ExternASTnode : public ASTnode
     std::unique_ptr<TypeASTnode> TypeNode;
     std::string Name;
     std::vector<std::unique_ptr<ParamASTnode>> Params;
+    std::vector<std::string> Attrs; // [[attributes]] as written, see attributes.hpp
 
 public:
+    static constexpr const char *Kind = "ExternASTnode";
     ExternASTnode(std::unique_ptr<TypeASTnode> type,
                   std::string name,
                   std::vector<std::unique_ptr<ParamASTnode>> params,
-                  TOKEN tok) : TypeNode(std::move(type)),
-                               Name(name),
-                               Params(std::move(params)),
-                               Tok(tok) {}
+                  TOKEN tok,
+                  std::vector<std::string> attrs = {}) : TypeNode(std::move(type)),
+                                                         Name(name),
+                                                         Params(std::move(params)),
+                                                         Attrs(std::move(attrs)),
+                                                         Tok(tok) {}
 
     virtual ~ExternASTnode() {}
     Value *codegen()
     {
         // check if function already exists, prevent function overloading
-        Function *F = TheModule->getFunction(Name);
+        Function *F = CS->TheModule->getFunction(Name);
         if (F)
         {
             error(Tok, "Function `" + Name + "` already exists or trying to overload the function which is not allowed.");
             return nullptr;
         }
+        if (isBuiltin(Name))
+        {
+            error(Tok, "`" + Name + "` is a builtin and can't be declared");
+            return nullptr;
+        }
 
         // create param types
         std::vector<Type *> paramTypes;
@@ -797,7 +1009,7 @@ public:
 
         // create function type
         FunctionType *FT = FunctionType::get(TypeNode->getType(), paramTypes, false);
-        F = Function::Create(FT, Function::ExternalLinkage, Name, TheModule.get());
+        F = Function::Create(FT, Function::ExternalLinkage, Name, CS->TheModule.get());
 
         // set names for all arguments
         unsigned Idx = 0;
@@ -809,18 +1021,34 @@ public:
         return F;
     };
 
-    std::string to_string() const { return "Extern: " + Name + "\n"; }
+    std::string to_string() const { return "Extern: " + attributesToString(Attrs) + Name + "\n"; }
 
-    std::string to_tree(std::string prefix, bool end) const
+    void to_tree(std::string &out, const std::string &prefix, bool end) const
     {
-        std::string out = prefix + (end ? "└── " : "├── ") + this->to_string();
+        out += prefix + (end ? "└── " : "├── ") + this->to_string();
         std::string new_prefix = prefix + (end ? "    " : "│   ");
-        out += TypeNode->to_tree(new_prefix, false);
+        TypeNode->to_tree(out, new_prefix, false);
         for (auto &p : Params)
         {
-            out += p->to_tree(new_prefix, p == Params.back());
+            p->to_tree(out, new_prefix, p == Params.back());
         }
-        return out;
+    }
+
+    bool isExtern() const { return true; }
+    std::string getName() const { return Name; }
+    const std::vector<std::string> &getAttributes() const { return Attrs; }
+
+    Prototype getPrototype() const
+    {
+        Prototype P;
+        P.Name = Name;
+        P.Type = TypeNode->Val;
+        for (auto &p : Params)
+        {
+            P.ParamTypes.push_back(p->getTypeName());
+            P.ParamNames.push_back(p->getName());
+        }
+        return P;
     }
 };
 
@@ -832,10 +1060,12 @@ class IfASTnode : public ASTnode
     std::unique_ptr<ASTnode> Else;
 
 public:
+    static constexpr const char *Kind = "IfASTnode";
     IfASTnode(std::unique_ptr<ASTnode> cond, std::unique_ptr<ASTnode> then, std::unique_ptr<ASTnode> else_, TOKEN tok) : Cond(std::move(cond)), Then(std::move(then)), Else(std::move(else_)), Tok(tok) {}
     Value *codegen()
     {
         Value *CondV = Cond->codegen();
+        emitLocation(Tok);
         if (!CondV)
         {
             error(Tok, "Error in IfASTnode::codegen(): CondV is nullptr");
@@ -846,84 +1076,117 @@ public:
         }
 
         // convert condition to bool
-        castToType(CondV, Type::getInt1Ty(TheContext), Tok);
+        CondV = castToType(CondV, Type::getInt1Ty(*CS->TheContext), Tok);
 
-        Function *TheFunction = Builder.GetInsertBlock()->getParent();
-        BasicBlock *thenBlock = BasicBlock::Create(TheContext, "then", TheFunction);
-        BasicBlock *elseBlock = BasicBlock::Create(TheContext, "else");
-        BasicBlock *mergeBlock = BasicBlock::Create(TheContext, "ifcont");
+        Function *TheFunction = CS->Builder->GetInsertBlock()->getParent();
+        BasicBlock *thenBlock = BasicBlock::Create(*CS->TheContext, "then", TheFunction);
+        BasicBlock *elseBlock = BasicBlock::Create(*CS->TheContext, "else");
+        BasicBlock *mergeBlock = BasicBlock::Create(*CS->TheContext, "ifcont");
 
         // generate else branching
         if (Else)
         {
-            Builder.CreateCondBr(CondV, thenBlock, elseBlock);
+            createProfiledCondBr(CondV, thenBlock, elseBlock, 'i');
         }
         else
         {
-            Builder.CreateCondBr(CondV, thenBlock, mergeBlock);
+            createProfiledCondBr(CondV, thenBlock, mergeBlock, 'i');
         }
 
         // generate then block
-        Builder.SetInsertPoint(thenBlock);
+        CS->Builder->SetInsertPoint(thenBlock);
         Value *ThenV = Then->codegen();
 
-        Builder.CreateBr(mergeBlock);
-        thenBlock = Builder.GetInsertBlock();
+        // a block that returned is already terminated
+        if (!CS->Builder->GetInsertBlock()->getTerminator())
+            CS->Builder->CreateBr(mergeBlock);
+        thenBlock = CS->Builder->GetInsertBlock();
 
         // generate else block
         if (Else)
         {
             TheFunction->insert(TheFunction->end(), elseBlock);
-            Builder.SetInsertPoint(elseBlock);
+            CS->Builder->SetInsertPoint(elseBlock);
             Value *ElseV = Else->codegen();
         }
 
         // generate merge block back to rest of code
-        Builder.CreateBr(mergeBlock);
+        if (!CS->Builder->GetInsertBlock()->getTerminator())
+            CS->Builder->CreateBr(mergeBlock);
         TheFunction->insert(TheFunction->end(), mergeBlock);
-        Builder.SetInsertPoint(mergeBlock);
+        CS->Builder->SetInsertPoint(mergeBlock);
         return nullptr;
     };
 
     std::string to_string() const { return "If \n"; }
 
-    std::string to_tree(std::string prefix, bool end) const
+    void to_tree(std::string &out, const std::string &prefix, bool end) const
     {
-        std::string out = prefix + (end ? "└── " : "├── ") + this->to_string();
+        out += prefix + (end ? "└── " : "├── ") + this->to_string();
         std::string new_prefix = prefix + (end ? "    " : "│   ");
-        out += Cond->to_tree(new_prefix, false);
+        Cond->to_tree(out, new_prefix, false);
         if (Else)
         {
-            out += Then->to_tree(new_prefix, false);
-            return out + Else->to_tree(new_prefix, true);
+            Then->to_tree(out, new_prefix, false);
+            Else->to_tree(out, new_prefix, true);
         }
         else
         {
-            return out + Then->to_tree(new_prefix, true);
+            Then->to_tree(out, new_prefix, true);
+        }
+    }
+
+    void collectDeps(std::set<std::string> &Calls, std::set<std::string> &Vars) const
+    {
+        Cond->collectDeps(Calls, Vars);
+        Then->collectDeps(Calls, Vars);
+        if (Else)
+        {
+            Else->collectDeps(Calls, Vars);
+        }
+    }
+
+    void collectEffects(Effects &E) const
+    {
+        Cond->collectEffects(E);
+        Then->collectEffects(E);
+        if (Else)
+        {
+            Else->collectEffects(E);
         }
     }
 };
 
+// #pragma unroll(N), vectorize(width) and interleave(N) before a while loop,
+// 0 if not given
+struct LoopHints
+{
+    unsigned Unroll = 0, VectorizeWidth = 0, Interleave = 0;
+
+    bool empty() const { return !Unroll && !VectorizeWidth && !Interleave; }
+
+    std::string to_string() const
+    {
+        std::string out;
+        out += Unroll ? "unroll(" + std::to_string(Unroll) + ") " : "";
+        out += VectorizeWidth ? "vectorize(" + std::to_string(VectorizeWidth) + ") " : "";
+        out += Interleave ? "interleave(" + std::to_string(Interleave) + ") " : "";
+        return out;
+    }
+};
+
 class WhileASTnode : public ASTnode
 {
     TOKEN Tok;
     std::unique_ptr<ASTnode> Cond;
     std::unique_ptr<ASTnode> Body;
+    LoopHints Hints;
 
-public:
-    WhileASTnode(std::unique_ptr<ASTnode> cond, std::unique_ptr<ASTnode> body, TOKEN tok) : Cond(std::move(cond)), Body(std::move(body)), Tok(tok) {}
-    Value *codegen()
+    // the condition as a bool, generated at the guard and again at the latch
+    Value *codegenCond()
     {
-        Function *TheFunction = Builder.GetInsertBlock()->getParent();
-        BasicBlock *condBlock = BasicBlock::Create(TheContext, "cond", TheFunction);
-        BasicBlock *bodyBlock = BasicBlock::Create(TheContext, "body", TheFunction);
-        BasicBlock *exitBlock = BasicBlock::Create(TheContext, "exitwhile", TheFunction);
-
-        // generate condition block
-        Builder.CreateBr(condBlock);
-        Builder.SetInsertPoint(condBlock);
-
         Value *CondV = Cond->codegen();
+        emitLocation(Tok);
         if (!CondV)
         {
             error(Tok, "Error in WhileASTnode::codegen(): CondV is nullptr");
@@ -934,25 +1197,120 @@ public:
         }
 
         // convert condition to bool
-        castToType(CondV, Type::getInt1Ty(TheContext), Tok);
+        return castToType(CondV, Type::getInt1Ty(*CS->TheContext), Tok);
+    }
 
-        // generate body branching
-        Builder.CreateCondBr(CondV, bodyBlock, exitBlock);
-        Builder.SetInsertPoint(bodyBlock);
+    // the loop ID on the latch: itself, where the loop starts with -g (or
+    // remarks), and the pragmas for the unroller and vectorizer
+    void setLoopMetadata(BranchInst *Latch, DebugLoc Start)
+    {
+        if (Hints.empty() && !Start)
+        {
+            return;
+        }
+        LLVMContext &C = *CS->TheContext;
+        auto property = [&C](StringRef Name, unsigned Value) -> Metadata *
+        {
+            if (Value == 0)
+            {
+                return MDNode::get(C, MDString::get(C, Name));
+            }
+            return MDNode::get(C, {MDString::get(C, Name), ConstantAsMetadata::get(ConstantInt::get(Type::getInt32Ty(C), Value))});
+        };
+
+        SmallVector<Metadata *, 6> Operands = {nullptr};
+        if (Start)
+        {
+            Operands.push_back(Start.get());
+        }
+        // unroll(1) and vectorize(1) turn the transformation off
+        if (Hints.Unroll)
+        {
+            Operands.push_back(Hints.Unroll == 1 ? property("llvm.loop.unroll.disable", 0) : property("llvm.loop.unroll.count", Hints.Unroll));
+        }
+        if (Hints.VectorizeWidth > 1)
+        {
+            Operands.push_back(MDNode::get(C, {MDString::get(C, "llvm.loop.vectorize.enable"), ConstantAsMetadata::get(ConstantInt::getTrue(C))}));
+        }
+        if (Hints.VectorizeWidth)
+        {
+            Operands.push_back(property("llvm.loop.vectorize.width", Hints.VectorizeWidth));
+        }
+        if (Hints.Interleave)
+        {
+            Operands.push_back(property("llvm.loop.interleave.count", Hints.Interleave));
+        }
+        MDNode *LoopID = MDNode::getDistinct(C, Operands);
+        LoopID->replaceOperandWith(0, LoopID);
+        Latch->setMetadata(LLVMContext::MD_loop, LoopID);
+    }
+
+public:
+    static constexpr const char *Kind = "WhileASTnode";
+    WhileASTnode(std::unique_ptr<ASTnode> cond, std::unique_ptr<ASTnode> body, TOKEN tok, LoopHints hints = {}) : Cond(std::move(cond)), Body(std::move(body)), Tok(tok), Hints(hints) {}
+
+    // generated rotated: a guard tests the condition once, and the latch after
+    // every iteration, so the loop is entered from a preheader of its own and
+    // has one back edge, the shape the loop passes want
+    Value *codegen()
+    {
+        Function *TheFunction = CS->Builder->GetInsertBlock()->getParent();
+        BasicBlock *preheaderBlock = BasicBlock::Create(*CS->TheContext, "preheader", TheFunction);
+        BasicBlock *bodyBlock = BasicBlock::Create(*CS->TheContext, "body");
+        BasicBlock *latchBlock = BasicBlock::Create(*CS->TheContext, "latch");
+        BasicBlock *exitBlock = BasicBlock::Create(*CS->TheContext, "exitwhile");
+
+        // generate the guard
+        emitLocation(Tok);
+        DebugLoc Start = CS->Builder->getCurrentDebugLocation();
+        createProfiledCondBr(codegenCond(), preheaderBlock, exitBlock, 'w');
+        CS->Builder->SetInsertPoint(preheaderBlock);
+        CS->Builder->CreateBr(bodyBlock);
+
+        // generate the body
+        TheFunction->insert(TheFunction->end(), bodyBlock);
+        CS->Builder->SetInsertPoint(bodyBlock);
         Value *BodyV = Body->codegen();
-        Builder.CreateBr(condBlock);       // go back to condition block
-        Builder.SetInsertPoint(exitBlock); // set insert point to exit loop
+        emitLocation(Tok);
+        if (!CS->Builder->GetInsertBlock()->getTerminator())
+            CS->Builder->CreateBr(latchBlock);
+
+        // generate the latch, the condition's warnings were given at the guard
+        TheFunction->insert(TheFunction->end(), latchBlock);
+        CS->Builder->SetInsertPoint(latchBlock);
+        Value *CondV;
+        {
+            QuietWarnings Quiet;
+            CondV = codegenCond();
+        }
+        setLoopMetadata(createProfiledCondBr(CondV, bodyBlock, exitBlock, 'w'), Start);
+
+        TheFunction->insert(TheFunction->end(), exitBlock);
+        CS->Builder->SetInsertPoint(exitBlock); // set insert point to exit loop
         return nullptr;
     };
 
-    std::string to_string() const { return "While \n"; }
+    std::string to_string() const { return "While " + Hints.to_string() + "\n"; }
 
-    std::string to_tree(std::string prefix, bool end) const
+    void to_tree(std::string &out, const std::string &prefix, bool end) const
     {
-        std::string out = prefix + (end ? "└── " : "├── ") + this->to_string();
+        out += prefix + (end ? "└── " : "├── ") + this->to_string();
         std::string new_prefix = prefix + (end ? "    " : "│   ");
-        out += Cond->to_tree(new_prefix, false);
-        return out + Body->to_tree(new_prefix, true);
+        Cond->to_tree(out, new_prefix, false);
+        Body->to_tree(out, new_prefix, true);
+    }
+
+    void collectDeps(std::set<std::string> &Calls, std::set<std::string> &Vars) const
+    {
+        Cond->collectDeps(Calls, Vars);
+        Body->collectDeps(Calls, Vars);
+    }
+
+    void collectEffects(Effects &E) const
+    {
+        E.Loops = true;
+        Cond->collectEffects(E);
+        Body->collectEffects(E);
     }
 };
 
@@ -962,37 +1320,56 @@ class ReturnASTnode : public ASTnode
     std::unique_ptr<ASTnode> Val;
 
 public:
+    static constexpr const char *Kind = "ReturnASTnode";
     ReturnASTnode(std::unique_ptr<ASTnode> val, TOKEN tok) : Val(std::move(val)), Tok(tok) {}
     virtual ~ReturnASTnode() {}
     Value *codegen()
     {
-        Function *TheFunction = Builder.GetInsertBlock()->getParent();
+        Function *TheFunction = CS->Builder->GetInsertBlock()->getParent();
 
+        emitLocation(Tok);
         if (!Val)
         {
-            return Builder.CreateRetVoid();
+            return CS->Builder->CreateRetVoid();
         }
         Value *V = Val->codegen();
+        emitLocation(Tok);
         if (V->getType() != TheFunction->getReturnType())
         {
             error(Tok, "Return type of function `" + TheFunction->getName().str() + "` does not match function signature!\nExpected: " + typeToString(TheFunction->getReturnType()) + " but got: " + typeToString(V->getType()));
             return nullptr;
         }
-        return Builder.CreateRet(V);
+        return CS->Builder->CreateRet(V);
     };
 
     std::string to_string() const { return "Return: \n"; }
 
-    std::string to_tree(std::string prefix, bool end) const
+    void to_tree(std::string &out, const std::string &prefix, bool end) const
     {
-        std::string out = prefix + (end ? "└──" : "├── ") + this->to_string();
+        out += prefix + (end ? "└──" : "├── ") + this->to_string();
         if (!Val)
         { // checking for nullptr (nothing returned)
-            return out + prefix + (end ? "    " : "│   ") + "└──" + "NoRetVal\n";
+            out += prefix + (end ? "    " : "│   ") + "└──" + "NoRetVal\n";
         }
         else
         {
-            return out + Val->to_tree(prefix + (end ? "    " : "│   "), true);
+            Val->to_tree(out, prefix + (end ? "    " : "│   "), true);
+        }
+    }
+
+    void collectDeps(std::set<std::string> &Calls, std::set<std::string> &Vars) const
+    {
+        if (Val)
+        {
+            Val->collectDeps(Calls, Vars);
+        }
+    }
+
+    void collectEffects(Effects &E) const
+    {
+        if (Val)
+        {
+            Val->collectEffects(E);
         }
     }
 };
@@ -1004,12 +1381,55 @@ class CallASTnode : public ASTnode
     std::vector<std::unique_ptr<ASTnode>> Args;
 
 public:
+    static constexpr const char *Kind = "CallASTnode";
     CallASTnode(std::string callee, std::vector<std::unique_ptr<ASTnode>> args, TOKEN tok) : Callee(callee), Args(std::move(args)), Tok(tok) {}
     virtual ~CallASTnode() {}
+
+    // __likely and __unlikely become llvm.expect, and the branches on them are
+    // weighted (see createProfiledCondBr()), __assume becomes llvm.assume
+    Value *codegenBuiltin()
+    {
+        IRBuilder<> &B = *CS->Builder;
+        if (Args.size() != (Callee == "__unreachable" ? 0 : 1))
+        {
+            error(Tok, "Incorrect number of arguments passed to " + Callee);
+            return nullptr;
+        }
+        if (Callee == "__unreachable")
+        {
+            emitLocation(Tok);
+            Value *Unreachable = B.CreateUnreachable();
+            // anything after it is dead, and goes into a block nothing branches to
+            Function *TheFunction = B.GetInsertBlock()->getParent();
+            B.SetInsertPoint(BasicBlock::Create(*CS->TheContext, "unreachable.cont", TheFunction));
+            return Unreachable;
+        }
+
+        Value *V = Args[0]->codegen();
+        if (V->getType()->isVoidTy())
+        {
+            error(Tok, "Argument of " + Callee + " is void which cannot be used as a condition!");
+            return nullptr;
+        }
+        V = castToType(V, B.getInt1Ty(), Tok);
+        emitLocation(Tok);
+        if (Callee == "__assume")
+        {
+            return B.CreateAssumption(V);
+        }
+        Function *Expect = Intrinsic::getDeclaration(CS->TheModule.get(), Intrinsic::expect, {B.getInt1Ty()});
+        return B.CreateCall(Expect, {V, B.getInt1(Callee == "__likely")}, Callee == "__likely" ? "likely" : "unlikely");
+    }
+
     Value *codegen()
     {
+        if (isBuiltin(Callee))
+        {
+            return codegenBuiltin();
+        }
+
         // check if function exists
-        Function *CalleeF = TheModule->getFunction(Callee);
+        Function *CalleeF = CS->TheModule->getFunction(Callee);
         if (!CalleeF)
         {
             error(Tok, "Unknown function referenced");
@@ -1037,18 +1457,42 @@ public:
             ArgsV.push_back(argVal);
         }
 
-        return Builder.CreateCall(CalleeF, ArgsV, "calltmp");
+        emitLocation(Tok);
+        return CS->Builder->CreateCall(CalleeF, ArgsV, "calltmp");
     };
     std::string to_string() const { return "FuncCall: " + Callee + "\n"; }
 
-    std::string to_tree(std::string prefix, bool end) const
+    void to_tree(std::string &out, const std::string &prefix, bool end) const
     {
-        std::string out = prefix + (end ? "└── " : "├── ") + this->to_string();
+        out += prefix + (end ? "└── " : "├── ") + this->to_string();
         for (auto &a : Args)
         {
-            out += a->to_tree(prefix + (end ? "    " : "│   "), a == Args.back()); // only true when arg is last one
+            a->to_tree(out, prefix + (end ? "    " : "│   "), a == Args.back()); // only true when arg is last one
+        }
+    }
+
+    void collectDeps(std::set<std::string> &Calls, std::set<std::string> &Vars) const
+    {
+        if (!isBuiltin(Callee))
+        {
+            Calls.insert(Callee);
+        }
+        for (auto &a : Args)
+        {
+            a->collectDeps(Calls, Vars);
+        }
+    }
+
+    void collectEffects(Effects &E) const
+    {
+        if (!isBuiltin(Callee))
+        {
+            E.Calls.insert(Callee);
+        }
+        for (auto &a : Args)
+        {
+            a->collectEffects(E);
         }
-        return out;
     }
 };
 
@@ -1059,6 +1503,7 @@ class VarDeclASTnode : public ASTnode
     std::string Name;
 
 public:
+    static constexpr const char *Kind = "VarDeclASTnode";
     VarDeclASTnode(std::unique_ptr<TypeASTnode> type, std::string name, TOKEN tok) : Type(std::move(type)), Name(name), Tok(tok) {}
     virtual ~VarDeclASTnode() {}
     Value *codegen()
@@ -1067,22 +1512,23 @@ public:
         // re-declaration of a global variable within a local scope is allowed
 
         // check if global variable already exists
-        if (NamedValues.size() == 0)
+        if (CS->NamedValues.size() == 0)
         { // no local context available
-            if (GlobalNamedValues.find(Name) != GlobalNamedValues.end())
+            if (CS->GlobalNamedValues.find(Name) != CS->GlobalNamedValues.end())
             {
                 error(Tok, "Global variable `" + Name + "` already exists");
                 return nullptr;
             }
             // create global variable
-            GlobalNamedValues[Name] = new GlobalVariable(*TheModule, Type->getType(), false, GlobalValue::CommonLinkage, Constant::getNullValue(Type->getType()), Name);
-            return GlobalNamedValues[Name];
+            CS->GlobalNamedValues[Name] = new GlobalVariable(*CS->TheModule, Type->getType(), false, GlobalValue::CommonLinkage, Constant::getNullValue(Type->getType()), Name);
+            declareGlobal(CS->GlobalNamedValues[Name], Tok);
+            return CS->GlobalNamedValues[Name];
         }
 
-        Function *TheFunction = Builder.GetInsertBlock()->getParent();
+        Function *TheFunction = CS->Builder->GetInsertBlock()->getParent();
 
         // check if local variable already exists in CURRENT context
-        if (NamedValues.back().find(Name) != NamedValues.back().end())
+        if (CS->NamedValues.back().find(Name) != CS->NamedValues.back().end())
         {
             error(Tok, "Variable `" + Name + "` already exists in current context");
             return nullptr;
@@ -1090,16 +1536,28 @@ public:
 
         // create local variable
         AllocaInst *Alloca = CreateEntryBlockAlloca(TheFunction, Name, Type->getType());
-        NamedValues.back()[Name] = Alloca;
+        CS->NamedValues.back()[Name] = Alloca;
+        declareVariable(Alloca, Name, Tok);
         return Alloca;
     };
 
     std::string to_string() const { return "Decl: " + Name + "\n"; }
 
-    std::string to_tree(std::string prefix, bool end) const
+    void to_tree(std::string &out, const std::string &prefix, bool end) const
     {
-        std::string out = prefix + (end ? "└── " : "├── ") + this->to_string();
-        return out + Type->to_tree(prefix + (end ? "    " : "│   "), true);
+        out += prefix + (end ? "└── " : "├── ") + this->to_string();
+        Type->to_tree(out, prefix + (end ? "    " : "│   "), true);
+    }
+
+    std::string getName() const { return Name; }
+
+    Prototype getPrototype() const
+    {
+        Prototype P;
+        P.Name = Name;
+        P.Type = Type->Val;
+        P.IsFunction = false;
+        return P;
     }
 };
 
@@ -1109,6 +1567,7 @@ class ProgramASTnode : public ASTnode
     std::vector<std::unique_ptr<ASTnode>> decls;
 
 public:
+    static constexpr const char *Kind = "ProgramASTnode";
     ProgramASTnode(std::vector<std::unique_ptr<ExternASTnode>> externs, std::vector<std::unique_ptr<ASTnode>> decls) : externs(std::move(externs)), decls(std::move(decls)) {}
     virtual ~ProgramASTnode() {}
     Value *codegen()
@@ -1126,20 +1585,29 @@ public:
 
     std::string to_string() const { return "Program \n"; }
 
-    std::string to_tree(std::string prefix = "", bool end = true) const
+    std::string to_tree() const
+    {
+        std::string out;
+        to_tree(out, "", true);
+        return out;
+    }
+
+    void to_tree(std::string &out, const std::string &prefix, bool end) const
     {
-        std::string out = this->to_string();
+        out += this->to_string();
         std::string new_prefix = prefix + (end ? "    " : "│   ");
         for (auto &e : externs)
         {
-            out += e->to_tree(new_prefix, false);
+            e->to_tree(out, new_prefix, false);
         }
         for (auto &d : decls)
         {
-            out += d->to_tree(new_prefix, d == decls.back());
+            d->to_tree(out, new_prefix, d == decls.back());
         }
-        return out;
     }
+
+    const std::vector<std::unique_ptr<ExternASTnode>> &getExterns() const { return externs; }
+    const std::vector<std::unique_ptr<ASTnode>> &getDecls() const { return decls; }
 };
 
 class BlockASTnode : public ASTnode
@@ -1149,13 +1617,14 @@ class BlockASTnode : public ASTnode
     std::vector<std::unique_ptr<ASTnode>> stmt_list;
 
 public:
+    static constexpr const char *Kind = "BlockASTnode";
     BlockASTnode(std::vector<std::unique_ptr<ASTnode>> local_decls, std::vector<std::unique_ptr<ASTnode>> stmt_list, TOKEN tok) : local_decls(std::move(local_decls)), stmt_list(std::move(stmt_list)), Tok(tok) {}
     virtual ~BlockASTnode() {}
 
     Value *codegen()
     {
         // if 1 meaning this is the first block in the function, NamedValues[0] contains the parameters
-        if (NamedValues.size() == 1)
+        if (CS->NamedValues.size() == 1)
         {
             // copy parameters to the new local scope
             // any further added blocks will NOT have the parameters as 'local' variables so they can redeclare them
@@ -1163,17 +1632,18 @@ public:
             // additionally, blocks are not allowed to be used outside of functions
 
             // create new local context
-            NamedValues.push_back(std::map<std::string, AllocaInst *>());
+            CS->NamedValues.push_back(std::map<std::string, AllocaInst *>());
 
-            for (auto &p : NamedValues.front())
+            for (auto &p : CS->NamedValues.front())
             {
-                NamedValues.back()[p.first] = p.second;
+                CS->NamedValues.back()[p.first] = p.second;
             }
         }
         else
         {
             // create new local context
-            NamedValues.push_back(std::map<std::string, AllocaInst *>());
+            CS->NamedValues.push_back(std::map<std::string, AllocaInst *>());
+            beginBlockDebugInfo(Tok);
         }
 
         // generate code for local declarations
@@ -1184,34 +1654,59 @@ public:
         // generate code for statements
         for (auto &s : stmt_list)
         {
-            Value *val = s->codegen();
-            // check if statement is a return, if it is, then don't generate code for the rest of the block
-            if (val && isa<ReturnInst>(val))
+            s->codegen();
+            // check if statement returned (possibly in a nested block), if it did, then don't generate code for the rest of the block
+            if (CS->Builder->GetInsertBlock()->getTerminator())
             {
                 break;
             }
         }
 
         // clear local context
-        NamedValues.pop_back();
+        CS->NamedValues.pop_back();
+        if (CS->NamedValues.size() > 1)
+        {
+            endBlockDebugInfo();
+        }
         return nullptr;
     };
 
     std::string to_string() const { return "Block: \n"; }
 
-    std::string to_tree(std::string prefix, bool end) const
+    void to_tree(std::string &out, const std::string &prefix, bool end) const
     {
-        std::string out = prefix + (end ? "└── " : "├── ") + this->to_string();
+        out += prefix + (end ? "└── " : "├── ") + this->to_string();
         std::string new_prefix = prefix + (end ? "    " : "│   ");
         for (auto &l : local_decls)
         {
-            out += l->to_tree(new_prefix, false);
+            l->to_tree(out, new_prefix, false);
         }
         for (auto &s : stmt_list)
         {
-            out += s->to_tree(new_prefix, s == stmt_list.back());
+            s->to_tree(out, new_prefix, s == stmt_list.back());
+        }
+    }
+
+    void collectDeps(std::set<std::string> &Calls, std::set<std::string> &Vars) const
+    {
+        for (auto &s : stmt_list)
+        {
+            s->collectDeps(Calls, Vars);
         }
-        return out;
+    }
+
+    void collectEffects(Effects &E) const
+    {
+        E.Locals.emplace_back();
+        for (auto &l : local_decls)
+        {
+            E.Locals.back().insert(static_cast<VarDeclASTnode *>(l.get())->getName());
+        }
+        for (auto &s : stmt_list)
+        {
+            s->collectEffects(E);
+        }
+        E.Locals.pop_back();
     }
 };
 
@@ -1221,24 +1716,26 @@ class IdentASTnode : public ASTnode
     std::string Name;
 
 public:
+    static constexpr const char *Kind = "IdentASTnode";
     IdentASTnode(std::string name, TOKEN tok) : Name(name), Tok(tok) {}
     virtual ~IdentASTnode() {}
     Value *codegen()
     {
+        emitLocation(Tok);
         // check local contexts first
-        if (NamedValues.size() != 0)
+        if (CS->NamedValues.size() != 0)
         {
-            for (int i = NamedValues.size() - 1; i >= 0; i--)
+            for (int i = CS->NamedValues.size() - 1; i >= 0; i--)
             {
-                if (NamedValues[i].find(Name) != NamedValues[i].end())
+                if (CS->NamedValues[i].find(Name) != CS->NamedValues[i].end())
                 {
-                    return Builder.CreateLoad(NamedValues[i][Name]->getAllocatedType(), NamedValues[i][Name], Name.c_str());
+                    return CS->Builder->CreateLoad(CS->NamedValues[i][Name]->getAllocatedType(), CS->NamedValues[i][Name], Name.c_str());
                 }
             }
         }
-        if (GlobalNamedValues.find(Name) != GlobalNamedValues.end()) // check global context
+        if (CS->GlobalNamedValues.find(Name) != CS->GlobalNamedValues.end()) // check global context
         {
-            return Builder.CreateLoad(GlobalNamedValues[Name]->getValueType(), GlobalNamedValues[Name], Name.c_str());
+            return CS->Builder->CreateLoad(CS->GlobalNamedValues[Name]->getValueType(), CS->GlobalNamedValues[Name], Name.c_str());
         }
         error(Tok, "Unknown variable name: " + Name);
         return nullptr;
@@ -1246,9 +1743,22 @@ public:
 
     std::string to_string() const { return "Ident: " + Name + "\n"; }
 
-    std::string to_tree(std::string prefix, bool end) const
+    void to_tree(std::string &out, const std::string &prefix, bool end) const
     {
-        return prefix + (end ? "└── " : "├── ") + this->to_string();
+        out += prefix + (end ? "└── " : "├── ") + this->to_string();
+    }
+
+    void collectDeps(std::set<std::string> &Calls, std::set<std::string> &Vars) const
+    {
+        Vars.insert(Name);
+    }
+
+    void collectEffects(Effects &E) const
+    {
+        if (!E.isLocal(Name))
+        {
+            E.Reads.insert(Name);
+        }
     }
 };
 
@@ -1259,11 +1769,13 @@ class AssignASTnode : public ASTnode
     std::unique_ptr<ASTnode> Expr;
 
 public:
+    static constexpr const char *Kind = "AssignASTnode";
     AssignASTnode(std::string name, std::unique_ptr<ASTnode> expr, TOKEN tok) : Name(name), Expr(std::move(expr)), Tok(tok) {}
     virtual ~AssignASTnode() {}
     Value *codegen()
     {
         Value *val = Expr->codegen();
+        emitLocation(Tok);
         if (!val)
         {
             error(Tok, "Error in AssignASTnode::codegen(): val is nullptr");
@@ -1274,24 +1786,24 @@ public:
         }
 
         // check if local variable exists
-        if (NamedValues.size() != 0)
+        if (CS->NamedValues.size() != 0)
         {
-            for (int i = NamedValues.size() - 1; i >= 0; i--)
+            for (int i = CS->NamedValues.size() - 1; i >= 0; i--)
             {
-                if (NamedValues[i].find(Name) != NamedValues[i].end())
+                if (CS->NamedValues[i].find(Name) != CS->NamedValues[i].end())
                 {
                     // cast to correct type (will warn if narrowing conversion)
-                    val = castToType(val, NamedValues[i][Name]->getAllocatedType(), Tok);
-                    Builder.CreateStore(val, NamedValues[i][Name]);
+                    val = castToType(val, CS->NamedValues[i][Name]->getAllocatedType(), Tok);
+                    CS->Builder->CreateStore(val, CS->NamedValues[i][Name]);
                     return val;
                 }
             }
         }
-        if (GlobalNamedValues.find(Name) != GlobalNamedValues.end())
+        if (CS->GlobalNamedValues.find(Name) != CS->GlobalNamedValues.end())
         {
             // cast to correct type (will warn if narrowing conversion)
-            val = castToType(val, GlobalNamedValues[Name]->getValueType(), Tok);
-            Builder.CreateStore(val, GlobalNamedValues[Name]);
+            val = castToType(val, CS->GlobalNamedValues[Name]->getValueType(), Tok);
+            CS->Builder->CreateStore(val, CS->GlobalNamedValues[Name]);
             return val;
         }
         error(Tok, "Unknown variable name: " + Name);
@@ -1300,11 +1812,26 @@ public:
 
     std::string to_string() const { return "Assign: " + Name + "\n"; }
 
-    std::string to_tree(std::string prefix, bool end) const
+    void to_tree(std::string &out, const std::string &prefix, bool end) const
     {
-        std::string out = prefix + (end ? "└── " : "├── ") + this->to_string();
+        out += prefix + (end ? "└── " : "├── ") + this->to_string();
         std::string new_prefix = prefix + (end ? "    " : "│   ");
-        return out + Expr->to_tree(new_prefix, true);
+        Expr->to_tree(out, new_prefix, true);
+    }
+
+    void collectDeps(std::set<std::string> &Calls, std::set<std::string> &Vars) const
+    {
+        Vars.insert(Name);
+        Expr->collectDeps(Calls, Vars);
+    }
+
+    void collectEffects(Effects &E) const
+    {
+        if (!E.isLocal(Name))
+        {
+            E.Writes.insert(Name);
+        }
+        Expr->collectEffects(E);
     }
 };
 
@@ -0,0 +1,366 @@
+#ifndef ATTRIBUTES_HPP
+#define ATTRIBUTES_HPP
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+
+#include "llvm/IR/Function.h"
+#include "llvm/IR/InstrTypes.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/Path.h"
+
+#include "astnode.hpp"
+#include "mathlib.hpp"
+
+//===----------------------------------------------------------------------===//
+// Function attribute inference
+//===----------------------------------------------------------------------===//
+//
+// Before it is generated, every function is classified over the AST call
+// graph. The analysis asks whether the function reads or writes globals,
+// itself or through what it calls, and whether it may unwind, recurse or never
+// return. The results go on every definition and declaration of the function
+// as LLVM attributes. Calls to pure functions like cosine(x) can then be
+// CSE'd, hoisted or deleted at every -O level, in every module of
+// --incremental and --stream:
+//
+//   readnone    reads and writes no globals (memory(none) since LLVM 16)
+//   readonly    reads globals but writes none (memory(read))
+//   nounwind    calls nothing that may unwind
+//   norecurse   never calls itself again, directly or through other functions
+//   willreturn  has no loops and no recursion, and calls only what returns
+//
+// An extern function may do anything, unless a summary imported with
+// --import-summary says otherwise. --export-summary writes what was inferred
+// for the functions a file defines, so the files that declare them extern get
+// the same benefit:
+//
+//   mccomp-summary 1
+//   cosine readnone nounwind norecurse willreturn nocallback
+//
+// nocallback, only found in summaries, says a function calls nothing outside
+// its file, so it can't call back into the file that imports it.
+//
+// The math library functions of mathlib.hpp are known to be [[const]].
+//
+// What can't be inferred can be declared, on an extern or a definition:
+//
+//   extern [[cold]] int report(int code);
+//   extern [[const]] float cosine(float x);
+//   [[always_inline]] int square(int x) { ... }
+//
+//   [[const]]          reads and writes no memory, always returns: readnone
+//                      nounwind willreturn
+//   [[pure]]           reads but writes no memory: readonly nounwind willreturn
+//   [[hot]], [[cold]]  often and rarely called, calls to a cold function are
+//                      laid out of the way of the code around them
+//   [[inline]], [[always_inline]], [[noinline]]
+//                      inlinehint, alwaysinline and noinline, from -O1 on
+//   [[fast_math]]      -ffast-math for this function only, see fastmath.hpp
+//   [[target_clones("avx2", "default")]]
+//                      a version of the function for each target, picked
+//                      when the program is loaded, see multiversion.hpp
+//
+// The optimiser trusts [[const]] and [[pure]], a definition that does more is
+// warned about. Calls to a hot, cold or (no)inline function carry the same
+// hint, and summaries pass every declared attribute on.
+//
+// The inferred attributes are not set with -finstrument=profile or
+// -fprofile-generate, because every instrumented function writes its counters.
+
+static const char *SummaryMagic = "mccomp-summary 1";
+
+struct FunctionAttrs
+{
+  enum MemoryKind
+  {
+    None,
+    Read,
+    Write
+  } Memory = Write;
+  bool NoUnwind = false, NoRecurse = false, WillReturn = false, NoCallback = false;
+  // only ever declared, never inferred or passed on to callers
+  bool Hot = false, Cold = false, InlineHint = false, AlwaysInline = false, NoInline = false;
+
+  // as written in summaries
+  std::string to_string() const
+  {
+    std::string out = Memory == None ? " readnone" : Memory == Read ? " readonly" : "";
+    out += NoUnwind ? " nounwind" : "";
+    out += NoRecurse ? " norecurse" : "";
+    out += WillReturn ? " willreturn" : "";
+    out += NoCallback ? " nocallback" : "";
+    out += Hot ? " hot" : "";
+    out += Cold ? " cold" : "";
+    out += InlineHint ? " inlinehint" : "";
+    out += AlwaysInline ? " alwaysinline" : "";
+    out += NoInline ? " noinline" : "";
+    return out.empty() ? out : out.substr(1);
+  }
+};
+
+struct FunctionSummaries
+{
+  std::map<std::string, FunctionAttrs> Inferred; // the functions defined in this file
+  std::map<std::string, FunctionAttrs> Declared; // externs given [[attributes]]
+  std::map<std::string, FunctionAttrs> Imported; // from --import-summary
+  std::set<std::string> Globals;                 // declared so far
+  std::map<std::string, Intrinsic::ID> Intrinsics; // externs that are math library functions, see mathlib.hpp
+
+  // nullptr if nothing is known about Name
+  const FunctionAttrs *lookup(const std::string &Name) const
+  {
+    auto It = Inferred.find(Name);
+    if (It != Inferred.end())
+      return &It->second;
+    It = Declared.find(Name);
+    if (It != Declared.end())
+      return &It->second;
+    It = Imported.find(Name);
+    return It == Imported.end() ? nullptr : &It->second;
+  }
+};
+
+// returns an error message, or "" on success
+static std::string readSummary(const std::string &Path, std::map<std::string, FunctionAttrs> &Functions)
+{
+  std::ifstream in(Path);
+  if (!in)
+    return "could not read " + Path;
+  std::string Line;
+  if (!std::getline(in, Line) || Line != SummaryMagic)
+    return Path + " is not a function summary";
+  while (std::getline(in, Line))
+  {
+    std::istringstream Words(Line);
+    std::string Name, Word;
+    if (!(Words >> Name))
+      continue;
+    FunctionAttrs A;
+    while (Words >> Word)
+    {
+      if (Word == "readnone")
+        A.Memory = FunctionAttrs::None;
+      else if (Word == "readonly")
+        A.Memory = FunctionAttrs::Read;
+      else if (Word == "nounwind")
+        A.NoUnwind = true;
+      else if (Word == "norecurse")
+        A.NoRecurse = true;
+      else if (Word == "willreturn")
+        A.WillReturn = true;
+      else if (Word == "nocallback")
+        A.NoCallback = true;
+      else if (Word == "hot")
+        A.Hot = true;
+      else if (Word == "cold")
+        A.Cold = true;
+      else if (Word == "inlinehint")
+        A.InlineHint = true;
+      else if (Word == "alwaysinline")
+        A.AlwaysInline = true;
+      else if (Word == "noinline")
+        A.NoInline = true;
+      else
+        return Path + ": unknown attribute " + Word + " of " + Name;
+    }
+    Functions[Name] = A;
+  }
+  return "";
+}
+
+// add what [[Name]] says to A, false if there is no such attribute
+static bool declareAttribute(FunctionAttrs &A, const std::string &Name)
+{
+  if (Name == "const" || Name == "pure")
+  {
+    A.Memory = std::min(A.Memory, Name == "const" ? FunctionAttrs::None : FunctionAttrs::Read);
+    A.NoUnwind = A.WillReturn = true;
+  }
+  else if (Name == "hot")
+    A.Hot = true;
+  else if (Name == "cold")
+    A.Cold = true;
+  else if (Name == "inline")
+    A.InlineHint = true;
+  else if (Name == "always_inline")
+    A.AlwaysInline = true;
+  else if (Name == "noinline")
+    A.NoInline = true;
+  // fast_math and target_clones only change how the function is generated,
+  // see fastmath.hpp and multiversion.hpp
+  else if (Name != "fast_math" && Name != "target_clones")
+    return false;
+  return true;
+}
+
+// load the summaries of --import-summary, once per compile
+static void startAttributes()
+{
+  CS->Summaries = std::make_unique<FunctionSummaries>();
+  for (auto &Path : CS->Opts.ImportSummaries)
+  {
+    std::string Error = readSummary(Path, CS->Summaries->Imported);
+    if (!Error.empty())
+      error("Could not import summary: " + Error);
+  }
+}
+
+// classify a top-level declaration, before it is generated. A function can
+// only call the functions declared before it, so everything it calls is
+// already classified or extern, and only direct recursion needs looking for
+static void inferAttributes(const ASTnode &D)
+{
+  FunctionSummaries &S = *CS->Summaries;
+  if (D.isExtern())
+  {
+    auto &Extern = static_cast<const ExternASTnode &>(D);
+    Intrinsic::ID ID = mathIntrinsic(Extern.getPrototype());
+    if (ID != Intrinsic::not_intrinsic)
+      S.Intrinsics[Extern.getName()] = ID;
+    if (Extern.getAttributes().empty() && ID == Intrinsic::not_intrinsic)
+      return;
+    // what it is declared with, on top of anything imported
+    const FunctionAttrs *Imported = S.lookup(Extern.getName());
+    FunctionAttrs A = Imported ? *Imported : FunctionAttrs();
+    if (ID != Intrinsic::not_intrinsic)
+      declareAttribute(A, "const");
+    for (auto &Attr : Extern.getAttributes())
+      declareAttribute(A, attributeName(Attr));
+    S.Declared[Extern.getName()] = A;
+    return;
+  }
+  if (!D.isFunction())
+  {
+    S.Globals.insert(static_cast<const VarDeclASTnode &>(D).getName());
+    return;
+  }
+  auto &F = static_cast<const FunctionASTnode &>(D);
+  const std::string Name = F.getName();
+  Effects E;
+  F.collectEffects(E);
+  auto touches = [&S](const std::set<std::string> &Names)
+  {
+    for (auto &n : Names)
+      if (S.Globals.count(n))
+        return true;
+    return false;
+  };
+
+  FunctionAttrs A;
+  A.Memory = touches(E.Writes) ? FunctionAttrs::Write : touches(E.Reads) ? FunctionAttrs::Read : FunctionAttrs::None;
+  A.NoUnwind = A.NoCallback = true;
+  A.WillReturn = !E.Loops && !E.Calls.count(Name);
+  for (auto &Callee : E.Calls)
+  {
+    if (Callee == Name)
+      continue;
+    const FunctionAttrs *C = S.lookup(Callee);
+    FunctionAttrs Unknown;
+    if (!C)
+      C = &Unknown;
+    A.Memory = std::max(A.Memory, C->Memory);
+    A.NoUnwind &= C->NoUnwind;
+    A.WillReturn &= C->WillReturn;
+    // a function defined elsewhere may call back into this one
+    A.NoCallback &= C->NoCallback;
+  }
+  A.NoRecurse = A.NoCallback && !E.Calls.count(Name);
+
+  FunctionAttrs Inferred = A;
+  for (auto &Attr : F.getAttributes())
+  {
+    declareAttribute(A, attributeName(Attr));
+    if ((Attr == "const" && Inferred.Memory != FunctionAttrs::None) || (Attr == "pure" && Inferred.Memory == FunctionAttrs::Write))
+      addWarning(F.getTok(), "`" + Name + "` is declared [[" + Attr + "]] but may " +
+                                 (Inferred.Memory == FunctionAttrs::Write ? "write" : "read") + " global variables");
+  }
+  S.Inferred[Name] = A;
+}
+
+// --export-summary writes next to the output by default
+static std::string summaryPath()
+{
+  if (!CS->Opts.ExportSummaryFile.empty())
+    return CS->Opts.ExportSummaryFile;
+  SmallString<128> Path(CS->Opts.OutputFile.empty() ? "output" : CS->Opts.OutputFile);
+  sys::path::replace_extension(Path, "summary");
+  return Path.str().str();
+}
+
+static void writeSummary()
+{
+  std::string Path = summaryPath();
+  std::ofstream out(Path);
+  out << SummaryMagic << "\n";
+  for (auto &KV : CS->Summaries->Inferred)
+    out << KV.first << (KV.second.to_string().empty() ? "" : " ") << KV.second.to_string() << "\n";
+  if (!out)
+    error("Could not write summary " + Path);
+}
+
+// the attributes of Name, for the --incremental cache key of the functions
+// calling it
+static std::string attributeSignature(const std::string &Name)
+{
+  const FunctionAttrs *A = CS->Summaries ? CS->Summaries->lookup(Name) : nullptr;
+  return A ? A->to_string() : "";
+}
+
+// the [[hot]], [[cold]] and inlining hints of A
+static std::vector<Attribute::AttrKind> hintAttributes(const FunctionAttrs &A)
+{
+  std::vector<Attribute::AttrKind> Hints;
+  if (A.Hot)
+    Hints.push_back(Attribute::Hot);
+  if (A.Cold)
+    Hints.push_back(Attribute::Cold);
+  if (A.InlineHint)
+    Hints.push_back(Attribute::InlineHint);
+  if (A.AlwaysInline)
+    Hints.push_back(Attribute::AlwaysInline);
+  if (A.NoInline)
+    Hints.push_back(Attribute::NoInline);
+  return Hints;
+}
+
+// put what is known on every function defined or declared in M, and the
+// hints on every call to them
+static void setFunctionAttributes(Module &M)
+{
+  if (!CS->Summaries)
+    return;
+  bool Instrumented = CS->Opts.InstrumentProfile || CS->Opts.ProfileGenerate;
+  for (Function &F : M)
+  {
+    const FunctionAttrs *A = CS->Summaries->lookup(F.getName().str());
+    if (!A)
+      continue;
+    for (Attribute::AttrKind Hint : hintAttributes(*A))
+    {
+      F.addFnAttr(Hint);
+      for (User *U : F.users())
+        if (auto *Call = dyn_cast<CallBase>(U))
+          if (Call->getCalledFunction() == &F)
+            Call->addFnAttr(Hint);
+    }
+    if (Instrumented)
+      continue;
+    if (A->Memory == FunctionAttrs::None)
+      F.setDoesNotAccessMemory();
+    else if (A->Memory == FunctionAttrs::Read)
+      F.setOnlyReadsMemory();
+    if (A->NoUnwind)
+      F.setDoesNotThrow();
+    if (A->NoRecurse)
+      F.setDoesNotRecurse();
+    if (A->WillReturn)
+      F.setWillReturn();
+  }
+}
+
+#endif
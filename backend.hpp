@@ -0,0 +1,172 @@
+#ifndef BACKEND_HPP
+#define BACKEND_HPP
+
+#include "llvm/Config/llvm-config.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Module.h"
+#include "llvm/MC/MCSubtargetInfo.h"
+#include "llvm/MC/TargetRegistry.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/Target/TargetOptions.h"
+#include "llvm/TargetParser/Host.h"
+
+#include <algorithm>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "debuginfo.hpp"
+#include "pgo.hpp"
+#include "options.hpp"
+#include "token.hpp"
+
+using namespace llvm;
+
+//===----------------------------------------------------------------------===//
+// Object code emission
+//===----------------------------------------------------------------------===//
+
+// -march and -mcpu, native is the host's CPU
+static std::string targetCPU()
+{
+  const std::string &CPU = CS->Opts.CPU;
+  if (CPU.empty())
+    return "generic";
+  return CPU == "native" ? sys::getHostCPUName().str() : CPU;
+}
+
+// the host's features with -march=native, then those of -mattr, as
+// "+avx2,-avx512f,..."
+static std::string targetFeatures()
+{
+  std::vector<std::string> Features;
+  if (CS->Opts.CPU == "native")
+  {
+#if LLVM_VERSION_MAJOR >= 19
+    StringMap<bool> Host = sys::getHostCPUFeatures();
+#else
+    StringMap<bool> Host;
+    sys::getHostCPUFeatures(Host);
+#endif
+    for (auto &F : Host)
+      Features.push_back((F.second ? "+" : "-") + F.first().str());
+    // a StringMap is unordered, the string is part of the --incremental cache key
+    std::sort(Features.begin(), Features.end());
+  }
+  if (!CS->Opts.Features.empty())
+    Features.push_back(CS->Opts.Features);
+  std::string Joined;
+  for (auto &F : Features)
+    Joined += (Joined.empty() ? "" : ",") + F;
+  return Joined;
+}
+
+// whether -march, -mcpu or -mattr were given, otherwise the code is generated
+// for a generic CPU of the host's architecture
+static bool targetRequested()
+{
+  return !CS->Opts.CPU.empty() || !CS->Opts.Features.empty();
+}
+
+static TargetMachine *getTargetMachine()
+{
+  std::string CPU = targetCPU(), Features = targetFeatures();
+  // the target machine is kept between compiles, unless they target another CPU
+  if (CS->TheTargetMachine &&
+      (CS->TheTargetMachine->getTargetCPU() != CPU || CS->TheTargetMachine->getTargetFeatureString() != Features))
+    CS->TheTargetMachine.reset();
+  if (!CS->TheTargetMachine)
+  {
+    // the target registry is process wide
+    static std::once_flag Initialized;
+    std::call_once(Initialized, []
+                   {
+                     InitializeNativeTarget();
+                     InitializeNativeTargetAsmPrinter();
+                   });
+
+    std::string TargetTriple = sys::getDefaultTargetTriple();
+    std::string Err;
+    const Target *T = TargetRegistry::lookupTarget(TargetTriple, Err);
+    if (!T)
+      error("Could not find target " + TargetTriple + ": " + Err);
+
+    std::unique_ptr<MCSubtargetInfo> Subtarget(T->createMCSubtargetInfo(TargetTriple, "", ""));
+    if (!Subtarget->isCPUStringValid(CPU))
+      error("Unknown CPU " + CPU + " for target " + TargetTriple);
+
+    TargetOptions opt;
+    CS->TheTargetMachine.reset(T->createTargetMachine(TargetTriple, CPU, Features, opt, Reloc::PIC_));
+  }
+  return CS->TheTargetMachine.get();
+}
+
+// set the triple and data layout before codegen so the optimiser sees them
+static void configureModuleForTarget(Module &M)
+{
+  TargetMachine *TM = getTargetMachine();
+  M.setTargetTriple(TM->getTargetTriple().str());
+  M.setDataLayout(TM->createDataLayout());
+}
+
+// whether createModule() gives modules a triple and data layout, textual IR
+// is left target independent unless a CPU is asked for
+static bool modulesHaveTarget()
+{
+  return CS->Opts.Output == OutputKind::Object || CS->Opts.Output == OutputKind::JIT || targetRequested();
+}
+
+// the triple and data layout createModule() gives modules, "" if none
+static std::string moduleTarget()
+{
+  if (!modulesHaveTarget())
+    return "";
+  TargetMachine *TM = getTargetMachine();
+  return TM->getTargetTriple().str() + "|" + TM->createDataLayout().getStringRepresentation();
+}
+
+// every module the compiler generates code into is created here
+static std::unique_ptr<Module> createModule(StringRef Name, LLVMContext &Context)
+{
+  std::unique_ptr<Module> M = std::make_unique<Module>(Name, Context);
+  if (modulesHaveTarget())
+    configureModuleForTarget(*M);
+  startDebugInfo(*M);
+  startModuleProfile(*M);
+  return M;
+}
+
+// give every function defined in M the CPU and features of -march, -mcpu and
+// -mattr, which the optimiser's cost model and the code generator read per
+// function. A function that already has them keeps its own
+static void setTargetAttributes(Module &M)
+{
+  if (!targetRequested())
+    return;
+  std::string CPU = targetCPU(), Features = targetFeatures();
+  for (Function &F : M)
+  {
+    if (F.isDeclaration() || F.hasFnAttribute("target-cpu"))
+      continue;
+    F.addFnAttr("target-cpu", CPU);
+    if (!Features.empty())
+      F.addFnAttr("target-features", Features);
+  }
+}
+
+static void emitObject(Module &M, raw_pwrite_stream &out)
+{
+#if LLVM_VERSION_MAJOR >= 18
+  CodeGenFileType FileType = CodeGenFileType::ObjectFile;
+#else
+  CodeGenFileType FileType = CGFT_ObjectFile;
+#endif
+  legacy::PassManager PM;
+  if (getTargetMachine()->addPassesToEmitFile(PM, out, nullptr, FileType))
+    error("Target can't emit an object file");
+  PM.run(M);
+}
+
+#endif
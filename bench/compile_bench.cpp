@@ -0,0 +1,299 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// the whole compiler in this translation unit, so its phases can be run one
+// at a time
+#include "../libmccomp.cpp"
+#include "generator.hpp"
+
+//===----------------------------------------------------------------------===//
+// Compile throughput benchmark
+//===----------------------------------------------------------------------===//
+//
+// Measures the lexer, parser, code generator and IR/object emission one at a
+// time on a program from generator.hpp, in lines and MB of source per second.
+// Each benchmark runs until it has been timed for --min-time seconds; only
+// the phase itself is timed, whatever it needs (lexing for the parser, parsing
+// for codegen, ...) is redone untimed before each iteration.
+//
+//   make bench/compile_bench
+//   bench/compile_bench --functions=2000 --json=before.json
+//
+// --json writes the results in Google Benchmark's format, so two runs can be
+// compared with its tools/compare.py:
+//
+//   compare.py benchmarks before.json after.json
+
+using Clock = std::chrono::steady_clock;
+
+static double cpuSeconds()
+{
+  timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+struct BenchmarkResult
+{
+  std::string Name;
+  unsigned long long Iterations = 0;
+  double RealTime = 0, CPUTime = 0; // seconds, summed over iterations
+};
+
+// state of one iteration: starts the compiler over on the program
+class Iteration
+{
+  CompilerState State;
+  CurrentState Current;
+  FILE *In;
+
+public:
+  Clock::time_point Start;
+  double StartCPU = 0, Real = 0, CPU = 0;
+
+  Iteration(const std::string &Source, OutputKind Output) : Current(&State)
+  {
+    In = fmemopen(const_cast<char *>(Source.data()), Source.size(), "r");
+    State.Opts.Output = Output;
+    State.pFile = In;
+    resetLexer();
+    State.TheContext = std::make_unique<LLVMContext>();
+    State.Builder = std::make_unique<IRBuilder<>>(*State.TheContext);
+    State.TheModule = createModule("bench", *State.TheContext);
+  }
+
+  ~Iteration()
+  {
+    fclose(In);
+  }
+
+  void startTimer()
+  {
+    StartCPU = cpuSeconds();
+    Start = Clock::now();
+  }
+
+  void stopTimer()
+  {
+    Real += std::chrono::duration<double>(Clock::now() - Start).count();
+    CPU += cpuSeconds() - StartCPU;
+  }
+};
+
+// Body sets up and times one iteration
+static BenchmarkResult runBenchmark(const std::string &Name, double MinTime, const std::function<void(Iteration &)> &Body,
+                                    const std::string &Source, OutputKind Output = OutputKind::IR)
+{
+  BenchmarkResult R;
+  R.Name = Name;
+  // one untimed warm up iteration
+  {
+    Iteration It(Source, Output);
+    Body(It);
+  }
+  while (R.RealTime < MinTime || R.Iterations == 0)
+  {
+    Iteration It(Source, Output);
+    Body(It);
+    R.Iterations++;
+    R.RealTime += It.Real;
+    R.CPUTime += It.CPU;
+  }
+  return R;
+}
+
+static std::unique_ptr<ProgramASTnode> parse()
+{
+  getNextToken();
+  return parseProgram();
+}
+
+static bool option(const std::string &arg, const char *Name, std::string &Value)
+{
+  std::string prefix = std::string(Name) + "=";
+  if (arg.compare(0, prefix.size(), prefix) != 0)
+    return false;
+  Value = arg.substr(prefix.size());
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  GeneratorOptions Gen;
+  double MinTime = 0.5;
+  std::string JSONFile, SourceFile, Filter;
+  for (int i = 1; i < argc; i++)
+  {
+    std::string arg = argv[i], value;
+    if (option(arg, "--functions", value))
+      Gen.Functions = std::stoul(value);
+    else if (option(arg, "--statements", value))
+      Gen.Statements = std::stoul(value);
+    else if (option(arg, "--expr-depth", value))
+      Gen.ExprDepth = std::stoul(value);
+    else if (option(arg, "--nesting", value))
+      Gen.Nesting = std::stoul(value);
+    else if (option(arg, "--identifiers", value))
+      Gen.Identifiers = std::max(2ul, std::stoul(value));
+    else if (option(arg, "--seed", value))
+      Gen.Seed = std::stoull(value);
+    else if (option(arg, "--min-time", value))
+      MinTime = std::stod(value);
+    else if (option(arg, "--filter", value))
+      Filter = value;
+    else if (option(arg, "--json", value))
+      JSONFile = value;
+    else if (option(arg, "--emit-source", value))
+      SourceFile = value;
+    else
+    {
+      std::cerr << "Usage: compile_bench [--functions=n] [--statements=n] [--expr-depth=n] [--nesting=n]\n"
+                << "                     [--identifiers=n] [--seed=n] [--min-time=s] [--filter=substring]\n"
+                << "                     [--json=file] [--emit-source=file]\n";
+      return 1;
+    }
+  }
+
+  std::string Source = generateProgram(Gen);
+  size_t Lines = std::count(Source.begin(), Source.end(), '\n');
+  if (!SourceFile.empty())
+  {
+    FILE *f = fopen(SourceFile.c_str(), "w");
+    if (f == NULL)
+    {
+      perror("Could not open file");
+      return 1;
+    }
+    fwrite(Source.data(), 1, Source.size(), f);
+    fclose(f);
+  }
+
+  // the generated program must compile, or there is nothing to measure
+  {
+    CompilerInstance CI;
+    CompileResult R = CI.compileString(Source, CompilerOptions());
+    if (!R.Success)
+    {
+      std::cerr << "Generated program does not compile:\n" << R.Error;
+      return 1;
+    }
+  }
+
+  std::vector<std::pair<std::string, std::function<BenchmarkResult()>>> Benchmarks = {
+      {"BM_Lex", [&]
+       {
+         return runBenchmark("BM_Lex", MinTime, [](Iteration &It)
+                             {
+                               It.startTimer();
+                               lexAll();
+                               It.stopTimer();
+                             },
+                             Source);
+       }},
+      {"BM_Parse", [&]
+       {
+         return runBenchmark("BM_Parse", MinTime, [](Iteration &It)
+                             {
+                               lexAll();
+                               It.startTimer();
+                               std::unique_ptr<ProgramASTnode> tree = parse();
+                               It.stopTimer();
+                             },
+                             Source);
+       }},
+      {"BM_Codegen", [&]
+       {
+         return runBenchmark("BM_Codegen", MinTime, [](Iteration &It)
+                             {
+                               std::unique_ptr<ProgramASTnode> tree = parse();
+                               It.startTimer();
+                               tree->codegen();
+                               It.stopTimer();
+                             },
+                             Source);
+       }},
+      {"BM_EmitIR", [&]
+       {
+         return runBenchmark("BM_EmitIR", MinTime, [](Iteration &It)
+                             {
+                               parse()->codegen();
+                               std::string IR;
+                               raw_string_ostream out(IR);
+                               It.startTimer();
+                               CS->TheModule->print(out, nullptr);
+                               out.flush();
+                               It.stopTimer();
+                             },
+                             Source);
+       }},
+      {"BM_EmitObject", [&]
+       {
+         return runBenchmark("BM_EmitObject", MinTime, [](Iteration &It)
+                             {
+                               parse()->codegen();
+                               SmallVector<char, 0> Object;
+                               raw_svector_ostream out(Object);
+                               It.startTimer();
+                               emitObject(*CS->TheModule, out);
+                               It.stopTimer();
+                             },
+                             Source, OutputKind::Object);
+       }},
+  };
+
+  fprintf(stdout, "Program: %u functions, %zu lines, %.2f MB (seed %llu)\n", Gen.Functions, Lines,
+          Source.size() / 1e6, (unsigned long long)Gen.Seed);
+  fprintf(stdout, "%-16s %14s %14s %12s %14s %10s\n", "Benchmark", "Time", "CPU", "Iterations", "Lines/s", "MB/s");
+
+  std::vector<BenchmarkResult> Results;
+  for (auto &B : Benchmarks)
+  {
+    if (B.first.find(Filter) == std::string::npos)
+      continue;
+    BenchmarkResult R = B.second();
+    double Real = R.RealTime / R.Iterations, CPU = R.CPUTime / R.Iterations;
+    fprintf(stdout, "%-16s %11.3f ms %11.3f ms %12llu %14.0f %10.2f\n", R.Name.c_str(), Real * 1e3, CPU * 1e3,
+            R.Iterations, Lines / Real, Source.size() / Real / 1e6);
+    fflush(stdout);
+    Results.push_back(R);
+  }
+
+  if (!JSONFile.empty())
+  {
+    FILE *f = fopen(JSONFile.c_str(), "w");
+    if (f == NULL)
+    {
+      perror("Could not open file");
+      return 1;
+    }
+    char date[64];
+    time_t now = time(nullptr);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+    fprintf(f, "{\n  \"context\": {\n    \"date\": \"%s\",\n    \"executable\": \"%s\",\n", date, argv[0]);
+    fprintf(f, "    \"functions\": %u,\n    \"statements\": %u,\n    \"expr_depth\": %u,\n    \"nesting\": %u,\n",
+            Gen.Functions, Gen.Statements, Gen.ExprDepth, Gen.Nesting);
+    fprintf(f, "    \"identifiers\": %u,\n    \"seed\": %llu,\n    \"lines\": %zu,\n    \"bytes\": %zu\n  },\n",
+            Gen.Identifiers, (unsigned long long)Gen.Seed, Lines, Source.size());
+    fprintf(f, "  \"benchmarks\": [\n");
+    for (size_t i = 0; i < Results.size(); i++)
+    {
+      const BenchmarkResult &R = Results[i];
+      double Real = R.RealTime / R.Iterations, CPU = R.CPUTime / R.Iterations;
+      fprintf(f, "    {\n      \"name\": \"%s\",\n      \"run_name\": \"%s\",\n      \"run_type\": \"iteration\",\n",
+              R.Name.c_str(), R.Name.c_str());
+      fprintf(f, "      \"iterations\": %llu,\n      \"real_time\": %.6e,\n      \"cpu_time\": %.6e,\n      \"time_unit\": \"ms\",\n",
+              R.Iterations, Real * 1e3, CPU * 1e3);
+      fprintf(f, "      \"bytes_per_second\": %.6e,\n      \"items_per_second\": %.6e\n    }%s\n",
+              Source.size() / Real, Lines / Real, i + 1 < Results.size() ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+    fclose(f);
+  }
+  return 0;
+}
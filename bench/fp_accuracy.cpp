@@ -0,0 +1,225 @@
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../libmccomp.hpp"
+
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+
+//===----------------------------------------------------------------------===//
+// Floating point accuracy harness
+//===----------------------------------------------------------------------===//
+//
+// -ffast-math, -fassociative-math and -ffp-contract let the optimiser change
+// the results of float code (see fastmath.hpp). This compiles every test
+// program that computes a float twice in the JIT, once with strict IEEE
+// semantics and once with the options given, calls both over a grid of
+// inputs, and reports how many units in the last place (ULP) the relaxed
+// results are from the strict ones: the largest and mean error, and the
+// input of the largest.
+//
+//   make bench/fp_accuracy
+//   bench/fp_accuracy [-O0..-O3] [-ffast-math] [-fassociative-math] [-ffp-contract=fast|on|off]
+//                     [--filter=name] [--tests=dir] [--max-ulp=n]
+//
+// Both builds are at the same -O level (-O2 by default), so only the float
+// semantics differ. It fails if a result differs by more than --max-ulp, or if
+// one build returns NaN where the other does not.
+
+// the externs test programs call, quiet so they can be called in a loop
+extern "C" int print_int(int X)
+{
+  return 0;
+}
+
+extern "C" float print_float(float X)
+{
+  return 0;
+}
+
+struct Program
+{
+  const char *Test;     // tests/<Test>/<Test>.c
+  const char *Function; // the float function to call
+  std::vector<std::string> Inputs;
+  std::function<float(void *, size_t)> Call; // the result for Inputs[i]
+};
+
+// Count points from Low to High
+static std::vector<float> grid(float Low, float High, int Count)
+{
+  std::vector<float> Points;
+  for (int i = 0; i < Count; i++)
+    Points.push_back(Low + (High - Low) * i / (Count - 1));
+  return Points;
+}
+
+static const std::vector<float> CosineX = grid(-3.14159f, 3.14159f, 257);
+static const std::vector<float> UnaryM = grid(-4.0f, 4.0f, 65);
+
+// "<Name>=<x>" for every x
+static std::vector<std::string> names(const char *Name, const std::vector<float> &Xs)
+{
+  std::vector<std::string> Names;
+  char Text[64];
+  for (float x : Xs)
+  {
+    snprintf(Text, sizeof(Text), "%s=%g", Name, x);
+    Names.push_back(Text);
+  }
+  return Names;
+}
+
+// unary(n, m) for n from -3 to 3 and every m in UnaryM
+static std::vector<std::string> unaryNames()
+{
+  std::vector<std::string> Names;
+  for (int n = -3; n <= 3; n++)
+    for (auto &m : names("m", UnaryM))
+      Names.push_back("n=" + std::to_string(n) + " " + m);
+  return Names;
+}
+
+static const std::vector<Program> Programs = {
+    {"cosine", "cosine", names("x", CosineX),
+     [](void *F, size_t i) { return ((float (*)(float))F)(CosineX[i]); }},
+    {"pi", "pi", {"()"}, [](void *F, size_t) { return ((float (*)())F)(); }},
+    {"unary", "unary", unaryNames(),
+     [](void *F, size_t i) { return ((float (*)(int, float))F)(int(i / UnaryM.size()) - 3, UnaryM[i % UnaryM.size()]); }},
+};
+
+// floats in order as integers, so adjacent floats are one apart
+static int64_t ordered(float X)
+{
+  int32_t Bits;
+  memcpy(&Bits, &X, sizeof(Bits));
+  return Bits < 0 ? int64_t(INT32_MIN) - Bits : Bits;
+}
+
+static const uint64_t NaNError = UINT64_MAX;
+
+static uint64_t ulpError(float Strict, float Relaxed)
+{
+  if (std::isnan(Strict) || std::isnan(Relaxed))
+    return std::isnan(Strict) && std::isnan(Relaxed) ? 0 : NaNError;
+  int64_t D = ordered(Strict) - ordered(Relaxed);
+  return D < 0 ? -D : D;
+}
+
+// the address of Function in a JIT build of Source, nullptr on failure
+static void *compile(CompilerInstance &CI, CompileResult &R, const std::string &Source, const CompilerOptions &Opts,
+                     const char *Function)
+{
+  R = CI.compileFile(Source, Opts);
+  if (!R.Success)
+  {
+    std::cerr << Source << ": " << R.Error;
+    return nullptr;
+  }
+  auto Sym = R.JIT->lookup(Function);
+  if (!Sym)
+  {
+    llvm::consumeError(Sym.takeError());
+    return nullptr;
+  }
+#if LLVM_VERSION_MAJOR >= 15
+  return Sym->toPtr<void *>();
+#else
+  return (void *)Sym->getAddress();
+#endif
+}
+
+static bool option(const std::string &arg, const char *Name, std::string &Value)
+{
+  std::string prefix = std::string(Name) + "=";
+  if (arg.compare(0, prefix.size(), prefix) != 0)
+    return false;
+  Value = arg.substr(prefix.size());
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  CompilerOptions Relaxed;
+  Relaxed.Output = OutputKind::JIT;
+  Relaxed.OptLevel = 2;
+  uint64_t MaxULP = UINT64_MAX - 1;
+  std::string Tests = "tests", Filter, value;
+  for (int i = 1; i < argc; i++)
+  {
+    std::string arg = argv[i];
+    if (arg.size() == 3 && arg.compare(0, 2, "-O") == 0 && arg[2] >= '0' && arg[2] <= '3')
+      Relaxed.OptLevel = arg[2] - '0';
+    else if (arg == "-ffast-math")
+      Relaxed.FastMath = true;
+    else if (arg == "-fassociative-math")
+      Relaxed.AssociativeMath = true;
+    else if (option(arg, "-ffp-contract", value) && (value == "fast" || value == "on" || value == "off"))
+      Relaxed.FPContract = value;
+    else if (option(arg, "--filter", value))
+      Filter = value;
+    else if (option(arg, "--tests", value))
+      Tests = value;
+    else if (option(arg, "--max-ulp", value))
+      MaxULP = std::stoull(value);
+    else
+    {
+      std::cerr << "Usage: fp_accuracy [-O0..-O3] [-ffast-math] [-fassociative-math] [-ffp-contract=fast|on|off]\n"
+                   "                   [--filter=name] [--tests=dir] [--max-ulp=n]\n";
+      return 1;
+    }
+  }
+  CompilerOptions Strict;
+  Strict.Output = OutputKind::JIT;
+  Strict.OptLevel = Relaxed.OptLevel;
+
+  fprintf(stdout, "ULP error against strict IEEE semantics at -O%u\n", Relaxed.OptLevel);
+  fprintf(stdout, "%-12s %8s %10s %10s %10s  %s\n", "Program", "Inputs", "Differ", "Max ULP", "Mean ULP", "Worst input");
+
+  bool Failed = false;
+  for (const Program &P : Programs)
+  {
+    if (std::string(P.Test).find(Filter) == std::string::npos)
+      continue;
+    std::string Source = Tests + "/" + P.Test + "/" + P.Test + ".c";
+    CompilerInstance StrictCI, RelaxedCI;
+    CompileResult StrictR, RelaxedR;
+    void *StrictF = compile(StrictCI, StrictR, Source, Strict, P.Function);
+    void *RelaxedF = compile(RelaxedCI, RelaxedR, Source, Relaxed, P.Function);
+    if (!StrictF || !RelaxedF)
+    {
+      fprintf(stdout, "%-12s could not build %s\n", P.Test, P.Function);
+      Failed = true;
+      continue;
+    }
+
+    uint64_t Max = 0, Differ = 0;
+    double Total = 0;
+    size_t Worst = 0;
+    for (size_t i = 0; i < P.Inputs.size(); i++)
+    {
+      uint64_t Error = ulpError(P.Call(StrictF, i), P.Call(RelaxedF, i));
+      Differ += Error != 0;
+      Total += Error == NaNError ? 0 : double(Error);
+      if (Error > Max)
+      {
+        Max = Error;
+        Worst = i;
+      }
+    }
+    std::string MaxText = Max == NaNError ? "NaN" : std::to_string(Max);
+    fprintf(stdout, "%-12s %8zu %10llu %10s %10.2f  %s", P.Test, P.Inputs.size(), (unsigned long long)Differ,
+            MaxText.c_str(), Total / P.Inputs.size(), Max ? P.Inputs[Worst].c_str() : "-");
+    if (Max)
+      fprintf(stdout, " (%.9g, strict %.9g)", P.Call(RelaxedF, Worst), P.Call(StrictF, Worst));
+    fprintf(stdout, "\n");
+    Failed |= Max > MaxULP;
+  }
+  return Failed ? 1 : 0;
+}
@@ -0,0 +1,281 @@
+#ifndef GENERATOR_HPP
+#define GENERATOR_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//===----------------------------------------------------------------------===//
+// Synthetic MiniC program generator
+//===----------------------------------------------------------------------===//
+//
+// Generates valid programs (grammar.txt) of a given shape for the benchmarks.
+// The same options and seed always give the same program, on any platform, so
+// results can be compared between commits.
+//
+// Every function takes two ints and returns an int. Its body declares
+// Identifiers locals, half int and half float, followed by Statements
+// statements: assignments, calls of earlier functions, and if, while and
+// nested blocks (with locals of their own) down to Nesting levels deep.
+// Expressions are trees up to ExprDepth operators deep. Expressions are typed
+// so programs compile without narrowing warnings.
+
+struct GeneratorOptions
+{
+  unsigned Functions = 100;
+  unsigned Statements = 20;  // per function body, nested statements come on top
+  unsigned ExprDepth = 4;    // operators between an expression and its leaves
+  unsigned Nesting = 3;      // if/while/block nesting depth
+  unsigned Identifiers = 8;  // globals, and locals per scope
+  uint64_t Seed = 1;
+};
+
+class ProgramGenerator
+{
+  const GeneratorOptions &Opts;
+  uint64_t State;
+  std::string Out;
+  unsigned Function = 0; // index of the function being generated
+  // variables in scope, innermost scope last
+  std::vector<std::string> Ints, Floats;
+
+  // xorshift64*, rather than <random> whose distributions differ between
+  // standard libraries
+  unsigned next(unsigned n)
+  {
+    State ^= State >> 12;
+    State ^= State << 25;
+    State ^= State >> 27;
+    return unsigned((State * 2685821657736338717ULL) >> 33) % n;
+  }
+
+  void indent(unsigned Depth) { Out.append(2 * Depth, ' '); }
+
+  void intExpr(unsigned Depth)
+  {
+    unsigned choice = Depth == 0 ? next(2) : 2 + next(Function > 0 ? 4 : 3);
+    switch (choice)
+    {
+    case 0:
+      Out += Ints[next(Ints.size())];
+      break;
+    case 1:
+      Out += std::to_string(1 + next(100));
+      break;
+    case 2:
+    case 3:
+    {
+      // constant divisors that fold to zero are a compile error, so only
+      // divide by literals
+      static const char *Ops[] = {" + ", " - ", " * ", " / ", " % "};
+      unsigned op = next(5);
+      Out += "(";
+      intExpr(Depth - 1);
+      Out += Ops[op];
+      if (op >= 3)
+        Out += std::to_string(1 + next(100));
+      else
+        intExpr(Depth - 1);
+      Out += ")";
+      break;
+    }
+    case 4:
+      Out += "-(";
+      intExpr(Depth - 1);
+      Out += ")";
+      break;
+    default:
+      call(Depth - 1);
+    }
+  }
+
+  void floatExpr(unsigned Depth)
+  {
+    unsigned choice = Depth == 0 ? next(2) : 2 + next(3);
+    switch (choice)
+    {
+    case 0:
+      Out += Floats[next(Floats.size())];
+      break;
+    case 1:
+      Out += std::to_string(next(100)) + "." + std::to_string(next(10));
+      break;
+    case 2:
+    case 3:
+    {
+      static const char *Ops[] = {" + ", " - ", " * ", " / "};
+      unsigned op = next(4);
+      Out += "(";
+      floatExpr(Depth - 1);
+      Out += Ops[op];
+      if (op == 3)
+        Out += std::to_string(1 + next(100)) + ".5";
+      else
+        floatExpr(Depth - 1);
+      Out += ")";
+      break;
+    }
+    default:
+      Out += "-(";
+      floatExpr(Depth - 1);
+      Out += ")";
+    }
+  }
+
+  void boolExpr(unsigned Depth)
+  {
+    unsigned choice = Depth == 0 ? 0 : next(4);
+    switch (choice)
+    {
+    case 0:
+    {
+      static const char *Ops[] = {" < ", " <= ", " > ", " >= ", " == ", " != "};
+      intExpr(Depth / 2);
+      Out += Ops[next(6)];
+      intExpr(Depth / 2);
+      break;
+    }
+    case 1:
+    case 2:
+      Out += "(";
+      boolExpr(Depth - 1);
+      Out += next(2) ? " && " : " || ";
+      boolExpr(Depth - 1);
+      Out += ")";
+      break;
+    default:
+      Out += "!(";
+      boolExpr(Depth - 1);
+      Out += ")";
+    }
+  }
+
+  // call one of the functions generated so far
+  void call(unsigned Depth)
+  {
+    Out += "f" + std::to_string(next(Function)) + "(";
+    intExpr(Depth);
+    Out += ", ";
+    intExpr(Depth);
+    Out += ")";
+  }
+
+  // declare Identifiers locals named Prefix0, Prefix1, ... in the current scope
+  void locals(const std::string &Prefix, unsigned Depth)
+  {
+    for (unsigned i = 0; i < Opts.Identifiers; i++)
+    {
+      std::string Name = Prefix + std::to_string(i);
+      indent(Depth);
+      Out += (i % 2 ? "float " : "int ") + Name + ";\n";
+      (i % 2 ? Floats : Ints).push_back(Name);
+    }
+  }
+
+  void block(unsigned Depth, unsigned Statements)
+  {
+    size_t SavedInts = Ints.size(), SavedFloats = Floats.size();
+    Out += "{\n";
+    locals("b" + std::to_string(Depth) + "_", Depth + 1);
+    for (unsigned i = 0; i < Statements; i++)
+      statement(Depth + 1);
+    indent(Depth);
+    Out += "}";
+    Ints.resize(SavedInts);
+    Floats.resize(SavedFloats);
+  }
+
+  void statement(unsigned Depth)
+  {
+    // nested statements hold a few statements each, so programs grow
+    // linearly rather than exponentially with Nesting
+    unsigned choice = next(Depth <= Opts.Nesting ? 10 : 6);
+    indent(Depth);
+    switch (choice)
+    {
+    case 0:
+    case 1:
+    case 2:
+      Out += Ints[next(Ints.size())] + " = ";
+      intExpr(Opts.ExprDepth);
+      Out += ";\n";
+      break;
+    case 3:
+    case 4:
+      Out += Floats[next(Floats.size())] + " = ";
+      floatExpr(Opts.ExprDepth);
+      Out += ";\n";
+      break;
+    case 5:
+      if (Function > 0)
+        call(Opts.ExprDepth / 2);
+      else
+        Out += "print_int(" + Ints[next(Ints.size())] + ")";
+      Out += ";\n";
+      break;
+    case 6:
+    case 7:
+      Out += "if (";
+      boolExpr(Opts.ExprDepth);
+      Out += ") ";
+      block(Depth, 1 + next(3));
+      if (next(2))
+      {
+        Out += " else ";
+        block(Depth, 1 + next(3));
+      }
+      Out += "\n";
+      break;
+    case 8:
+      Out += "while (";
+      boolExpr(Opts.ExprDepth);
+      Out += ") ";
+      block(Depth, 1 + next(3));
+      Out += "\n";
+      break;
+    default:
+      block(Depth, 1 + next(3));
+      Out += "\n";
+    }
+  }
+
+public:
+  ProgramGenerator(const GeneratorOptions &Opts) : Opts(Opts), State(Opts.Seed * 0x9E3779B97F4A7C15ULL + 1) {}
+
+  std::string generate()
+  {
+    Out = "extern int print_int(int X);\n";
+    for (unsigned i = 0; i < Opts.Identifiers; i++)
+    {
+      Out += "int g" + std::to_string(i) + ";\n";
+      Ints.push_back("g" + std::to_string(i));
+    }
+    // at least one float in scope for float expressions
+    Out += "float h;\n";
+    Floats.push_back("h");
+
+    for (Function = 0; Function < Opts.Functions; Function++)
+    {
+      size_t SavedInts = Ints.size(), SavedFloats = Floats.size();
+      Out += "\nint f" + std::to_string(Function) + "(int p0, int p1) {\n";
+      Ints.push_back("p0");
+      Ints.push_back("p1");
+      locals("v", 1);
+      for (unsigned i = 0; i < Opts.Statements; i++)
+        statement(1);
+      Out += "  return ";
+      intExpr(Opts.ExprDepth);
+      Out += ";\n}\n";
+      Ints.resize(SavedInts);
+      Floats.resize(SavedFloats);
+    }
+    return std::move(Out);
+  }
+};
+
+static std::string generateProgram(const GeneratorOptions &Opts)
+{
+  return ProgramGenerator(Opts).generate();
+}
+
+#endif
@@ -0,0 +1,295 @@
+#include <dirent.h>
+#include <dlfcn.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../libmccomp.hpp"
+
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+
+//===----------------------------------------------------------------------===//
+// Runtime benchmark
+//===----------------------------------------------------------------------===//
+//
+// MiniC is a subset of C, so every test program can also be compiled by clang.
+// This builds each one (every directory in tests/ with a driver.cpp, as
+// tests/runner finds them) through mccomp, in the JIT at -O0 to -O3, and
+// through clang -O2 as a shared library, and times the function its driver
+// calls in both, to report how much slower mccomp's code runs than clang's.
+//
+//   make bench/runtime_bench
+//   bench/runtime_bench [--min-time=s] [--filter=name] [--cc=clang] [--tests=dir] [--jit-profiling]
+//
+// Each function is called a few times untimed to warm up (fault in its pages,
+// train the branch predictors), then in batches until it has been timed for
+// --min-time seconds; the time reported is the best batch, per call. The
+// calls and arguments are those of tests/<name>/driver.cpp: its call of
+// <name>_driver(n), or the call listed in EntryPoints for the drivers that
+// call something else. Programs that can't be timed, such as tests/infinite,
+// which never returns, are listed there too, and left out. With
+// --jit-profiling perf can name mccomp's functions, see jitprofiling.hpp.
+
+// the externs test programs call, quiet so they can be called in a loop
+extern "C" int print_int(int X)
+{
+  return 0;
+}
+
+extern "C" float print_float(float X)
+{
+  return 0;
+}
+
+// stops the compiler from dropping calls whose results are unused
+static volatile double Sink;
+
+struct Program
+{
+  std::string Test;     // tests/<Test>/<Test>.c
+  std::string Function; // the function the driver calls, "" if it is left out
+  std::function<void(void *)> Call;
+  std::string Why; // it is left out
+};
+
+// the programs whose drivers don't call <test>_driver(n), and those left out
+static const std::vector<Program> EntryPoints = {
+    {"addition", "addition", [](void *F) { Sink = ((int (*)(int, int))F)(6, 3); }},
+    {"assign", "assign", [](void *F) { Sink = ((int (*)())F)(); }},
+    {"associativity", "associativity", [](void *F) { Sink = ((int (*)())F)(); }},
+    {"builtins", "", nullptr, "calls MiniC's __likely, __unlikely, __assume and __unreachable, which C doesn't have"},
+    {"cosine", "cosine", [](void *F) { Sink = ((float (*)(float))F)(3.14159f); }},
+    {"factorial", "factorial", [](void *F) { Sink = ((int (*)(int))F)(10); }},
+    {"fibonacci", "fibonacci", [](void *F) { Sink = ((int (*)(int))F)(10); }},
+    {"funcattrs", "", nullptr, "calls report and cosine, which only its driver defines"},
+    {"global", "global", [](void *F) { Sink = ((int (*)())F)(); }},
+    {"implicit", "", nullptr, "not compiled by mccomp"},
+    {"infinite", "", nullptr, "never returns"},
+    {"lazyeval", "lazyeval_and", [](void *F) { Sink = ((int (*)(int))F)(1); }},
+    {"library", "library_driver", [](void *F) { Sink = ((int (*)(int))F)(10); }},
+    {"multiversion", "squares", [](void *F) { Sink = ((float (*)(int))F)(10); }},
+    {"palindrome", "palindrome", [](void *F) { Sink = ((bool (*)(int))F)(45677654); }},
+    {"perf", "hot_loop", [](void *F) { Sink = ((int (*)(int))F)(1000); }},
+    {"pi", "pi", [](void *F) { Sink = ((float (*)())F)(); }},
+    {"recurse", "recursion_driver", [](void *F) { Sink = ((int (*)(int))F)(20); }},
+    {"returns", "returns", [](void *F) { Sink = ((int (*)(int))F)(2); }},
+    {"rfact", "rfact", [](void *F) { Sink = ((int (*)(int))F)(10); }},
+    {"scope", "scope", [](void *F) { Sink = ((int (*)())F)(); }},
+    {"target", "squares", [](void *F) { Sink = ((float (*)(int))F)(10); }},
+    {"unary", "unary", [](void *F) { Sink = ((float (*)(int, float))F)(2, 3.0f); }},
+    {"unary2", "unary2", [](void *F) { Sink = ((int (*)())F)(); }},
+    {"void", "Void", [](void *F) { ((void (*)())F)(); }},
+    {"while", "foo", [](void *F) { Sink = ((int (*)(int))F)(2); }},
+};
+
+static std::string readFile(const std::string &Path)
+{
+  std::ifstream f(Path);
+  std::stringstream ss;
+  ss << f.rdbuf();
+  return ss.str();
+}
+
+// the entry point of tests/<Test>: listed in EntryPoints, or the driver's call
+// of <Test>_driver(n) with a constant n, which returns an int or a float
+static Program entryPoint(const std::string &Tests, const std::string &Test)
+{
+  for (const Program &P : EntryPoints)
+    if (P.Test == Test)
+      return P;
+
+  std::string Function = Test + "_driver";
+  std::string Driver = readFile(Tests + "/" + Test + "/driver.cpp");
+  for (size_t p = Driver.find(Function + "("); p != std::string::npos; p = Driver.find(Function + "(", p + 1))
+  {
+    const char *Args = Driver.c_str() + p + Function.size() + 1;
+    char *End;
+    long N = strtol(Args, &End, 10);
+    if (End == Args || *End != ')')
+      continue; // the declaration, or a call with a variable
+    std::string Source = readFile(Tests + "/" + Test + "/" + Test + ".c");
+    if (Source.find("float " + Function + "(") != std::string::npos)
+      return {Test, Function, [N](void *F) { Sink = ((float (*)(int))F)(N); }};
+    return {Test, Function, [N](void *F) { Sink = ((int (*)(int))F)(N); }};
+  }
+  return {Test, "", nullptr, "its driver calls neither " + Function + "(n) nor an entry point in EntryPoints"};
+}
+
+// every directory in Tests with a driver.cpp and a program, by name
+static std::vector<Program> discover(const std::string &Tests)
+{
+  std::vector<Program> Found;
+  DIR *d = opendir(Tests.c_str());
+  if (!d)
+    return Found;
+  while (struct dirent *e = readdir(d))
+  {
+    std::string Test = e->d_name, Dir = Tests + "/" + Test;
+    struct stat s;
+    if (Test[0] == '.' || stat((Dir + "/driver.cpp").c_str(), &s) != 0 || stat((Dir + "/" + Test + ".c").c_str(), &s) != 0)
+      continue;
+    Found.push_back(entryPoint(Tests, Test));
+  }
+  closedir(d);
+  std::sort(Found.begin(), Found.end(), [](const Program &A, const Program &B)
+            { return A.Test < B.Test; });
+  return Found;
+}
+
+using Clock = std::chrono::steady_clock;
+
+// seconds per call of F, the best of batches run for MinTime seconds in all
+static double timeCalls(const Program &P, void *F, double MinTime)
+{
+  for (int i = 0; i < 10; i++)
+    P.Call(F);
+  // grow the batch until it takes a millisecond, so the clock is not what is measured
+  unsigned long long Batch = 1;
+  double Best = 1e30, Total = 0;
+  while (Total < MinTime)
+  {
+    Clock::time_point Start = Clock::now();
+    for (unsigned long long i = 0; i < Batch; i++)
+      P.Call(F);
+    double Elapsed = std::chrono::duration<double>(Clock::now() - Start).count();
+    Total += Elapsed;
+    if (Elapsed < 1e-3 && Batch < (1ULL << 40))
+    {
+      Batch *= 2;
+      continue;
+    }
+    Best = std::min(Best, Elapsed / Batch);
+  }
+  return Best == 1e30 ? Total / Batch : Best;
+}
+
+// compile Source with the C compiler into a shared library and load it
+static void *loadReference(const std::string &CC, const std::string &Source, const std::string &Library)
+{
+  std::string Command = CC + " -O2 -shared -fPIC -w -x c -include stdbool.h " + Source + " -o " + Library;
+  if (system(Command.c_str()) != 0)
+    return nullptr;
+  // the library's externs resolve against this program's print_int and print_float
+  return dlopen(Library.c_str(), RTLD_NOW | RTLD_LOCAL);
+}
+
+static bool option(const std::string &arg, const char *Name, std::string &Value)
+{
+  std::string prefix = std::string(Name) + "=";
+  if (arg.compare(0, prefix.size(), prefix) != 0)
+    return false;
+  Value = arg.substr(prefix.size());
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  double MinTime = 0.2;
+  bool JITProfiling = false;
+  std::string CC = "clang", Tests = "tests", Filter, value;
+  for (int i = 1; i < argc; i++)
+  {
+    std::string arg = argv[i];
+    if (option(arg, "--min-time", value))
+      MinTime = std::stod(value);
+    else if (option(arg, "--filter", value))
+      Filter = value;
+    else if (option(arg, "--cc", value))
+      CC = value;
+    else if (option(arg, "--tests", value))
+      Tests = value;
+    else if (arg == "--jit-profiling")
+      JITProfiling = true;
+    else
+    {
+      std::cerr << "Usage: runtime_bench [--min-time=s] [--filter=name] [--cc=clang] [--tests=dir] [--jit-profiling]\n";
+      return 1;
+    }
+  }
+
+  std::vector<Program> Programs = discover(Tests);
+  if (Programs.empty())
+  {
+    std::cerr << "No tests found in " << Tests << "\n";
+    return 1;
+  }
+
+  std::string Library = "/tmp/mccomp-runtime-" + std::to_string(getpid()) + ".so";
+  fprintf(stdout, "Time per call, and slowdown relative to %s -O2\n", CC.c_str());
+  fprintf(stdout, "%-16s %12s %18s %18s %18s %18s\n", "Program", (CC + " -O2").c_str(), "mccomp -O0", "mccomp -O1",
+          "mccomp -O2", "mccomp -O3");
+
+  bool Failed = false;
+  for (const Program &P : Programs)
+  {
+    if (P.Test.find(Filter) == std::string::npos)
+      continue;
+    if (!P.Call)
+    {
+      fprintf(stdout, "%-16s left out, %s\n", P.Test.c_str(), P.Why.c_str());
+      continue;
+    }
+    std::string Source = Tests + "/" + P.Test + "/" + P.Test + ".c";
+
+    void *Handle = loadReference(CC, Source, Library);
+    void *Reference = Handle ? dlsym(Handle, P.Function.c_str()) : nullptr;
+    if (!Reference)
+    {
+      fprintf(stdout, "%-16s could not build %s with %s\n", P.Test.c_str(), P.Function.c_str(), CC.c_str());
+      Failed = true;
+      if (Handle)
+        dlclose(Handle);
+      continue;
+    }
+    double Base = timeCalls(P, Reference, MinTime);
+    dlclose(Handle);
+    fprintf(stdout, "%-16s %9.1f ns", P.Test.c_str(), Base * 1e9);
+    fflush(stdout);
+
+    for (unsigned Level = 0; Level <= 3; Level++)
+    {
+      CompilerInstance CI;
+      CompilerOptions Opts;
+      Opts.Output = OutputKind::JIT;
+      Opts.OptLevel = Level;
+      Opts.JITProfiling = JITProfiling;
+      CompileResult R = CI.compileFile(Source, Opts);
+      if (!R.Success)
+      {
+        fprintf(stdout, " %18s", "error");
+        std::cerr << P.Test << ": " << R.Error;
+        Failed = true;
+        continue;
+      }
+      auto Sym = R.JIT->lookup(P.Function);
+      if (!Sym)
+      {
+        llvm::consumeError(Sym.takeError());
+        fprintf(stdout, " %18s", "missing");
+        Failed = true;
+        continue;
+      }
+#if LLVM_VERSION_MAJOR >= 15
+      void *F = Sym->toPtr<void *>();
+#else
+      void *F = (void *)Sym->getAddress();
+#endif
+      double Time = timeCalls(P, F, MinTime);
+      fprintf(stdout, " %9.1f ns %5.2fx", Time * 1e9, Time / Base);
+      fflush(stdout);
+    }
+    fprintf(stdout, "\n");
+  }
+  remove(Library.c_str());
+  return Failed ? 1 : 0;
+}
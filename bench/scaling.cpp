@@ -0,0 +1,270 @@
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+//===----------------------------------------------------------------------===//
+// Asymptotic scaling suite
+//===----------------------------------------------------------------------===//
+//
+// Compiles pathological programs of size n, 2n, 4n, ... along one axis at a
+// time and fits the growth of compile time and peak memory to n^k. An axis
+// fails if k exceeds its limit, or if mccomp crashes, which at these sizes
+// means the stack ran out in one of the recursive parts of the compiler
+// (parser, codegen, AST dump, or destroying the tree).
+//
+//   make bench/scaling
+//   bench/scaling --mccomp=./mccomp
+//
+// Every size is compiled in a child process, timed by its user + system CPU
+// time, and measured by its peak RSS. The startup cost (LLVM, the empty
+// program) is measured the same way and subtracted, so the fit sees only
+// the part of the cost that depends on n.
+//
+// mccomp prints the AST as it compiles, and every line of the dump is indented
+// by its depth, so the dump of a tree n deep is n^2 characters long whatever
+// the compiler does. A long expression is such a tree (operators associate to
+// the left), as are nested blocks, so those two axes allow for n^2.
+
+struct Axis
+{
+  const char *Name;
+  const char *Description;
+  unsigned Base;       // the smallest n
+  double MaxExponent;  // of time and memory, unless overridden on the command line
+  std::function<std::string(unsigned)> Generate;
+};
+
+// one long expression: x + x - x + ...
+static std::string expressionProgram(unsigned n)
+{
+  std::string s = "int f(int x) {\n  return x";
+  for (unsigned i = 1; i < n; i++)
+    s += i % 2 ? " + x" : " - x";
+  return s + ";\n}\n";
+}
+
+// blocks nested n deep, each declaring a local and reading the parameter
+// through every scope in between
+static std::string nestingProgram(unsigned n)
+{
+  std::string s = "int f(int x) {\n";
+  for (unsigned i = 0; i < n; i++)
+    s += "{ int l" + std::to_string(i) + "; l" + std::to_string(i) + " = x;\n";
+  s.append(n, '}');
+  return s + "\nreturn x;\n}\n";
+}
+
+// n locals in one scope, each assigned from the one before
+static std::string localsProgram(unsigned n)
+{
+  std::string s = "int f(int x) {\n";
+  for (unsigned i = 0; i < n; i++)
+    s += "  int l" + std::to_string(i) + ";\n";
+  s += "  l0 = x;\n";
+  for (unsigned i = 1; i < n; i++)
+    s += "  l" + std::to_string(i) + " = l" + std::to_string(i - 1) + " + 1;\n";
+  return s + "  return l" + std::to_string(n - 1) + ";\n}\n";
+}
+
+// n functions, each calling the one before
+static std::string functionsProgram(unsigned n)
+{
+  std::string s = "int f0(int x) {\n  return x;\n}\n";
+  for (unsigned i = 1; i < n; i++)
+    s += "int f" + std::to_string(i) + "(int x) {\n  return f" + std::to_string(i - 1) + "(x) + 1;\n}\n";
+  return s;
+}
+
+struct Measurement
+{
+  std::string Error; // why the compile failed, empty if it did not
+  double CPU = 0;    // seconds
+  double RSS = 0;    // KB
+};
+
+// compile Source with mccomp in a child process
+static Measurement compile(const std::string &MCComp, const std::string &Source, const std::string &Dir)
+{
+  Measurement M;
+  std::string Input = Dir + "/scaling.c", Output = Dir + "/scaling.ll";
+  FILE *f = fopen(Input.c_str(), "w");
+  if (f == NULL)
+  {
+    M.Error = "could not write " + Input + ": " + strerror(errno);
+    return M;
+  }
+  fwrite(Source.data(), 1, Source.size(), f);
+  fclose(f);
+
+  fflush(stdout);
+  pid_t pid = fork();
+  if (pid == 0)
+  {
+    // the AST dump goes to stdout, diagnostics stay on stderr
+    if (!freopen("/dev/null", "w", stdout))
+      _exit(127);
+    execl(MCComp.c_str(), MCComp.c_str(), Input.c_str(), "-o", Output.c_str(), (char *)NULL);
+    perror(MCComp.c_str());
+    _exit(127);
+  }
+  int status;
+  struct rusage usage;
+  if (pid < 0 || wait4(pid, &status, 0, &usage) < 0)
+  {
+    M.Error = std::string("could not run mccomp: ") + strerror(errno);
+    return M;
+  }
+  M.CPU = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec * 1e-6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec * 1e-6;
+#ifdef __APPLE__
+  M.RSS = usage.ru_maxrss / 1024.0; // bytes on macOS
+#else
+  M.RSS = usage.ru_maxrss;
+#endif
+  if (WIFSIGNALED(status))
+  {
+    M.Error = std::string("crashed with ") + strsignal(WTERMSIG(status));
+    if (WTERMSIG(status) == SIGSEGV || WTERMSIG(status) == SIGBUS)
+      M.Error += ", most likely out of stack";
+  }
+  else if (WEXITSTATUS(status) != 0)
+    M.Error = "exited with status " + std::to_string(WEXITSTATUS(status));
+  return M;
+}
+
+// the cheapest of Repetitions compiles, the least disturbed by the rest of the machine
+static Measurement measure(const std::string &MCComp, const std::string &Source, const std::string &Dir, unsigned Repetitions)
+{
+  Measurement Best;
+  for (unsigned i = 0; i < Repetitions; i++)
+  {
+    Measurement M = compile(MCComp, Source, Dir);
+    if (!M.Error.empty())
+      return M;
+    if (i == 0 || M.CPU < Best.CPU)
+      Best.CPU = M.CPU;
+    if (i == 0 || M.RSS < Best.RSS)
+      Best.RSS = M.RSS;
+  }
+  return Best;
+}
+
+// least squares slope of log(y) over log(x), k in y = c * x^k
+static double exponent(const std::vector<double> &x, const std::vector<double> &y)
+{
+  double sx = 0, sy = 0, sxx = 0, sxy = 0;
+  size_t n = x.size();
+  for (size_t i = 0; i < n; i++)
+  {
+    double lx = std::log(x[i]), ly = std::log(y[i]);
+    sx += lx;
+    sy += ly;
+    sxx += lx * lx;
+    sxy += lx * ly;
+  }
+  return (n * sxy - sx * sy) / (n * sxx - sx * sx);
+}
+
+static bool option(const std::string &arg, const char *Name, std::string &Value)
+{
+  std::string prefix = std::string(Name) + "=";
+  if (arg.compare(0, prefix.size(), prefix) != 0)
+    return false;
+  Value = arg.substr(prefix.size());
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  std::vector<Axis> Axes = {
+      {"expression", "operators in one expression", 1000, 2.3, expressionProgram},
+      {"nesting", "nested blocks", 500, 2.3, nestingProgram},
+      {"locals", "locals in one scope", 1000, 1.3, localsProgram},
+      {"functions", "functions in one file", 500, 1.3, functionsProgram},
+  };
+  std::string MCComp = "./mccomp", Filter, Dir = "/tmp", value;
+  unsigned Steps = 4, Repetitions = 3;
+  double Scale = 1, MaxExponent = 0;
+  for (int i = 1; i < argc; i++)
+  {
+    std::string arg = argv[i];
+    if (option(arg, "--mccomp", value))
+      MCComp = value;
+    else if (option(arg, "--axis", value))
+      Filter = value;
+    else if (option(arg, "--steps", value))
+      Steps = std::max(2ul, std::stoul(value));
+    else if (option(arg, "--scale", value))
+      Scale = std::stod(value);
+    else if (option(arg, "--repetitions", value))
+      Repetitions = std::max(1ul, std::stoul(value));
+    else if (option(arg, "--max-exponent", value))
+      MaxExponent = std::stod(value);
+    else if (option(arg, "--tmp", value))
+      Dir = value;
+    else
+    {
+      std::cerr << "Usage: scaling [--mccomp=path] [--axis=name] [--steps=n] [--scale=factor] [--repetitions=n]\n"
+                << "               [--max-exponent=k] [--tmp=dir]\n";
+      return 1;
+    }
+  }
+
+  Measurement Startup = measure(MCComp, "", Dir, Repetitions);
+  if (!Startup.Error.empty())
+  {
+    std::cerr << "mccomp " << Startup.Error << " on an empty program\n";
+    return 1;
+  }
+  fprintf(stdout, "Startup: %.3f s, %.0f KB\n", Startup.CPU, Startup.RSS);
+
+  bool Passed = true;
+  for (Axis &A : Axes)
+  {
+    if (!Filter.empty() && Filter != A.Name)
+      continue;
+    double Limit = MaxExponent > 0 ? MaxExponent : A.MaxExponent;
+    fprintf(stdout, "\n%s: %s\n%12s %12s %12s\n", A.Name, A.Description, "n", "Time (s)", "Memory (KB)");
+    std::vector<double> N, Time, Memory;
+    bool Failed = false;
+    for (unsigned i = 0; i < Steps; i++)
+    {
+      unsigned n = unsigned(A.Base * Scale) << i;
+      Measurement M = measure(MCComp, A.Generate(n), Dir, Repetitions);
+      if (!M.Error.empty())
+      {
+        fprintf(stdout, "%12u  mccomp %s\n", n, M.Error.c_str());
+        Failed = true;
+        break;
+      }
+      // never below a millisecond or a page, so the logarithms stay finite
+      N.push_back(n);
+      Time.push_back(std::max(M.CPU - Startup.CPU, 1e-3));
+      Memory.push_back(std::max(M.RSS - Startup.RSS, 4.0));
+      fprintf(stdout, "%12u %12.3f %12.0f\n", n, M.CPU, M.RSS);
+      fflush(stdout);
+    }
+    if (!Failed)
+    {
+      double TimeExponent = exponent(N, Time), MemoryExponent = exponent(N, Memory);
+      Failed = TimeExponent > Limit || MemoryExponent > Limit;
+      fprintf(stdout, "time ~ n^%.2f, memory ~ n^%.2f, limit n^%.2f\n", TimeExponent, MemoryExponent, Limit);
+    }
+    fprintf(stdout, "%s %s\n", A.Name, Failed ? "FAILED" : "ok");
+    Passed &= !Failed;
+  }
+  remove((Dir + "/scaling.c").c_str());
+  remove((Dir + "/scaling.ll").c_str());
+
+  fprintf(stdout, Passed ? "\nPASSED\n" : "\nFAILED\n");
+  return Passed ? 0 : 1;
+}
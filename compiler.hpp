@@ -0,0 +1,102 @@
+#ifndef COMPILER_HPP
+#define COMPILER_HPP
+
+#include <cstdio>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Target/TargetMachine.h"
+
+#include "options.hpp"
+
+using namespace llvm;
+
+//===----------------------------------------------------------------------===//
+// Compiler state
+//===----------------------------------------------------------------------===//
+//
+// Everything the lexer, parser and code generator keep between calls. Each
+// CompilerInstance (libmccomp.hpp) owns one, and CS points at the state of the
+// instance compiling on the current thread, so separate instances can compile
+// concurrently on separate threads. Included from token.hpp once TOKEN is
+// defined.
+
+class TokenRing;
+struct PhaseTimers;
+struct CompileStats;
+struct DebugInfo;
+struct ProfileData;
+struct RemarkState;
+struct FunctionSummaries;
+
+struct CompilerState
+{
+  CompilerOptions Opts;
+
+  // lexer
+  FILE *pFile = nullptr;
+  std::string IdentifierStr; // Filled in if IDENT
+  int IntVal;                // Filled in if INT_LIT
+  bool BoolVal;              // Filled in if BOOL_LIT
+  float FloatVal;            // Filled in if FLOAT_LIT
+  std::string StringVal;     // Filled in if String Literal
+  int lineNo, columnNo;
+  int LastChar = ' ';
+  int NextChar = ' ';
+  unsigned long long TokensLexed = 0; // for --stats
+
+  // parser, see getNextToken()
+  TOKEN CurTok;
+  std::deque<TOKEN> tok_buffer;
+  bool RecordTokens = false;
+  std::string RecordedTokens;
+  size_t LastTokenOffset = 0;  // offset of the most recently lexed token
+  TOKEN LastRecordedToken{};   // the most recently lexed token
+  int RecordedFromLine = 0;    // the recorded lines are relative to this one, see resetRecordedTokens()
+  TokenRing *Tokens = nullptr; // where tokens come from with --pipeline, see TokenRing
+  std::deque<TOKEN> Lexed;     // tokens lexed ahead by lexAll(), taken before calling gettok()
+
+  std::vector<std::string> warnings; // and -Rpass remarks, added through addWarningText()
+  std::mutex WarningsLock;           // the parser and codegen threads both add warnings with --pipeline
+
+  // code generation, a new context is made for every compile so that the
+  // generated module can be handed over to the caller together with it
+  std::unique_ptr<LLVMContext> TheContext;
+  std::unique_ptr<IRBuilder<>> Builder;
+  std::unique_ptr<Module> TheModule;
+  std::vector<std::map<std::string, AllocaInst *>> NamedValues; // local var tables, cleared at end of blocks
+  std::map<std::string, GlobalVariable *> GlobalNamedValues;    // global var table
+  std::unique_ptr<DebugInfo> Debug;                             // with -g, debug info for TheModule, see debuginfo.hpp
+  std::unique_ptr<ProfileData> Profile;                         // with -fprofile-generate or -use, see pgo.hpp
+  std::unique_ptr<FunctionSummaries> Summaries;                 // inferred and imported attributes, see attributes.hpp
+
+  // created on first use and kept for the life of the instance, so repeated
+  // compiles (--watch, the compile server) don't pay for target initialisation
+  std::unique_ptr<TargetMachine> TheTargetMachine;
+
+  std::unique_ptr<PhaseTimers> Timers; // with -ftime-report, see timing.hpp
+  std::unique_ptr<CompileStats> Stats; // with --stats, see stats.hpp
+  std::unique_ptr<RemarkState> Remarks; // with -Rpass or -fsave-optimization-record, see remarks.hpp
+};
+
+static thread_local CompilerState *CS = nullptr;
+
+// makes State the compiler state of the current thread for its lifetime
+class CurrentState
+{
+  CompilerState *Saved;
+
+public:
+  CurrentState(CompilerState *State) : Saved(CS) { CS = State; }
+  ~CurrentState() { CS = Saved; }
+};
+
+#endif
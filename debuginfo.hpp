@@ -0,0 +1,177 @@
+#ifndef DEBUGINFO_HPP
+#define DEBUGINFO_HPP
+
+#include <string>
+#include <vector>
+
+#include "llvm/BinaryFormat/Dwarf.h"
+#include "llvm/IR/DIBuilder.h"
+#include "llvm/IR/DebugInfoMetadata.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/FileSystem.h"
+
+#include "remarks.hpp"
+#include "token.hpp"
+
+//===----------------------------------------------------------------------===//
+// Debug information
+//===----------------------------------------------------------------------===//
+//
+// With -g every module gets a compile unit for the input file, every function
+// a subprogram, every block a lexical block, every parameter, local and global
+// variable a descriptor, and every instruction the line and column of the
+// token of the AST node that generated it, so debuggers and profilers (perf,
+// callgrind, ...) can map the generated code back to MiniC source lines.
+//
+// createModule() starts the debug info of each new module and lowerModule()
+// finishes it, so whichever path a module takes through the compiler (whole
+// program, --incremental, --stream, --pipeline) it is complete before it is
+// verified and optimised. --incremental links modules that each have their
+// own compile unit, mergeCompileUnits() leaves the linked module with one.
+// Everything here does nothing without -g, except that optimisation remarks
+// (remarks.hpp) get the locations of instructions from a compile unit that
+// emits no debug info.
+
+struct DebugInfo
+{
+  DIBuilder Builder;
+  DICompileUnit *Unit;
+  DIFile *File;
+  std::vector<DIScope *> Scopes; // the function being generated and its open blocks, innermost last
+  bool LocationsOnly;            // for remarks without -g, no variables or types
+
+  DebugInfo(Module &M, const std::string &InputFile, bool LocationsOnly) : Builder(M), LocationsOnly(LocationsOnly)
+  {
+    // the path as given and the working directory, as clang does, so
+    // assemblers see the file in the compile unit's directory
+    SmallString<128> Directory;
+    sys::fs::current_path(Directory);
+    File = Builder.createFile(InputFile.empty() ? "<stdin>" : InputFile, Directory);
+    // MiniC is a subset of C99
+    Unit = Builder.createCompileUnit(dwarf::DW_LANG_C99, File, "mccomp", CS->Opts.OptLevel > 0, "", 0, "",
+                                     LocationsOnly ? DICompileUnit::NoDebug : DICompileUnit::FullDebug);
+    M.addModuleFlag(Module::Warning, "Debug Info Version", DEBUG_METADATA_VERSION);
+  }
+
+  // nullptr for void
+  DIType *getType(Type *T)
+  {
+    if (T->isIntegerTy(32))
+      return Builder.createBasicType("int", 32, dwarf::DW_ATE_signed);
+    if (T->isIntegerTy(1))
+      return Builder.createBasicType("bool", 8, dwarf::DW_ATE_boolean);
+    if (T->isFloatTy())
+      return Builder.createBasicType("float", 32, dwarf::DW_ATE_float);
+    return nullptr;
+  }
+
+  DISubroutineType *getFunctionType(FunctionType *FT)
+  {
+    SmallVector<Metadata *, 8> Types;
+    Types.push_back(getType(FT->getReturnType()));
+    for (Type *T : FT->params())
+      Types.push_back(getType(T));
+    return Builder.createSubroutineType(Builder.getOrCreateTypeArray(Types));
+  }
+};
+
+static void startDebugInfo(Module &M)
+{
+  CS->Debug.reset();
+  if (CS->Opts.Debug || remarksRequested())
+    CS->Debug = std::make_unique<DebugInfo>(M, CS->Opts.InputFile, !CS->Opts.Debug);
+}
+
+static void finishDebugInfo()
+{
+  if (CS->Debug)
+    CS->Debug->Builder.finalize();
+}
+
+// move every function linked into M from another module's compile unit to
+// M's own, so the program is one compile unit as without --incremental
+static void mergeCompileUnits(Module &M)
+{
+  if (!CS->Debug)
+    return;
+  DICompileUnit *Unit = CS->Debug->Unit;
+  for (Function &F : M)
+  {
+    DISubprogram *SP = F.getSubprogram();
+    if (SP && SP->getUnit() != Unit)
+      SP->replaceUnit(Unit);
+  }
+  NamedMDNode *Units = M.getOrInsertNamedMetadata("llvm.dbg.cu");
+  Units->clearOperands();
+  Units->addOperand(Unit);
+}
+
+// the code generated from here on comes from Tok
+static void emitLocation(const TOKEN &Tok)
+{
+  if (!CS->Debug || CS->Debug->Scopes.empty())
+    return;
+  CS->Builder->SetCurrentDebugLocation(DILocation::get(*CS->TheContext, Tok.lineNo, Tok.columnNo, CS->Debug->Scopes.back()));
+}
+
+static void beginFunctionDebugInfo(Function *F, const TOKEN &Tok)
+{
+  if (!CS->Debug)
+    return;
+  DebugInfo &D = *CS->Debug;
+  DISubprogram *SP = D.Builder.createFunction(D.File, F->getName(), StringRef(), D.File, Tok.lineNo,
+                                              D.getFunctionType(F->getFunctionType()), Tok.lineNo, DINode::FlagPrototyped,
+                                              DISubprogram::SPFlagDefinition);
+  F->setSubprogram(SP);
+  D.Scopes.assign(1, SP);
+  emitLocation(Tok);
+}
+
+static void endFunctionDebugInfo()
+{
+  if (!CS->Debug)
+    return;
+  CS->Debug->Scopes.clear();
+  // nothing generated outside a function may carry a location inside it
+  CS->Builder->SetCurrentDebugLocation(DebugLoc());
+}
+
+// blocks nested in a function, its body is the subprogram's own scope
+static void beginBlockDebugInfo(const TOKEN &Tok)
+{
+  if (!CS->Debug || CS->Debug->Scopes.empty())
+    return;
+  DebugInfo &D = *CS->Debug;
+  D.Scopes.push_back(D.Builder.createLexicalBlock(D.Scopes.back(), D.File, Tok.lineNo, Tok.columnNo));
+}
+
+static void endBlockDebugInfo()
+{
+  if (CS->Debug && CS->Debug->Scopes.size() > 1)
+    CS->Debug->Scopes.pop_back();
+}
+
+// describe a parameter (ArgNo counts from 1) or local variable held in Alloca
+static void declareVariable(AllocaInst *Alloca, const std::string &Name, const TOKEN &Tok, unsigned ArgNo = 0)
+{
+  if (!CS->Debug || CS->Debug->LocationsOnly || CS->Debug->Scopes.empty())
+    return;
+  DebugInfo &D = *CS->Debug;
+  DIScope *Scope = D.Scopes.back();
+  DIType *Ty = D.getType(Alloca->getAllocatedType());
+  DILocalVariable *Var = ArgNo ? D.Builder.createParameterVariable(Scope, Name, ArgNo, D.File, Tok.lineNo, Ty, true)
+                               : D.Builder.createAutoVariable(Scope, Name, D.File, Tok.lineNo, Ty, true);
+  D.Builder.insertDeclare(Alloca, Var, D.Builder.createExpression(),
+                          DILocation::get(*CS->TheContext, Tok.lineNo, Tok.columnNo, Scope), CS->Builder->GetInsertBlock());
+}
+
+static void declareGlobal(GlobalVariable *G, const TOKEN &Tok)
+{
+  if (!CS->Debug || CS->Debug->LocationsOnly)
+    return;
+  DebugInfo &D = *CS->Debug;
+  G->addDebugInfo(D.Builder.createGlobalVariableExpression(D.Unit, G->getName(), StringRef(), D.File, Tok.lineNo,
+                                                           D.getType(G->getValueType()), false));
+}
+
+#endif
@@ -0,0 +1,114 @@
+#ifndef FASTMATH_HPP
+#define FASTMATH_HPP
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "llvm/IR/Function.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Intrinsics.h"
+#include "llvm/IR/Operator.h"
+
+#include "token.hpp"
+
+//===----------------------------------------------------------------------===//
+// Floating point semantics
+//===----------------------------------------------------------------------===//
+//
+// By default float arithmetic follows IEEE 754 strictly: it is not
+// reassociated, a multiply and an add are never fused, and NaNs, infinities
+// and the sign of zero are kept. The optimiser can't vectorise a float
+// reduction like cosine's series, or fold x * 0.0 to 0.0. Three options, and
+// an attribute, relax that, by setting fast-math flags on every float
+// instruction (and call) the builder creates:
+//
+//   -ffast-math          fast on everything: reassoc nnan ninf nsz arcp
+//                        contract afn, and the unsafe-fp-math function
+//                        attributes the code generator reads
+//   -fassociative-math   reassoc only, so sums and products can be reordered
+//                        and reductions vectorised
+//   -ffp-contract=on     a*b+c and a*b-c within one expression become
+//                        llvm.fmuladd, an FMA where the target has one
+//   -ffp-contract=fast   contract, so a multiply and add can be fused
+//                        anywhere, across statements too
+//   -ffp-contract=off    never fuse (default)
+//
+//   [[fast_math]] float norm(float x, float y) { ... }
+//
+// gives one function -ffast-math. Results change in the last bits, or more
+// where the program relies on NaN, infinities or signed zeros;
+// bench/fp_accuracy measures how far from strict mode each test program moves.
+
+// the flags of the code of a function with these [[attributes]]
+static FastMathFlags fastMathFlags(const std::vector<std::string> &Attrs)
+{
+  const CompilerOptions &O = CS->Opts;
+  FastMathFlags FMF;
+  if (O.FastMath || std::find(Attrs.begin(), Attrs.end(), "fast_math") != Attrs.end())
+    FMF.setFast();
+  if (O.AssociativeMath)
+    FMF.setAllowReassoc();
+  if (O.FPContract == "fast")
+    FMF.setAllowContract();
+  return FMF;
+}
+
+// before F's body is generated
+static void beginFunctionFastMath(Function *F, const std::vector<std::string> &Attrs)
+{
+  FastMathFlags FMF = fastMathFlags(Attrs);
+  CS->Builder->setFastMathFlags(FMF);
+  if (!FMF.isFast())
+    return;
+  for (const char *Attr : {"unsafe-fp-math", "no-infs-fp-math", "no-nans-fp-math", "no-signed-zeros-fp-math", "approx-func-fp-math"})
+    F->addFnAttr(Attr, "true");
+}
+
+static void endFunctionFastMath()
+{
+  CS->Builder->clearFastMathFlags();
+}
+
+// a float multiply just generated for an operand of the expression being
+// generated, which -ffp-contract=on can fuse into it
+static BinaryOperator *contractibleMul(Value *V)
+{
+  auto *Mul = dyn_cast<BinaryOperator>(V);
+  if (!Mul || Mul->getOpcode() != Instruction::FMul || !Mul->use_empty() || Mul->getParent() != CS->Builder->GetInsertBlock())
+    return nullptr;
+  return Mul;
+}
+
+// L + R, or L - R if Subtract, as llvm.fmuladd when -ffp-contract=on and
+// either side is a multiply of the same expression, as clang does for C
+static Value *createFAddOrFMulAdd(Value *L, Value *R, bool Subtract, const Twine &Name)
+{
+  IRBuilder<> &B = *CS->Builder;
+  BinaryOperator *Mul = nullptr;
+  Value *Addend = nullptr;
+  bool NegateMul = false;
+  if (CS->Opts.FPContract == "on")
+  {
+    if ((Mul = contractibleMul(L)))
+      Addend = Subtract ? B.CreateFNeg(R, "negtmp") : R;
+    else if ((Mul = contractibleMul(R)))
+    {
+      Addend = L;
+      NegateMul = Subtract;
+    }
+  }
+  if (!Mul)
+    return Subtract ? B.CreateFSub(L, R, Name) : B.CreateFAdd(L, R, Name);
+
+  // c - a*b is (-a)*b + c
+  Value *A = Mul->getOperand(0), *MulR = Mul->getOperand(1);
+  if (NegateMul)
+    A = B.CreateFNeg(A, "negtmp");
+  Value *Fused = B.CreateIntrinsic(Intrinsic::fmuladd, {L->getType()}, {A, MulR, Addend}, nullptr, Name);
+  Mul->eraseFromParent();
+  return Fused;
+}
+
+#endif
@@ -0,0 +1,340 @@
+#ifndef INCREMENTAL_HPP
+#define INCREMENTAL_HPP
+
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/Linker/Linker.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Process.h"
+
+#include "astnode.hpp"
+#include "backend.hpp"
+#include "optimizer.hpp"
+#include "options.hpp"
+#include "timing.hpp"
+
+//===----------------------------------------------------------------------===//
+// Incremental compilation
+//===----------------------------------------------------------------------===//
+//
+// Every function is code generated into a module of its own, which is cached
+// on disk as bitcode. The cache key covers the tokens the function was parsed
+// from and where they are relative to its first line, its dependency
+// signature (prototypes and inferred attributes of the functions it calls, its
+// own attributes and the types of the globals it references), the options
+// that change its code, warnings or remarks (optionsSignature() in
+// options.hpp) and what they resolve to: the CPU, the target triple and data
+// layout the module was generated for (none for textual IR) and the contents
+// of the -fprofile-use file. So a function is only regenerated and
+// re-optimised when one of those changes. Its warnings and remarks are cached
+// with it, but -fsave-optimization-record only records the functions that
+// were rebuilt. The per-function modules are then linked back together in
+// source order.
+//
+// A function that only moves up or down the file keeps its artifact, and the
+// line numbers of its cached warnings move with it. Debug info and remarks
+// carry line numbers too, so with -g, -Rpass or -fsave-optimization-record
+// the line a function starts on is also in its key, and moving it rebuilds it.
+//
+// Builds of the same file, by threads of one process or by several processes
+// such as the compile server's workers, take turns with its cache directory,
+// so none removes an artifact another is about to link.
+//
+// Since each function is optimised on its own, nothing is inlined across
+// functions in an incremental build.
+
+static std::string hashString(const std::string &Str)
+{
+  MD5 Hash;
+  Hash.update(Str);
+  MD5::MD5Result Result;
+  Hash.final(Result);
+  return Result.digest().str().str();
+}
+
+// called by the parser once a function has been parsed, hashes its token range
+static void recordFunctionTokens(FunctionASTnode &F)
+{
+  // the last recorded token is the lookahead after the closing brace
+  F.setTokenHash(hashString(CS->RecordedTokens.substr(0, CS->LastTokenOffset)), CS->RecordedFromLine);
+}
+
+// prototypes of every extern, function and global declared so far
+struct DeclEnv
+{
+  std::map<std::string, Prototype> Functions;
+  std::map<std::string, Prototype> Globals;
+};
+
+// prototypes of the functions F calls and the globals it references, as seen
+// at the point F is defined
+static std::string dependencySignature(const FunctionASTnode &F, const DeclEnv &Env)
+{
+  std::set<std::string> Calls, Vars;
+  F.collectDeps(Calls, Vars);
+
+  std::string sig;
+  for (auto &c : Calls)
+  {
+    auto it = Env.Functions.find(c);
+    sig += "call " + (it == Env.Functions.end() ? c + " <undeclared>" : it->second.to_string()) + " " + attributeSignature(c) + ";";
+  }
+  sig += "attributes " + attributeSignature(F.getName()) + ";";
+  for (auto &v : Vars)
+  {
+    auto it = Env.Globals.find(v);
+    if (it != Env.Globals.end())
+      sig += "global " + it->second.to_string() + ";";
+  }
+  return sig;
+}
+
+// generate F into a fresh module holding declarations of only what it uses
+static std::unique_ptr<Module> codegenFunctionModule(FunctionASTnode &F, const DeclEnv &Env)
+{
+  CS->TheModule = createModule(F.getName(), *CS->TheContext);
+  CS->GlobalNamedValues.clear();
+
+  std::set<std::string> Calls, Vars;
+  F.collectDeps(Calls, Vars);
+  Calls.insert(F.getName()); // so redefinitions are still reported by FunctionASTnode::codegen()
+  for (auto &c : Calls)
+  {
+    auto it = Env.Functions.find(c);
+    if (it != Env.Functions.end())
+      declarePrototype(it->second);
+  }
+  for (auto &v : Vars)
+  {
+    auto it = Env.Globals.find(v);
+    if (it != Env.Globals.end())
+      declarePrototype(it->second);
+  }
+
+  {
+    PhaseScope Phase("codegen", "Code generation");
+    F.codegen();
+  }
+  if (CS->Stats)
+    CS->Stats->countIR(*CS->TheModule);
+  lowerModule(*CS->TheModule);
+  checkModule(*CS->TheModule, CS->Opts.Verify);
+  optimizeModule(*CS->TheModule, CS->Opts.OptLevel);
+  return std::move(CS->TheModule);
+}
+
+// warnings are cached next to the bitcode so they are reported on every build,
+// after the line their function started on when they were generated
+static void writeCachedWarnings(const std::string &Path, size_t First, int Line)
+{
+  std::error_code EC;
+  raw_fd_ostream out(Path, EC, sys::fs::OF_None);
+  if (EC)
+    return;
+  out << Line << '\x1e';
+  for (size_t i = First; i < CS->warnings.size(); i++)
+    out << CS->warnings[i] << '\x1e';
+}
+
+// the warning addWarning() generated as Text, Delta lines further down
+static std::string moveWarning(std::string Text, int Delta)
+{
+  size_t At = Text.find("` at line ");
+  if (Delta == 0 || Text.compare(0, strlen("\033[33mWarning in `"), "\033[33mWarning in `") != 0 || At == std::string::npos)
+    return Text;
+  At += strlen("` at line ");
+  size_t End = Text.find(' ', At);
+  return Text.substr(0, At) + std::to_string(std::stoi(Text.substr(At, End - At)) + Delta) + Text.substr(End);
+}
+
+// the cached warnings of a function that starts on Line now
+static void readCachedWarnings(const std::string &Path, int Line)
+{
+  ErrorOr<std::unique_ptr<MemoryBuffer>> Buf = MemoryBuffer::getFile(Path);
+  if (!Buf)
+    return;
+  std::string text = (*Buf)->getBuffer().str();
+  size_t start = text.find('\x1e'), end;
+  if (start == std::string::npos)
+    return;
+  int Delta = Line - atoi(text.substr(0, start).c_str());
+  start++;
+  while ((end = text.find('\x1e', start)) != std::string::npos)
+  {
+    addWarningText(moveWarning(text.substr(start, end - start), Delta));
+    start = end + 1;
+  }
+}
+
+// in every cache directory, see CacheDirLock
+static const char *CacheLockFile = "lock";
+
+// held while a build uses a cache directory: a mutex per directory for the
+// threads of this process, and a lock on the directory's lock file, which
+// only excludes other processes, for theirs
+class CacheDirLock
+{
+  std::unique_lock<std::mutex> ThreadLock;
+  int FD = -1;
+
+  static std::mutex &directoryMutex(const std::string &Dir)
+  {
+    static std::mutex Lock;
+    static std::map<std::string, std::unique_ptr<std::mutex>> Mutexes;
+    std::lock_guard<std::mutex> L(Lock);
+    std::unique_ptr<std::mutex> &M = Mutexes[Dir];
+    if (!M)
+      M = std::make_unique<std::mutex>();
+    return *M;
+  }
+
+public:
+  CacheDirLock(const std::string &Dir) : ThreadLock(directoryMutex(Dir))
+  {
+    SmallString<128> Path(Dir);
+    sys::path::append(Path, CacheLockFile);
+    if (sys::fs::openFileForReadWrite(Path, FD, sys::fs::CD_OpenAlways, sys::fs::OF_None))
+      error("Could not open " + Path.str().str());
+    if (sys::fs::lockFile(FD))
+      error("Could not lock " + Path.str().str());
+  }
+
+  ~CacheDirLock()
+  {
+    sys::fs::unlockFile(FD);
+    sys::Process::SafelyCloseFileDescriptor(FD);
+  }
+};
+
+static std::unique_ptr<Module> loadCachedModule(const std::string &Path)
+{
+  ErrorOr<std::unique_ptr<MemoryBuffer>> Buf = MemoryBuffer::getFile(Path);
+  if (!Buf)
+    return nullptr;
+  Expected<std::unique_ptr<Module>> M = parseBitcodeFile((*Buf)->getMemBufferRef(), *CS->TheContext);
+  if (!M)
+  {
+    consumeError(M.takeError());
+    return nullptr;
+  }
+  return std::move(*M);
+}
+
+static void generateCodeIncremental(std::unique_ptr<ProgramASTnode> &tree)
+{
+  // one cache directory per input file, anything left in it that this build
+  // does not use is stale and removed at the end
+  SmallString<128> Dir(CS->Opts.CacheDir);
+  sys::path::append(Dir, sys::path::stem(CS->Opts.InputFile));
+  if (std::error_code EC = sys::fs::create_directories(Dir))
+    error("Could not create cache directory " + Dir.str().str() + ": " + EC.message());
+  CacheDirLock Lock(Dir.str().str());
+
+  DeclEnv Env;
+  for (auto &e : tree->getExterns())
+    Env.Functions[e->getName()] = e->getPrototype();
+
+  // the options, and what they resolve to, every function is generated with
+  std::string Options = optionsSignature(CS->Opts) +
+                        (targetRequested() ? "|cpu=" + targetCPU() + "|features=" + targetFeatures() : "") +
+                        (modulesHaveTarget() ? "|target=" + moduleTarget() : "") +
+                        (CS->Profile && !CS->Profile->FileHash.empty() ? "|profile-use=" + CS->Profile->FileHash : "");
+
+  // pass 1: bring the artifact of every function up to date
+  std::vector<std::string> Artifacts(tree->getDecls().size());
+  std::set<std::string> Used;
+  SmallString<128> LockPath(Dir);
+  sys::path::append(LockPath, CacheLockFile);
+  Used.insert(LockPath.str().str());
+  unsigned Rebuilt = 0, Total = 0;
+  for (size_t i = 0; i < tree->getDecls().size(); i++)
+  {
+    ASTnode *d = tree->getDecls()[i].get();
+    if (!d->isFunction())
+    {
+      Prototype P = static_cast<VarDeclASTnode *>(d)->getPrototype();
+      Env.Globals[P.Name] = P;
+      continue;
+    }
+
+    FunctionASTnode *F = static_cast<FunctionASTnode *>(d);
+    bool Lines = CS->Opts.Debug || remarksRequested(); // what is generated has the function's line numbers in it
+    std::string key = hashString(F->getTokenHash() + (Lines ? "|line=" + std::to_string(F->getTokenLine()) : "") + "|" +
+                                 dependencySignature(*F, Env) + Options);
+    SmallString<128> Path(Dir);
+    sys::path::append(Path, F->getName() + "-" + key + ".bc");
+    std::string WarnPath = Path.str().str() + ".warn";
+    Artifacts[i] = Path.str().str();
+    Used.insert(Artifacts[i]);
+    Used.insert(WarnPath);
+    Total++;
+
+    if (sys::fs::exists(Path))
+    {
+      readCachedWarnings(WarnPath, F->getTokenLine());
+    }
+    else
+    {
+      size_t firstWarning = CS->warnings.size();
+      std::unique_ptr<Module> M = codegenFunctionModule(*F, Env);
+
+      // write the warnings first and rename the bitcode into place last, so
+      // a build that is killed never leaves a partial artifact behind
+      writeCachedWarnings(WarnPath, firstWarning, F->getTokenLine());
+      int FD;
+      SmallString<128> TmpPath;
+      if (std::error_code EC = sys::fs::createUniqueFile(Path + ".tmp-%%%%%%%%", FD, TmpPath))
+        error("Could not create a temporary file for " + Path.str().str() + ": " + EC.message());
+      {
+        raw_fd_ostream out(FD, true);
+        WriteBitcodeToFile(*M, out);
+      }
+      sys::fs::rename(TmpPath, Path);
+      Rebuilt++;
+    }
+    Env.Functions[F->getName()] = F->getPrototype();
+  }
+
+  // pass 2: link the artifacts back together in source order
+  PhaseScope Phase("link", "Linking cached functions");
+  CS->TheModule = createModule("mini-c", *CS->TheContext);
+  CS->GlobalNamedValues.clear();
+  for (auto &e : tree->getExterns())
+    e->codegen();
+  for (size_t i = 0; i < tree->getDecls().size(); i++)
+  {
+    if (Artifacts[i].empty())
+    {
+      tree->getDecls()[i]->codegen(); // global variable
+      continue;
+    }
+    std::unique_ptr<Module> M = loadCachedModule(Artifacts[i]);
+    if (!M)
+      error("Could not read cached module " + Artifacts[i]);
+    if (Linker::linkModules(*CS->TheModule, std::move(M)))
+      error("Could not link cached module " + Artifacts[i]);
+  }
+  // the debug info of the globals generated into the linked module, and a
+  // single compile unit for the functions linked into it
+  finishDebugInfo();
+  mergeCompileUnits(*CS->TheModule);
+
+  // drop stale artifacts
+  std::error_code EC;
+  for (sys::fs::directory_iterator it(Dir, EC), end; it != end && !EC; it.increment(EC))
+  {
+    if (!Used.count(it->path()))
+      sys::fs::remove(it->path());
+  }
+
+  if (CS->Opts.Verbose)
+    fprintf(stdout, "Rebuilt %u of %u functions\n", Rebuilt, Total);
+}
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef INSTRUMENT_HPP
+#define INSTRUMENT_HPP
+
+#include <vector>
+
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DebugInfoMetadata.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+
+//===----------------------------------------------------------------------===//
+// Function profiling instrumentation
+//===----------------------------------------------------------------------===//
+//
+// With -finstrument=profile every function defined in a module calls
+// __mccomp_prof_enter on entry and __mccomp_prof_exit before each return,
+// passing a record of its own:
+//
+//   @__mccomp_prof.f = private global { ptr, i32 } { ptr @__mccomp_prof.name.f, i32 -1 }
+//
+// that is the function's name and an id the runtime assigns on its first
+// call. The runtime (profile-rt.cpp, linked from libmccomp-prof.a) reads the
+// clock, keeps call counts, inclusive and exclusive times and caller/callee
+// edges per thread, and writes them out at exit for mccomp-prof. Functions are
+// instrumented before they are optimised, so the calls stay where a function
+// is inlined and it is still counted.
+
+static void instrumentFunctions(Module &M)
+{
+  if (!CS->Opts.InstrumentProfile)
+    return;
+  LLVMContext &C = M.getContext();
+  PointerType *Ptr = PointerType::getUnqual(Type::getInt8Ty(C));
+  StructType *RecordTy = StructType::get(C, {Ptr, Type::getInt32Ty(C)});
+  FunctionType *HookTy = FunctionType::get(Type::getVoidTy(C), {PointerType::getUnqual(RecordTy)}, false);
+  FunctionCallee Enter = M.getOrInsertFunction("__mccomp_prof_enter", HookTy);
+  FunctionCallee Exit = M.getOrInsertFunction("__mccomp_prof_exit", HookTy);
+
+  for (Function &F : M)
+  {
+    if (F.isDeclaration() || F.hasLocalLinkage())
+      continue;
+    Constant *Name = ConstantDataArray::getString(C, F.getName());
+    auto *NameVar = new GlobalVariable(M, Name->getType(), true, GlobalValue::PrivateLinkage, Name,
+                                       "__mccomp_prof.name." + F.getName());
+    Constant *Init = ConstantStruct::get(RecordTy, {ConstantExpr::getPointerCast(NameVar, Ptr),
+                                                    ConstantInt::get(Type::getInt32Ty(C), -1, true)});
+    auto *Record = new GlobalVariable(M, RecordTy, false, GlobalValue::PrivateLinkage, Init, "__mccomp_prof." + F.getName());
+
+    // after the allocas, which must stay at the top of the entry block to be
+    // promoted and inlined as static allocas
+    BasicBlock::iterator It = F.getEntryBlock().begin();
+    while (isa<AllocaInst>(*It))
+      ++It;
+    IRBuilder<> B(&F.getEntryBlock(), It);
+    if (DISubprogram *SP = F.getSubprogram())
+      B.SetCurrentDebugLocation(DILocation::get(C, SP->getLine(), 0, SP));
+    B.CreateCall(Enter, {Record});
+
+    std::vector<ReturnInst *> Returns;
+    for (BasicBlock &BB : F)
+      if (auto *R = dyn_cast<ReturnInst>(BB.getTerminator()))
+        Returns.push_back(R);
+    for (ReturnInst *R : Returns)
+      IRBuilder<>(R).CreateCall(Exit, {Record});
+  }
+}
+
+#endif
@@ -0,0 +1,104 @@
+#ifndef JITPROFILING_HPP
+#define JITPROFILING_HPP
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <mutex>
+#include <string>
+
+#include "llvm/ExecutionEngine/JITEventListener.h"
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+#include "llvm/ExecutionEngine/Orc/RTDyldObjectLinkingLayer.h"
+#include "llvm/ExecutionEngine/SectionMemoryManager.h"
+#include "llvm/Object/SymbolSize.h"
+
+//===----------------------------------------------------------------------===//
+// Profiling and debugging JIT-compiled code
+//===----------------------------------------------------------------------===//
+//
+// Code in the JIT has no file behind it, so profilers and debuggers can't name
+// it. With CompilerOptions::JITProfiling the JIT loads objects through
+// RuntimeDyld and tells the tools about every one:
+//  - /tmp/perf-<pid>.map gets the address, size and name of every function,
+//    which perf report reads for any process it has no symbols for
+//  - a jitdump (jit-<pid>.dump under $JITDUMPDIR or ~/.debug/jit) gets the
+//    code and its line table, for perf record -k 1 followed by perf inject
+//    --jit, if LLVM was built with LLVM_USE_PERF
+//  - the objects are registered with the GDB JIT interface, which gdb and
+//    lldb read to set breakpoints and step through the code
+// The module is compiled with debug info, so the jitdump and the debuggers
+// see MiniC source lines. perf only runs on Linux; elsewhere the debugger
+// registration is all there is to it.
+
+// appends "<start> <size> <name>" to /tmp/perf-<pid>.map for every function
+// loaded. perf reads the map after the process is gone, so it is never removed
+// and entries stay when their code is freed
+class PerfMapListener : public JITEventListener
+{
+  std::mutex Lock; // every JIT in the process writes to the same map
+  FILE *Map = nullptr;
+
+public:
+  void notifyObjectLoaded(ObjectKey Key, const object::ObjectFile &Obj,
+                          const RuntimeDyld::LoadedObjectInfo &L) override
+  {
+    std::string Lines;
+    for (const std::pair<object::SymbolRef, uint64_t> &P : object::computeSymbolSizes(Obj))
+    {
+      const object::SymbolRef &Sym = P.first;
+      Expected<object::SymbolRef::Type> Type = Sym.getType();
+      Expected<StringRef> Name = Sym.getName();
+      Expected<uint64_t> Address = Sym.getAddress();
+      Expected<object::section_iterator> Section = Sym.getSection();
+      if (!Type || !Name || !Address || !Section || *Type != object::SymbolRef::ST_Function ||
+          *Section == Obj.section_end())
+      {
+        consumeError(Type.takeError());
+        consumeError(Name.takeError());
+        consumeError(Address.takeError());
+        consumeError(Section.takeError());
+        continue;
+      }
+      // where the section was loaded, plus the function's offset into it
+      uint64_t Start = L.getSectionLoadAddress(**Section) + *Address - (*Section)->getAddress();
+      char Line[64];
+      snprintf(Line, sizeof(Line), "%llx %llx ", (unsigned long long)Start, (unsigned long long)P.second);
+      Lines += Line + Name->str() + "\n";
+    }
+
+    std::lock_guard<std::mutex> Guard(Lock);
+    if (Map == nullptr)
+      Map = fopen(("/tmp/perf-" + std::to_string(getpid()) + ".map").c_str(), "a");
+    if (Map == nullptr)
+      return;
+    fputs(Lines.c_str(), Map);
+    fflush(Map);
+  }
+};
+
+static PerfMapListener &getPerfMapListener()
+{
+  static PerfMapListener Listener;
+  return Listener;
+}
+
+// the object layer of a JIT with JITProfiling, see LLJITBuilder::setObjectLinkingLayerCreator
+static Expected<std::unique_ptr<orc::ObjectLayer>> createProfiledObjectLayer(orc::ExecutionSession &ES, const Triple &TT)
+{
+#if LLVM_VERSION_MAJOR >= 20
+  auto Layer = std::make_unique<orc::RTDyldObjectLinkingLayer>(ES, [](const MemoryBuffer &)
+                                                               { return std::make_unique<SectionMemoryManager>(); });
+#else
+  auto Layer = std::make_unique<orc::RTDyldObjectLinkingLayer>(ES, []()
+                                                               { return std::make_unique<SectionMemoryManager>(); });
+#endif
+  Layer->registerJITEventListener(*JITEventListener::createGDBRegistrationListener());
+  // nullptr unless LLVM was built with LLVM_USE_PERF
+  if (JITEventListener *JITDump = JITEventListener::createPerfJITEventListener())
+    Layer->registerJITEventListener(*JITDump);
+  Layer->registerJITEventListener(getPerfMapListener());
+  return std::move(Layer);
+}
+
+#endif
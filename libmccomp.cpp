@@ -0,0 +1,349 @@
+#include "mccomp.hpp"
+#include "jitprofiling.hpp"
+#include "parser.hpp"
+#include "pipeline.hpp"
+#include "stats.hpp"
+#include "streaming.hpp"
+#include "timing.hpp"
+#include "libmccomp.hpp"
+
+#include "llvm/ExecutionEngine/Orc/ExecutionUtils.h"
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+
+//===----------------------------------------------------------------------===//
+// Parser driver code.
+//===----------------------------------------------------------------------===//
+
+static std::unique_ptr<ProgramASTnode> parser()
+{
+  // the tokens lexed ahead are freed again as they are parsed
+  long long Heap = liveHeap();
+  if (CS->Timers || CS->Stats || timeTraceProfilerEnabled())
+  {
+    PhaseScope Phase("lex", "Lexing");
+    lexAll();
+  }
+  PhaseScope Phase("parse", "Parsing");
+  getNextToken();
+  std::unique_ptr<ProgramASTnode> tree = parseProgram();
+  if (CS->Stats)
+    CS->Stats->ASTHeap = liveHeap() - Heap;
+  return tree;
+}
+
+static void printTree(std::unique_ptr<ProgramASTnode> &tree)
+{
+  PhaseScope Phase("ast-dump", "AST dump");
+  fprintf(stdout, "Printing AST\n\n");
+  fprintf(stdout, "%s", tree->to_tree().c_str());
+}
+
+static void generateCode(std::unique_ptr<ProgramASTnode> &tree)
+{
+  if (CS->Opts.Verbose)
+    fprintf(stdout, "Generating code\n");
+  PhaseScope Phase("codegen", "Code generation");
+  tree->codegen();
+}
+
+//===----------------------------------------------------------------------===//
+// Compiler driver code.
+//===----------------------------------------------------------------------===//
+
+// reset all lexer, parser and codegen state and start a new context
+static void resetCompilerState(const CompilerOptions &Options, FILE *in)
+{
+  CS->Opts = Options;
+  // profilers and debuggers map the JIT's code back to source lines through its debug info
+  if (Options.JITProfiling && Options.Output == OutputKind::JIT)
+    CS->Opts.Debug = true;
+  CS->pFile = in;
+  resetLexer();
+  CS->RecordTokens = false;
+  CS->Lexed.clear();
+  CS->warnings.clear();
+  CS->NamedValues.clear();
+  CS->GlobalNamedValues.clear();
+  CS->TheModule.reset();
+  CS->Builder.reset();
+  CS->TheContext = std::make_unique<LLVMContext>();
+  CS->Builder = std::make_unique<IRBuilder<>>(*CS->TheContext);
+  CS->Timers = Options.TimeReport ? std::make_unique<PhaseTimers>() : nullptr;
+  CS->Stats = Options.Stats ? std::make_unique<CompileStats>() : nullptr;
+  CS->TokensLexed = 0;
+}
+
+static std::unique_ptr<orc::LLJIT> createJIT()
+{
+  orc::LLJITBuilder Builder;
+  if (CS->Opts.JITProfiling)
+    Builder.setObjectLinkingLayerCreator(createProfiledObjectLayer);
+  Expected<std::unique_ptr<orc::LLJIT>> J = Builder.create();
+  if (!J)
+    error("Could not create JIT: " + toString(J.takeError()));
+
+  // externs are looked up in the host process
+  Expected<std::unique_ptr<orc::DynamicLibrarySearchGenerator>> G =
+      orc::DynamicLibrarySearchGenerator::GetForCurrentProcess((*J)->getDataLayout().getGlobalPrefix());
+  if (!G)
+    error("Could not create JIT: " + toString(G.takeError()));
+  (*J)->getMainJITDylib().addGenerator(std::move(*G));
+
+  // hand the module over together with the context it lives in
+  CS->Builder.reset();
+  detachRemarks(*CS->TheContext);
+  orc::ThreadSafeModule TSM(std::move(CS->TheModule), std::move(CS->TheContext));
+  if (Error E = (*J)->addIRModule(std::move(TSM)))
+    error("Could not add module to JIT: " + toString(std::move(E)));
+  return std::move(*J);
+}
+
+// hand the finished module over in the form Result asks for
+static void emitResult(CompileResult &Result)
+{
+  PhaseScope Phase("emit", "Emission");
+  switch (CS->Opts.Output)
+  {
+  case OutputKind::IR:
+  {
+    raw_string_ostream dest(Result.Buffer);
+    CS->TheModule->print(dest, nullptr);
+    break;
+  }
+  case OutputKind::Object:
+  {
+    SmallVector<char, 0> object;
+    raw_svector_ostream dest(object);
+    emitObject(*CS->TheModule, dest);
+    Result.Buffer.assign(object.data(), object.size());
+    break;
+  }
+  case OutputKind::Module:
+    CS->Builder.reset();
+    detachRemarks(*CS->TheContext);
+    Result.Module = std::move(CS->TheModule);
+    Result.Context = std::move(CS->TheContext);
+    break;
+  case OutputKind::JIT:
+    Result.JIT = createJIT();
+    break;
+  }
+}
+
+// generate, optimise and write out the program a chunk at a time, returns
+// the files written
+static std::vector<std::string> generateCodeStreaming()
+{
+  if (CS->Opts.Output != OutputKind::IR && CS->Opts.Output != OutputKind::Object)
+    error("--stream can only write IR or object files");
+
+  StreamEmitter Emitter(CS->Opts.Stream);
+  auto Generate = [&Emitter](std::unique_ptr<ASTnode> D)
+  {
+    inferAttributes(*D);
+    Emitter.add(std::move(D));
+  };
+  try
+  {
+    if (CS->Opts.Pipeline)
+      generateCodePipelined(Generate);
+    else
+    {
+      getNextToken();
+      parseProgramStreaming([&Generate](std::unique_ptr<ASTnode> D)
+                            { Generate(std::move(D)); return true; });
+    }
+  }
+  catch (const CompileError &)
+  {
+    Emitter.abandon();
+    throw;
+  }
+  Emitter.finish();
+  return Emitter.Files;
+}
+
+// write the trace recorded for this compile and stop tracing, see timing.hpp
+static void writeTimeTrace(CompileResult &Result)
+{
+  std::string Fallback = CS->Opts.OutputFile.empty() ? "output" : CS->Opts.OutputFile;
+  if (Error E = timeTraceProfilerWrite(CS->Opts.TimeTraceFile, Fallback))
+  {
+    Result.Success = false;
+    Result.Error += "Error: Could not write time trace: " + toString(std::move(E)) + "\n";
+  }
+  timeTraceProfilerCleanup();
+}
+
+// compile the program read from `in` with the current state
+static void compile(FILE *in, const CompilerOptions &Options, CompileResult &Result)
+{
+  resetCompilerState(Options, in);
+  if (CS->Opts.TimeTrace)
+    timeTraceProfilerInitialize(CS->Opts.TimeTraceGranularity, "mccomp");
+
+  try
+  {
+    if (CS->Opts.Incremental && (CS->Opts.Pipeline || CS->Opts.Stream))
+      error("--incremental can't be combined with --pipeline or --stream");
+
+    startProfile();
+    startRemarks();
+    startAttributes();
+
+    // Make the module, which holds all the code.
+    CS->TheModule = createModule("mini-c", *CS->TheContext);
+
+    if (CS->Opts.Stream)
+    {
+      // Parse, generate and write out one declaration at a time
+      if (CS->Opts.Verbose)
+        fprintf(stdout, "Generating code\n");
+      Result.OutputFiles = generateCodeStreaming();
+    }
+    else if (CS->Opts.Pipeline)
+    {
+      // Parse and generate code at the same time
+      if (CS->Opts.Verbose)
+        fprintf(stdout, "Generating code\n");
+      generateCodePipelined([](std::unique_ptr<ASTnode> D)
+                            {
+                              inferAttributes(*D);
+                              PhaseScope Phase("codegen", "Code generation");
+                              D->codegen();
+                            });
+      if (CS->Stats)
+        CS->Stats->countIR(*CS->TheModule);
+      lowerModule(*CS->TheModule);
+      checkModule(*CS->TheModule, CS->Opts.Verify);
+      optimizeModule(*CS->TheModule, CS->Opts.OptLevel);
+      emitResult(Result);
+    }
+    else
+    {
+      // Run the parser, recording tokens so functions can be matched against the cache
+      CS->RecordTokens = CS->Opts.Incremental;
+      std::unique_ptr<ProgramASTnode> tree = parser();
+      // fprintf(stdout, "Parsed program\n");
+
+      // Print the AST
+      if (CS->Opts.Verbose)
+        printTree(tree);
+
+      // what every function does, for the attributes of its definition and calls
+      for (auto &e : tree->getExterns())
+        inferAttributes(*e);
+      for (auto &d : tree->getDecls())
+        inferAttributes(*d);
+
+      // Generate code
+      if (CS->Opts.Incremental)
+      {
+        if (CS->Opts.Verbose)
+          fprintf(stdout, "Generating code\n");
+        generateCodeIncremental(tree);
+      }
+      else
+      {
+        generateCode(tree);
+        if (CS->Stats)
+          CS->Stats->countIR(*CS->TheModule);
+        lowerModule(*CS->TheModule);
+        checkModule(*CS->TheModule, CS->Opts.Verify);
+        optimizeModule(*CS->TheModule, CS->Opts.OptLevel);
+      }
+      emitResult(Result);
+    }
+    if (CS->Opts.ExportSummary)
+      writeSummary();
+    Result.Success = true;
+  }
+  catch (const CompileError &E)
+  {
+    Result.Error = E.what();
+  }
+
+  finishRemarks(Result.Success);
+  Result.Warnings = CS->warnings;
+  if (CS->Timers)
+  {
+    Result.TimeReport = CS->Timers->print();
+    CS->Timers.reset();
+  }
+  if (CS->Opts.TimeTrace)
+    writeTimeTrace(Result);
+  if (CS->Stats)
+  {
+    CS->Stats->finish(CS->warnings);
+    Result.Stats = CS->Stats->print(CS->Opts.StatsJSON);
+    CS->Stats.reset();
+  }
+
+  // the module may have been handed over, don't keep pointers into it
+  CS->NamedValues.clear();
+  CS->GlobalNamedValues.clear();
+}
+
+//===----------------------------------------------------------------------===//
+// Library interface, see libmccomp.hpp
+//===----------------------------------------------------------------------===//
+
+HeapCounters TheHeapCounters;
+
+CompileResult::CompileResult() = default;
+CompileResult::CompileResult(CompileResult &&) = default;
+CompileResult &CompileResult::operator=(CompileResult &&) = default;
+CompileResult::~CompileResult() = default;
+
+CompilerInstance::CompilerInstance() : State(std::make_unique<CompilerState>()) {}
+
+CompilerInstance::~CompilerInstance() = default;
+
+CompileResult CompilerInstance::compileString(const std::string &Source, const CompilerOptions &Options)
+{
+  CurrentState Current(State.get());
+  CompileResult Result;
+
+  // fmemopen() can't open an empty buffer
+  FILE *in = Source.empty() ? tmpfile() : fmemopen(const_cast<char *>(Source.data()), Source.size(), "r");
+  if (in == NULL)
+  {
+    Result.Error = "Error: Could not read source: " + std::string(strerror(errno)) + "\n";
+    return Result;
+  }
+  compile(in, Options, Result);
+  fclose(in);
+  return Result;
+}
+
+CompileResult CompilerInstance::compileFile(const std::string &Path, const CompilerOptions &Options)
+{
+  CurrentState Current(State.get());
+  CompileResult Result;
+
+  FILE *in = fopen(Path.c_str(), "r");
+  if (in == NULL)
+  {
+    Result.Error = "Error opening file: " + std::string(strerror(errno)) + "\n";
+    return Result;
+  }
+  CompilerOptions FileOptions = Options;
+  FileOptions.InputFile = Path;
+  compile(in, FileOptions, Result);
+  fclose(in); // close the file that contains the code that was parsed
+  return Result;
+}
+
+std::string CompilerInstance::initializeTarget()
+{
+  CurrentState Current(State.get());
+  try
+  {
+    getTargetMachine();
+  }
+  catch (const CompileError &E)
+  {
+    return E.what();
+  }
+  return "";
+}
@@ -0,0 +1,93 @@
+#ifndef LIBMCCOMP_HPP
+#define LIBMCCOMP_HPP
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "options.hpp"
+
+//===----------------------------------------------------------------------===//
+// libmccomp - the compiler as a library
+//===----------------------------------------------------------------------===//
+//
+// A CompilerInstance owns all lexer, parser and code generator state, so any
+// number of instances can compile at the same time on different threads. An
+// instance itself compiles one program at a time; reusing it keeps its target
+// machine warm.
+//
+//   CompilerInstance CI;
+//   CompilerOptions Opts;
+//   Opts.Output = OutputKind::JIT;
+//   CompileResult R = CI.compileString("int main() { return 42; }", Opts);
+//   if (R.Success)
+//     auto Main = R.JIT->lookup("main");
+//
+// Programs run through the JIT resolve their externs (print_int, ...) against
+// the host process, which must export them (e.g. link with -rdynamic).
+
+namespace llvm
+{
+  class LLVMContext;
+  class Module;
+  namespace orc
+  {
+    class LLJIT;
+  }
+}
+
+struct CompilerState;
+
+// heap use of the process, reported by --stats. The library doesn't count
+// anything itself: a program that wants heap statistics replaces operator new
+// and delete to update these, as mccomp does (see mccomp.cpp)
+struct HeapCounters
+{
+  std::atomic<unsigned long long> Allocations{0};
+  std::atomic<unsigned long long> Allocated{0}; // bytes
+  std::atomic<unsigned long long> Freed{0};     // bytes
+};
+extern HeapCounters TheHeapCounters;
+
+struct CompileResult
+{
+  bool Success = false;
+  std::string Error;                 // the error that stopped compilation, empty on success
+  std::vector<std::string> Warnings; // formatted like the command line compiler prints them
+  std::string TimeReport;            // with Options.TimeReport, the -ftime-report tables
+  std::string Stats;                 // with Options.Stats, the --stats report (JSON with Options.StatsJSON)
+
+  // filled in according to CompilerOptions::Output
+  std::string Buffer;                         // IR: textual IR, Object: the object file
+  std::unique_ptr<llvm::LLVMContext> Context; // Module: the context owning Module
+  std::unique_ptr<llvm::Module> Module;       // Module: the generated module
+  std::unique_ptr<llvm::orc::LLJIT> JIT;      // JIT: a JIT with the module added
+  std::vector<std::string> OutputFiles;       // with Options.Stream the chunk files written instead
+
+  CompileResult();
+  CompileResult(CompileResult &&);
+  CompileResult &operator=(CompileResult &&);
+  ~CompileResult();
+};
+
+class CompilerInstance
+{
+public:
+  CompilerInstance();
+  ~CompilerInstance();
+  CompilerInstance(const CompilerInstance &) = delete;
+  CompilerInstance &operator=(const CompilerInstance &) = delete;
+
+  CompileResult compileString(const std::string &Source, const CompilerOptions &Options);
+  // reads the program from Path, which replaces Options.InputFile
+  CompileResult compileFile(const std::string &Path, const CompilerOptions &Options);
+
+  // create the target machine up front, returns an error message on failure
+  std::string initializeTarget();
+
+private:
+  std::unique_ptr<CompilerState> State;
+};
+
+#endif
@@ -0,0 +1,152 @@
+#ifndef MATHLIB_HPP
+#define MATHLIB_HPP
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Intrinsics.h"
+#include "llvm/IR/Module.h"
+#include "llvm/TargetParser/Triple.h"
+
+#include "astnode.hpp"
+
+//===----------------------------------------------------------------------===//
+// Math library functions
+//===----------------------------------------------------------------------===//
+//
+// MiniC has no headers, a program declares the C math functions it uses
+// itself, with float in place of double:
+//
+//   extern float sqrt(float x);
+//
+// An extern named after one of the functions below (or its f-suffixed float
+// version, sqrtf) that takes and returns floats is known to be [[const]], and
+// its calls become the LLVM intrinsic, which the optimiser can fold, hoist and
+// vectorise and the code generator turns into an instruction (sqrt, fabs,
+// floor, ...) or a call to the float libm function (sinf, cosf, ...). As there
+// is no errno, sqrt of a negative number is NaN. -fno-builtin keeps every
+// extern an ordinary call, and tells the optimiser nothing about libm either.
+//
+// -fveclib=<library> tells the loop vectoriser about a vector math library,
+// so a loop calling sin or cos is vectorised into calls taking four or eight
+// floats at once (_ZGVbN4v_sinf in glibc's libmvec) instead of left scalar.
+// The program is then linked against that library, -lmvec for libmvec.
+
+struct MathFunction
+{
+  const char *Name;
+  Intrinsic::ID ID;
+  unsigned NumArgs;
+};
+
+static const MathFunction MathFunctions[] = {
+    {"sqrt", Intrinsic::sqrt, 1},
+    {"fabs", Intrinsic::fabs, 1},
+    {"floor", Intrinsic::floor, 1},
+    {"ceil", Intrinsic::ceil, 1},
+    {"trunc", Intrinsic::trunc, 1},
+    {"round", Intrinsic::round, 1},
+    {"rint", Intrinsic::rint, 1},
+    {"nearbyint", Intrinsic::nearbyint, 1},
+    {"sin", Intrinsic::sin, 1},
+    {"cos", Intrinsic::cos, 1},
+    {"exp", Intrinsic::exp, 1},
+    {"exp2", Intrinsic::exp2, 1},
+    {"log", Intrinsic::log, 1},
+    {"log2", Intrinsic::log2, 1},
+    {"log10", Intrinsic::log10, 1},
+    {"fmin", Intrinsic::minnum, 2},
+    {"fmax", Intrinsic::maxnum, 2},
+    {"pow", Intrinsic::pow, 2},
+    {"copysign", Intrinsic::copysign, 2},
+    {"fma", Intrinsic::fma, 3},
+};
+
+// the intrinsic an extern with prototype P stands for, not_intrinsic if none
+static Intrinsic::ID mathIntrinsic(const Prototype &P)
+{
+  if (!CS->Opts.Builtins || P.Type != "float")
+    return Intrinsic::not_intrinsic;
+  for (auto &M : MathFunctions)
+  {
+    if (P.Name != M.Name && P.Name != std::string(M.Name) + "f")
+      continue;
+    if (P.ParamTypes.size() != M.NumArgs)
+      return Intrinsic::not_intrinsic;
+    for (auto &T : P.ParamTypes)
+      if (T != "float")
+        return Intrinsic::not_intrinsic;
+    return M.ID;
+  }
+  return Intrinsic::not_intrinsic;
+}
+
+// replace the calls in M to every extern in Intrinsics by calls to the
+// intrinsic, keeping their fast-math flags and source location
+static void lowerMathCalls(Module &M, const std::map<std::string, Intrinsic::ID> &Intrinsics)
+{
+  for (auto &KV : Intrinsics)
+  {
+    Function *F = M.getFunction(KV.first);
+    if (!F || !F->isDeclaration())
+      continue;
+    Function *Intr = Intrinsic::getDeclaration(&M, KV.second, {F->getReturnType()});
+    std::vector<CallInst *> Calls;
+    for (User *U : F->users())
+      if (auto *Call = dyn_cast<CallInst>(U))
+        if (Call->getCalledFunction() == F)
+          Calls.push_back(Call);
+    for (CallInst *Call : Calls)
+    {
+      IRBuilder<> B(Call);
+      B.setFastMathFlags(Call->getFastMathFlags());
+      std::vector<Value *> Args(Call->arg_begin(), Call->arg_end());
+      CallInst *Lowered = B.CreateCall(Intr, Args);
+      Lowered->takeName(Call);
+      Lowered->setDebugLoc(Call->getDebugLoc());
+      Call->replaceAllUsesWith(Lowered);
+      Call->eraseFromParent();
+    }
+    if (F->use_empty())
+      F->eraseFromParent();
+  }
+}
+
+// what the optimiser may assume about library functions, and the vector
+// library of -fveclib
+static TargetLibraryInfoImpl targetLibraryInfo(const Module &M)
+{
+  Triple T(M.getTargetTriple());
+  TargetLibraryInfoImpl TLII(T);
+  if (!CS->Opts.Builtins)
+    TLII.disableAllFunctions();
+
+  static const std::map<std::string, TargetLibraryInfoImpl::VectorLibrary> Libraries = {
+      {"none", TargetLibraryInfoImpl::NoLibrary},
+      {"Accelerate", TargetLibraryInfoImpl::Accelerate},
+      {"Darwin_libsystem_m", TargetLibraryInfoImpl::DarwinLibSystemM},
+      {"libmvec", TargetLibraryInfoImpl::LIBMVEC_X86},
+      {"MASSV", TargetLibraryInfoImpl::MASSV},
+      {"SVML", TargetLibraryInfoImpl::SVML},
+#if LLVM_VERSION_MAJOR >= 17
+      {"SLEEF", TargetLibraryInfoImpl::SLEEFGNUABI},
+      {"ArmPL", TargetLibraryInfoImpl::ArmPL},
+#endif
+  };
+  auto It = Libraries.find(CS->Opts.VecLib);
+  if (It == Libraries.end())
+    error("-fveclib=" + CS->Opts.VecLib + " is not supported by LLVM " LLVM_VERSION_STRING);
+#if LLVM_VERSION_MAJOR >= 17
+  TLII.addVectorizableFunctionsFromVecLib(It->second, T);
+#else
+  TLII.addVectorizableFunctionsFromVecLib(It->second);
+#endif
+  return TLII;
+}
+
+#endif
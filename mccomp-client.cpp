@@ -0,0 +1,106 @@
+// Thin client for the mccomp compile server (mccomp --serve). Takes the same
+// arguments as mccomp and writes the same output files, but the compilation
+// itself runs in an already warm server process. Falls back to running mccomp
+// directly when no server is listening.
+
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "protocol.hpp"
+
+// run the real compiler, looked up next to this binary and then on the PATH
+static int runLocally(char **argv)
+{
+  std::string self = argv[0];
+  std::string dir = self.find('/') == std::string::npos ? "" : self.substr(0, self.rfind('/') + 1);
+  std::string local = dir + "mccomp";
+  argv[0] = (char *)"mccomp";
+  execv(local.c_str(), argv);
+  execvp("mccomp", argv);
+  perror("Could not run mccomp");
+  return 1;
+}
+
+int main(int argc, char **argv)
+{
+  std::string input, output;
+  bool emitObject = false;
+  for (int i = 1; i < argc; i++)
+  {
+    std::string arg = argv[i];
+    if (arg == "-o" && i + 1 < argc)
+      output = argv[++i];
+    else if (arg == "--emit=obj" || arg == "--emit=llvm")
+      emitObject = arg == "--emit=obj";
+    else if (arg == "--watch" || arg.compare(0, 7, "--serve") == 0)
+      return runLocally(argv); // long running modes are not forwarded
+    else if (arg[0] != '-')
+      input = arg;
+  }
+  if (input.empty())
+    return runLocally(argv); // let the compiler print its usage
+
+  FILE *in = fopen(input.c_str(), "r");
+  if (in == NULL)
+  {
+    perror("Error opening file");
+    return 1;
+  }
+  std::string source;
+  char buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), in)) > 0)
+    source.append(buf, n);
+  fclose(in);
+
+  char cwd[PATH_MAX];
+  if (!getcwd(cwd, sizeof(cwd)))
+    return runLocally(argv);
+  size_t size = strlen(cwd) + std::to_string(argc - 1).size() + source.size();
+  for (int i = 1; i < argc; i++)
+    size += strlen(argv[i]);
+  if (argc - 1 > MaxRequestArgs || size > MaxRequestSize)
+    return runLocally(argv); // the server would refuse the request
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  sockaddr_un addr = socketAddress(defaultSocketPath());
+  if (fd < 0 || connect(fd, (sockaddr *)&addr, sizeof(addr)) < 0)
+    return runLocally(argv);
+
+  bool sent = sendFrame(fd, cwd) && sendFrame(fd, std::to_string(argc - 1));
+  for (int i = 1; sent && i < argc; i++)
+    sent = sendFrame(fd, argv[i]);
+  sent = sent && sendFrame(fd, source);
+
+  std::string rc, out, err, result;
+  if (!sent || !recvFrame(fd, rc) || !recvFrame(fd, out) || !recvFrame(fd, err) || !recvFrame(fd, result))
+  {
+    close(fd);
+    return runLocally(argv); // server went away mid request
+  }
+  close(fd);
+
+  fwrite(out.data(), 1, out.size(), stdout);
+  fwrite(err.data(), 1, err.size(), stderr);
+  if (rc != "0")
+    return atoi(rc.c_str());
+  if (result.empty())
+    return 0; // --stream has written its chunk files already
+
+  if (output.empty())
+    output = emitObject ? "output.o" : "output.ll";
+  FILE *dest = fopen(output.c_str(), "wb");
+  if (dest == NULL)
+  {
+    std::cerr << "Could not open file: " << strerror(errno);
+    return 1;
+  }
+  fwrite(result.data(), 1, result.size(), dest);
+  fclose(dest);
+  return 0;
+}
@@ -0,0 +1,108 @@
+// Prints the profile a program compiled with -finstrument=profile wrote as it
+// exited: a flat profile of the time spent in each MiniC function, by itself
+// (exclusive) and with the functions it called (inclusive), and the call
+// graph, every function with its callers and callees.
+//
+//   mccomp-prof [--limit=n] [profile]
+//
+// The profile is read from $MCCOMP_PROF_FILE or mccomp-prof.out by default.
+// --limit prints only the n functions with the most exclusive time.
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "profile.hpp"
+
+static std::string formatTime(double NS)
+{
+  char buf[32];
+  if (NS < 1e3)
+    snprintf(buf, sizeof(buf), "%.0f ns", NS);
+  else if (NS < 1e6)
+    snprintf(buf, sizeof(buf), "%.2f us", NS / 1e3);
+  else if (NS < 1e9)
+    snprintf(buf, sizeof(buf), "%.2f ms", NS / 1e6);
+  else
+    snprintf(buf, sizeof(buf), "%.2f s", NS / 1e9);
+  return buf;
+}
+
+static void printFlat(const Profile &P, const std::vector<std::string> &Order)
+{
+  double Total = 0;
+  for (auto &KV : P.Functions)
+    Total += KV.second.Exclusive;
+  fprintf(stdout, "Flat profile, %s in %u thread%s\n\n", formatTime(P.Time).c_str(), P.Threads,
+          P.Threads == 1 ? "" : "s");
+  fprintf(stdout, "%7s %12s %12s %12s %12s %12s  %s\n", "excl %", "exclusive", "inclusive", "calls", "excl/call",
+          "incl/call", "function");
+  for (auto &Name : Order)
+  {
+    const FunctionProfile &F = P.Functions.at(Name);
+    fprintf(stdout, "%7.2f %12s %12s %12llu %12s %12s  %s\n", Total > 0 ? 100 * F.Exclusive / Total : 0.0,
+            formatTime(F.Exclusive).c_str(), formatTime(F.Inclusive).c_str(), F.Calls,
+            formatTime(F.Exclusive / F.Calls).c_str(), formatTime(F.Inclusive / F.Calls).c_str(), Name.c_str());
+  }
+}
+
+static void printCallGraph(const Profile &P, const std::vector<std::string> &Order)
+{
+  fprintf(stdout, "\nCall graph, the time of each caller and callee is the callee's inclusive time\n");
+  for (auto &Name : Order)
+  {
+    const FunctionProfile &F = P.Functions.at(Name);
+    fprintf(stdout, "\n%s  %s inclusive, %s exclusive, %llu calls\n", Name.c_str(), formatTime(F.Inclusive).c_str(),
+            formatTime(F.Exclusive).c_str(), F.Calls);
+    for (auto &E : P.Edges)
+      if (E.Callee == Name)
+        fprintf(stdout, "    called by %-24s %12llu calls %12s\n", E.Caller.c_str(), E.Calls,
+                formatTime(E.Inclusive).c_str());
+    for (auto &E : P.Edges)
+      if (E.Caller == Name)
+        fprintf(stdout, "    calls     %-24s %12llu calls %12s\n", E.Callee.c_str(), E.Calls,
+                formatTime(E.Inclusive).c_str());
+  }
+}
+
+int main(int argc, char **argv)
+{
+  std::string Path = defaultProfilePath();
+  size_t Limit = 0;
+  for (int i = 1; i < argc; i++)
+  {
+    std::string arg = argv[i];
+    if (arg.compare(0, 8, "--limit=") == 0)
+      Limit = std::stoul(arg.substr(8));
+    else if (arg[0] == '-')
+    {
+      std::cerr << "Usage: mccomp-prof [--limit=n] [profile]\n";
+      return 1;
+    }
+    else
+      Path = arg;
+  }
+
+  Profile P;
+  std::string Error = readProfile(Path, P);
+  if (!Error.empty())
+  {
+    std::cerr << "mccomp-prof: " << Error << "\n";
+    return 1;
+  }
+
+  // the most exclusive time first
+  std::vector<std::string> Order;
+  for (auto &KV : P.Functions)
+    Order.push_back(KV.first);
+  std::stable_sort(Order.begin(), Order.end(), [&P](const std::string &A, const std::string &B)
+                   { return P.Functions.at(A).Exclusive > P.Functions.at(B).Exclusive; });
+  if (Limit > 0 && Order.size() > Limit)
+    Order.resize(Limit);
+
+  printFlat(P, Order);
+  printCallGraph(P, Order);
+  return 0;
+}
@@ -6,6 +6,7 @@
 #include <cctype>
 #include <cstdio>
 #include <cstdlib>
+#include <functional>
 #include <iostream>
 #include <map>
 #include <memory>
@@ -17,9 +18,15 @@
 #include <vector>
 
 #include "astnode.hpp"
+#include "backend.hpp"
+#include "incremental.hpp"
+#include "optimizer.hpp"
+#include "options.hpp"
 
 static std::unique_ptr<ProgramASTnode> parseProgram();
+static void parseProgramStreaming(const std::function<bool(std::unique_ptr<ASTnode>)> &Emit);
 static std::vector<std::unique_ptr<ExternASTnode>> parseExternList();
+static std::vector<std::string> parseAttributes();
 static std::unique_ptr<ExternASTnode> parseExtern();
 static std::vector<std::unique_ptr<ASTnode>> parseDeclList();
 static std::unique_ptr<ASTnode> parseDecl();
@@ -36,6 +43,7 @@ static std::unique_ptr<ASTnode> parseLocalDecl();
 static std::vector<std::unique_ptr<ASTnode>> parseStmtList();
 static std::unique_ptr<ASTnode> parseStmt();
 static std::unique_ptr<ASTnode> parseExprStmt();
+static LoopHints parseLoopPragmas();
 static std::unique_ptr<ASTnode> parseWhileStmt();
 static std::unique_ptr<ASTnode> parseIfStmt();
 static std::unique_ptr<ASTnode> parseElseStmt();
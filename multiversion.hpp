@@ -0,0 +1,253 @@
+#ifndef MULTIVERSION_HPP
+#define MULTIVERSION_HPP
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/GlobalIFunc.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Module.h"
+#include "llvm/TargetParser/Host.h"
+#include "llvm/TargetParser/Triple.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+
+#include "token.hpp"
+
+//===----------------------------------------------------------------------===//
+// Function multiversioning
+//===----------------------------------------------------------------------===//
+//
+// One binary can run at full speed on several CPU generations if its hot
+// functions are compiled once per instruction set, with the best version
+// picked when the program is loaded:
+//
+//   [[target_clones("avx512f", "avx2", "default")]]
+//   float dot(...) { ... }
+//
+// or -fmultiversion=avx512f,avx2,default for every function. Each function is
+// generated as dot.default, dot.avx2 and dot.avx512f, each optimised with its
+// own target-features. dot itself becomes an ifunc, whose resolver reads the
+// CPU's features from libgcc's (or compiler-rt's) __cpu_model, as GCC and
+// clang's resolvers do. The dynamic loader calls it once and binds every call
+// to dot to the clone it returns, the first of these the CPU supports:
+//
+//   avx512f avx2 fma avx sse4.2 sse4.1 ssse3 sse3 popcnt default
+//
+// ifuncs need x86-64 and ELF, on other targets only the default version is
+// generated. The JIT compiles for the CPU it runs on, so it generates the
+// version the resolver would pick and no resolver.
+
+// a target the resolver can test for, and its bit in __cpu_model's features,
+// best first
+struct CloneTarget
+{
+  const char *Name;
+  unsigned Bit;
+};
+
+static const CloneTarget CloneTargets[] = {
+    {"avx512f", 15},
+    {"avx2", 10},
+    {"fma", 14},
+    {"avx", 9},
+    {"sse4.2", 8},
+    {"sse4.1", 7},
+    {"ssse3", 6},
+    {"sse3", 5},
+    {"popcnt", 2},
+};
+
+// the targets of a multiversioned function, between its generation and
+// multiversionFunctions()
+static const char *CloneTargetsAttr = "mccomp-target-clones";
+
+// target_clones for target_clones("avx2", "default"), attributes are kept as
+// written
+static std::string attributeName(const std::string &Attr)
+{
+  return Attr.substr(0, Attr.find('('));
+}
+
+// {"avx2", "default"} for target_clones("avx2", "default"), the strings can't
+// contain quotes
+static std::vector<std::string> attributeArguments(const std::string &Attr)
+{
+  std::vector<std::string> Args;
+  for (size_t Open = Attr.find('"'); Open != std::string::npos; Open = Attr.find('"', Attr.find('"', Open + 1) + 1))
+    Args.push_back(Attr.substr(Open + 1, Attr.find('"', Open + 1) - Open - 1));
+  return Args;
+}
+
+static std::vector<std::string> splitList(const std::string &List)
+{
+  std::vector<std::string> Items;
+  size_t Start = 0;
+  while (Start <= List.size() && !List.empty())
+  {
+    size_t End = std::min(List.find(',', Start), List.size());
+    Items.push_back(List.substr(Start, End - Start));
+    Start = End + 1;
+  }
+  return Items;
+}
+
+// the targets of F's [[target_clones]] in Attrs, or of -fmultiversion, which
+// leaves main alone as the C runtime calls it directly
+static std::vector<std::string> cloneTargets(const Function &F, const std::vector<std::string> &Attrs)
+{
+  for (auto &Attr : Attrs)
+    if (attributeName(Attr) == "target_clones")
+      return attributeArguments(Attr);
+  if (F.getName() == "main")
+    return {};
+  return splitList(CS->Opts.Multiversion);
+}
+
+// "" if Targets are valid, otherwise what is wrong with them
+static std::string checkCloneTargets(const std::vector<std::string> &Targets)
+{
+  bool Default = false;
+  for (auto &T : Targets)
+  {
+    auto Known = [&T](const CloneTarget &C)
+    { return T == C.Name; };
+    Default |= T == "default";
+    if (T != "default" && std::none_of(std::begin(CloneTargets), std::end(CloneTargets), Known))
+    {
+      std::string Expected;
+      for (auto &C : CloneTargets)
+        Expected += std::string(C.Name) + ", ";
+      return "unknown target \"" + T + "\", expected one of " + Expected + "default";
+    }
+  }
+  return Default ? "" : "the targets don't include \"default\"";
+}
+
+// mark F, just created, for multiversioning if it is to be
+static void beginFunctionMultiversion(Function *F, const std::vector<std::string> &Attrs, const TOKEN &Tok)
+{
+  std::vector<std::string> Targets = cloneTargets(*F, Attrs);
+  if (Targets.empty())
+    return;
+  std::string Problem = checkCloneTargets(Targets);
+  if (!Problem.empty())
+    error(Tok, "`" + F->getName().str() + "` can't be multiversioned, " + Problem);
+  Triple T(sys::getDefaultTargetTriple());
+  if (!T.isX86() || (!T.isOSBinFormatELF() && CS->Opts.Output != OutputKind::JIT))
+  {
+    addWarning(Tok, "Multiversioning needs an x86-64 ELF target, only the default version of `" + F->getName().str() +
+                        "` is generated");
+    return;
+  }
+  std::string List;
+  for (auto &Target : Targets)
+    List += (List.empty() ? "" : ",") + Target;
+  F->addFnAttr(CloneTargetsAttr, List);
+}
+
+// F's target-features with +Feature added
+static void addTargetFeature(Function &F, const std::string &Feature)
+{
+  std::string Features = F.getFnAttribute("target-features").getValueAsString().str();
+  F.addFnAttr("target-features", (Features.empty() ? "" : Features + ",") + "+" + Feature);
+}
+
+// the resolver of a function whose default version is Default: the first of
+// Clones, best first, the CPU supports, or Default
+static Function *createResolver(Module &M, Function *Default, const std::vector<std::pair<const CloneTarget *, Function *>> &Clones)
+{
+  LLVMContext &C = M.getContext();
+  Type *I32 = Type::getInt32Ty(C);
+  Function *Resolver = Function::Create(FunctionType::get(Default->getType(), false), GlobalValue::InternalLinkage,
+                                        Default->getName().drop_back(strlen(".default")) + ".resolver", M);
+  IRBuilder<> B(BasicBlock::Create(C, "entry", Resolver));
+
+  // the dynamic loader may call the resolver before the runtime's constructor
+  // has filled __cpu_model in
+  B.CreateCall(M.getOrInsertFunction("__cpu_indicator_init", FunctionType::get(Type::getVoidTy(C), false)));
+  // struct { vendor, type, subtype, features[1] }
+  StructType *ModelTy = StructType::get(C, {I32, I32, I32, ArrayType::get(I32, 1)});
+  Constant *Model = M.getOrInsertGlobal("__cpu_model", ModelTy);
+  Value *Features = B.CreateLoad(I32, B.CreateInBoundsGEP(ModelTy, Model, {B.getInt32(0), B.getInt32(3), B.getInt32(0)}), "features");
+
+  for (auto &Clone : Clones)
+  {
+    Constant *Mask = ConstantInt::get(I32, 1u << Clone.first->Bit);
+    BasicBlock *Use = BasicBlock::Create(C, std::string("use.") + Clone.first->Name, Resolver);
+    BasicBlock *Next = BasicBlock::Create(C, "next", Resolver);
+    B.CreateCondBr(B.CreateICmpEQ(B.CreateAnd(Features, Mask), Mask), Use, Next);
+    B.SetInsertPoint(Use);
+    B.CreateRet(Clone.second);
+    B.SetInsertPoint(Next);
+  }
+  B.CreateRet(Default);
+  return Resolver;
+}
+
+// the best target the host supports, nullptr for the default
+static const CloneTarget *hostCloneTarget(const std::vector<std::string> &Targets)
+{
+#if LLVM_VERSION_MAJOR >= 19
+  StringMap<bool> Host = sys::getHostCPUFeatures();
+#else
+  StringMap<bool> Host;
+  sys::getHostCPUFeatures(Host);
+#endif
+  for (auto &C : CloneTargets)
+    if (std::find(Targets.begin(), Targets.end(), C.Name) != Targets.end() && Host.lookup(C.Name))
+      return &C;
+  return nullptr;
+}
+
+// clone every function marked by beginFunctionMultiversion() for each of its
+// targets, and dispatch between the clones with an ifunc
+static void multiversionFunctions(Module &M)
+{
+  std::vector<Function *> Marked;
+  for (Function &F : M)
+    if (F.hasFnAttribute(CloneTargetsAttr))
+      Marked.push_back(&F);
+
+  for (Function *F : Marked)
+  {
+    std::vector<std::string> Targets = splitList(F->getFnAttribute(CloneTargetsAttr).getValueAsString().str());
+    F->removeFnAttr(CloneTargetsAttr);
+    if (CS->Opts.Output == OutputKind::JIT)
+    {
+      if (const CloneTarget *Best = hostCloneTarget(Targets))
+        addTargetFeature(*F, Best->Name);
+      continue;
+    }
+
+    std::string Name = F->getName().str();
+    F->setName(Name + ".default");
+    F->setLinkage(GlobalValue::InternalLinkage);
+    std::vector<std::pair<const CloneTarget *, Function *>> Clones;
+    for (auto &C : CloneTargets)
+    {
+      if (std::find(Targets.begin(), Targets.end(), C.Name) == Targets.end())
+        continue;
+      ValueToValueMapTy VMap;
+      Function *Clone = CloneFunction(F, VMap);
+      Clone->setName(Name + "." + C.Name);
+      addTargetFeature(*Clone, C.Name);
+      Clones.push_back({&C, Clone});
+    }
+
+    // every call to the function but the resolver's returns, recursive calls in
+    // the clones too, goes through the ifunc
+    Function *Resolver = createResolver(M, F, Clones);
+    GlobalIFunc *IFunc = GlobalIFunc::create(F->getFunctionType(), F->getAddressSpace(), GlobalValue::ExternalLinkage, Name,
+                                             Resolver, &M);
+    F->replaceUsesWithIf(IFunc, [Resolver](Use &U)
+                         {
+                           auto *I = dyn_cast<Instruction>(U.getUser());
+                           return !I || I->getFunction() != Resolver; });
+  }
+}
+
+#endif
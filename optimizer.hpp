@@ -0,0 +1,96 @@
+#ifndef OPTIMIZER_HPP
+#define OPTIMIZER_HPP
+
+#include "llvm/Config/llvm-config.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Passes/OptimizationLevel.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Passes/StandardInstrumentations.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "attributes.hpp"
+#include "backend.hpp"
+#include "debuginfo.hpp"
+#include "instrument.hpp"
+#include "multiversion.hpp"
+#include "timing.hpp"
+
+using namespace llvm;
+
+//===----------------------------------------------------------------------===//
+// Optimisation pipeline
+//===----------------------------------------------------------------------===//
+
+// Every generated module passes through here before it is verified and
+// optimised: its debug info is finished, its math library calls lowered to
+// intrinsics, its functions given their inferred attributes and target CPU,
+// instrumented and multiversioned
+static void lowerModule(Module &M)
+{
+  finishDebugInfo();
+  if (CS->Summaries)
+    lowerMathCalls(M, CS->Summaries->Intrinsics);
+  setFunctionAttributes(M);
+  setTargetAttributes(M);
+  instrumentFunctions(M);
+  multiversionFunctions(M);
+}
+
+// codegen doesn't verify the functions it generates, the IR verifier runs over
+// each finished module only with --verify, or always in builds compiled with
+// -DMCCOMP_VERIFY_ALWAYS.
+static void checkModule(Module &M, bool Verify)
+{
+#ifndef MCCOMP_VERIFY_ALWAYS
+  if (!Verify)
+    return;
+#endif
+  PhaseScope Phase("verify", "IR verification");
+  std::string Problems;
+  raw_string_ostream out(Problems);
+  if (verifyModule(M, &out))
+    error("Generated invalid IR:\n" + out.str());
+}
+
+// run the standard LLVM pipeline for the given -O level over a module
+// -O0 leaves the module untouched so the emitted IR matches the AST one to one
+static void optimizeModule(Module &M, unsigned OptLevel)
+{
+  if (OptLevel == 0)
+    return;
+  PhaseScope Phase("opt", "Optimisation");
+
+  // time and trace every pass with -ftime-report and -ftime-trace
+  PassInstrumentationCallbacks PIC;
+  if (CS->Timers)
+    CS->Timers->Passes.registerCallbacks(PIC);
+#if LLVM_VERSION_MAJOR >= 17
+  TimeProfilingPassesHandler TimeProfiling;
+  TimeProfiling.registerCallbacks(PIC);
+#endif
+
+  LoopAnalysisManager LAM;
+  FunctionAnalysisManager FAM;
+  CGSCCAnalysisManager CGAM;
+  ModuleAnalysisManager MAM;
+
+  // the target's costs and vector registers, for the vectoriser
+  PassBuilder PB(getTargetMachine(), PipelineTuningOptions(), {}, &PIC);
+  TargetLibraryInfoImpl TLII = targetLibraryInfo(M);
+  FAM.registerPass([&]
+                   { return TargetLibraryAnalysis(TLII); });
+  PB.registerModuleAnalyses(MAM);
+  PB.registerCGSCCAnalyses(CGAM);
+  PB.registerFunctionAnalyses(FAM);
+  PB.registerLoopAnalyses(LAM);
+  PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+
+  OptimizationLevel Level = OptLevel == 1   ? OptimizationLevel::O1
+                            : OptLevel == 2 ? OptimizationLevel::O2
+                                            : OptimizationLevel::O3;
+  ModulePassManager MPM = PB.buildPerModuleDefaultPipeline(Level);
+  MPM.run(M, MAM);
+}
+
+#endif
@@ -0,0 +1,256 @@
+#ifndef OPTIONS_HPP
+#define OPTIONS_HPP
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+//===----------------------------------------------------------------------===//
+// Compiler options
+//===----------------------------------------------------------------------===//
+
+// what a compile produces, the command line can only ask for IR or Object
+enum class OutputKind
+{
+  IR,     // textual IR
+  Object, // object file for the host
+  Module, // the llvm::Module itself
+  JIT     // the module loaded into an ORC LLJIT
+};
+
+struct CompilerOptions
+{
+  std::string InputFile;
+  std::string OutputFile;              // -o <file>, defaults to output.ll or output.o
+  OutputKind Output = OutputKind::IR;  // --emit=llvm|obj
+  unsigned OptLevel = 0;               // -O0 .. -O3
+  bool Incremental = false;            // --incremental, only rebuild functions that changed
+  std::string CacheDir = ".mccache";   // --cache-dir=<dir>, where incremental builds keep their artifacts
+  bool Pipeline = false;               // --pipeline, lex, parse and generate code on separate threads
+  unsigned Stream = 0;                 // --stream[=<n>], write the program out n functions at a time, 0 is off
+  bool FastMath = false;               // -ffast-math, let the optimiser ignore IEEE semantics, see fastmath.hpp
+  bool AssociativeMath = false;        // -fassociative-math, let it reorder float sums and products
+  std::string FPContract = "off";      // -ffp-contract=fast|on|off, fuse multiplies and adds
+  bool Builtins = true;                // -fno-builtin, don't treat externs like sqrt as the math library's, see mathlib.hpp
+  std::string VecLib = "none";         // -fveclib=<library>, the vector math library loops may call
+  std::string CPU;                     // -march=<cpu> or -mcpu=<cpu>, native for the host's, see backend.hpp
+  std::string Features;                // -mattr=+avx2,-avx512f,..., on top of the CPU's
+  std::string Multiversion;            // -fmultiversion=avx2,default, clone every function, see multiversion.hpp
+  bool Verify = false;                 // --verify, run the IR verifier over the generated code
+  bool Debug = false;                  // -g, emit DWARF debug info mapping the code to source lines
+  bool InstrumentProfile = false;      // -finstrument=profile, count and time every function's calls
+  bool ProfileGenerate = false;        // -fprofile-generate, count calls and branches for -fprofile-use
+  std::string ProfileUse;              // -fprofile-use=<file>, optimise with the counts of a profile
+  std::string RemarksPassed;           // -Rpass[=<regex>], report the optimisations passes matching regex made
+  std::string RemarksMissed;           // -Rpass-missed[=<regex>], report the ones they could not make
+  std::string RemarksAnalysis;         // -Rpass-analysis[=<regex>], report why
+  bool SaveOptimizationRecord = false; // -fsave-optimization-record[=<format>], write every remark to a file
+  std::string OptimizationRecordFormat = "yaml";
+  std::string OptimizationRecordFile;  // -foptimization-record-file=<file>, defaults to <output>.opt.<format>
+  bool ExportSummary = false;          // --export-summary[=<file>], write the attributes inferred for every function
+  std::string ExportSummaryFile;       // defaults to <output>.summary
+  std::vector<std::string> ImportSummaries; // --import-summary=<file>, what other files' functions do
+  bool TimeReport = false;             // -ftime-report, time every phase and optimisation pass
+  bool TimeTrace = false;              // -ftime-trace[=<file>], write a Chrome trace of the compile
+  std::string TimeTraceFile;           // defaults to <output>.time-trace
+  unsigned TimeTraceGranularity = 500; // -ftime-trace-granularity=<us>, shorter spans are dropped
+  bool Stats = false;                  // --stats[=json], report token, AST, IR and memory statistics
+  bool StatsJSON = false;              // as JSON
+  bool Watch = false;                  // --watch, recompile whenever the input file changes
+  bool Serve = false;                  // --serve[=<socket>], run as a compile server
+  std::string SocketPath;              // defaults to defaultSocketPath()
+  unsigned Workers = 0;                // --workers=<n>, compile server processes, defaults to one per core
+  bool JITProfiling = false;           // JIT: tell perf and gdb about the code, see jitprofiling.hpp
+  bool Verbose = false;                // print the AST and progress to stdout, as the command line compiler does
+};
+
+// the options that change the code generated for a function, or the warnings
+// and remarks reported with it, which incremental builds key cached functions
+// on (see incremental.hpp). An option added above that does must be added
+// here. What they resolve to, the CPU -march=native is, the target and the
+// contents of the -fprofile-use file, is keyed on by incremental.hpp, as are
+// the attributes --import-summary gives the functions a function calls
+static std::string optionsSignature(const CompilerOptions &O)
+{
+  return "|emit=" + std::to_string(int(O.Output)) + "|O" + std::to_string(O.OptLevel) + (O.Debug ? "|g" : "") +
+         (O.FastMath ? "|fast-math" : "") + (O.AssociativeMath ? "|associative-math" : "") +
+         (O.FPContract != "off" ? "|fp-contract=" + O.FPContract : "") + (O.Builtins ? "" : "|no-builtin") +
+         (O.VecLib != "none" ? "|veclib=" + O.VecLib : "") + (O.CPU.empty() ? "" : "|march=" + O.CPU) +
+         (O.Features.empty() ? "" : "|mattr=" + O.Features) +
+         (O.Multiversion.empty() ? "" : "|multiversion=" + O.Multiversion) + (O.InstrumentProfile ? "|profile" : "") +
+         (O.ProfileGenerate ? "|profile-generate" : "") + (O.ProfileUse.empty() ? "" : "|profile-use") +
+         "|R" + O.RemarksPassed + "|" + O.RemarksMissed + "|" + O.RemarksAnalysis +
+         (O.SaveOptimizationRecord ? "|record" : "");
+}
+
+static void printUsage()
+{
+  std::cout << "Usage: ./mccomp [options] InputFile\n"
+            << "Options:\n"
+            << "  -o <file>            output file (default output.ll, or output.o with --emit=obj)\n"
+            << "  --emit=llvm|obj      emit textual IR (default) or an object file\n"
+            << "  -O0, -O1, -O2, -O3   optimisation level (default -O0)\n"
+            << "  --incremental        only regenerate functions that changed since the last build\n"
+            << "  --cache-dir=<dir>    directory for incremental build artifacts (default .mccache)\n"
+            << "  --pipeline           lex, parse and generate code concurrently on separate threads\n"
+            << "  --stream[=<n>]       generate and write out code n functions (default 256) at a time\n"
+            << "                       into output.0.ll, output.1.ll, ... to bound memory use\n"
+            << "  -ffast-math          ignore IEEE float semantics where it makes code faster\n"
+            << "  -fassociative-math   allow float sums and products to be reordered\n"
+            << "  -ffp-contract=fast|on|off\n"
+            << "                       fuse multiplies and adds anywhere, within an expression,\n"
+            << "                       or never (default off)\n"
+            << "  -fno-builtin         don't treat externs like sqrt and sin as the C math library's\n"
+            << "  -fveclib=<library>   vectorise math calls in loops with libmvec, SVML, SLEEF, ArmPL,\n"
+            << "                       MASSV, Accelerate or Darwin_libsystem_m (default none)\n"
+            << "  -march=<cpu>, -mcpu=<cpu>\n"
+            << "                       generate code for this CPU, native for the host's with all\n"
+            << "                       its features (default a generic CPU)\n"
+            << "  -mattr=<+feature,-feature,...>\n"
+            << "                       enable or disable CPU features, like +avx2\n"
+            << "  -fmultiversion=<target,...,default>\n"
+            << "                       generate every function for each target, like avx2, and\n"
+            << "                       pick the CPU's best when the program is loaded\n"
+            << "  --verify             check the generated IR with the LLVM verifier\n"
+            << "  -g                   emit debug info (DWARF) for debuggers and profilers\n"
+            << "  -finstrument=profile instrument every function to profile its calls, link with\n"
+            << "                       libmccomp-prof.a and read the profile with mccomp-prof\n"
+            << "  -fprofile-generate   count every function's calls and branches, link with\n"
+            << "                       libmccomp-prof.a, the program writes mccomp.proftext\n"
+            << "  -fprofile-use=<file> optimise with a profile -fprofile-generate wrote, or an\n"
+            << "                       llvm-profdata merge of several\n"
+            << "  -Rpass[=<regex>]     report the optimisations made by passes matching regex\n"
+            << "  -Rpass-missed[=<regex>]\n"
+            << "                       report the optimisations they could not make\n"
+            << "  -Rpass-analysis[=<regex>]\n"
+            << "                       report why\n"
+            << "  -fsave-optimization-record[=yaml|bitstream]\n"
+            << "                       write every remark to <output>.opt.yaml or .opt.bitstream\n"
+            << "  -foptimization-record-file=<file>\n"
+            << "                       write them to file instead\n"
+            << "  --export-summary[=<file>]\n"
+            << "                       write the attributes inferred for every function to file\n"
+            << "                       (default <output>.summary) for other files to import\n"
+            << "  --import-summary=<file>\n"
+            << "                       give the extern functions another file defines its attributes\n"
+            << "  -ftime-report        print the time spent in every phase and optimisation pass\n"
+            << "  -ftime-trace[=<file>]\n"
+            << "                       write a Chrome trace of the compile (default <output>.time-trace)\n"
+            << "  -ftime-trace-granularity=<us>\n"
+            << "                       leave spans shorter than this out of the trace (default 500)\n"
+            << "  --stats[=json]       report token, AST node, generated IR and memory statistics\n"
+            << "  --watch              recompile whenever the input file changes\n"
+            << "  --serve[=<socket>]   run as a compile server for mccomp-client\n"
+            << "  --workers=<n>        number of compile server processes (default one per core)\n";
+}
+
+// returns false if the command line is invalid
+static bool parseCommandLine(int argc, char **argv, CompilerOptions &Opts)
+{
+  for (int i = 1; i < argc; i++)
+  {
+    std::string arg = argv[i];
+    if (arg == "-o" && i + 1 < argc)
+      Opts.OutputFile = argv[++i];
+    else if (arg == "--emit=obj" || arg == "--emit=llvm")
+      Opts.Output = arg == "--emit=obj" ? OutputKind::Object : OutputKind::IR;
+    else if (arg.size() == 3 && arg.compare(0, 2, "-O") == 0 && arg[2] >= '0' && arg[2] <= '3')
+      Opts.OptLevel = arg[2] - '0';
+    else if (arg == "--incremental")
+      Opts.Incremental = true;
+    else if (arg.compare(0, 12, "--cache-dir=") == 0)
+      Opts.CacheDir = arg.substr(12);
+    else if (arg == "--pipeline")
+      Opts.Pipeline = true;
+    else if (arg == "--stream" || arg.compare(0, 9, "--stream=") == 0)
+      Opts.Stream = arg.size() > 9 ? std::max(1, atoi(arg.substr(9).c_str())) : 256;
+    else if (arg == "-ffast-math")
+      Opts.FastMath = true;
+    else if (arg == "-fassociative-math")
+      Opts.AssociativeMath = true;
+    else if (arg == "-ffp-contract=fast" || arg == "-ffp-contract=on" || arg == "-ffp-contract=off")
+      Opts.FPContract = arg.substr(14);
+    else if (arg == "-fno-builtin")
+      Opts.Builtins = false;
+    else if (arg.compare(0, 9, "-fveclib=") == 0 &&
+             std::string(" none libmvec SVML SLEEF ArmPL MASSV Accelerate Darwin_libsystem_m ").find(" " + arg.substr(9) + " ") != std::string::npos)
+      Opts.VecLib = arg.substr(9);
+    else if ((arg.compare(0, 7, "-march=") == 0 || arg.compare(0, 6, "-mcpu=") == 0) && arg.find('=') + 1 < arg.size())
+      Opts.CPU = arg.substr(arg.find('=') + 1);
+    else if (arg.compare(0, 7, "-mattr=") == 0 && (arg[7] == '+' || arg[7] == '-'))
+      Opts.Features = Opts.Features.empty() ? arg.substr(7) : Opts.Features + "," + arg.substr(7);
+    else if (arg.compare(0, 15, "-fmultiversion=") == 0 && arg.size() > 15)
+      Opts.Multiversion = arg.substr(15);
+    else if (arg == "--verify")
+      Opts.Verify = true;
+    else if (arg == "-g")
+      Opts.Debug = true;
+    else if (arg == "-finstrument=profile")
+      Opts.InstrumentProfile = true;
+    else if (arg == "-fprofile-generate")
+      Opts.ProfileGenerate = true;
+    else if (arg.compare(0, 14, "-fprofile-use=") == 0)
+      Opts.ProfileUse = arg.substr(14);
+    else if (arg == "-Rpass" || arg.compare(0, 7, "-Rpass=") == 0)
+      Opts.RemarksPassed = arg.size() > 7 ? arg.substr(7) : ".*";
+    else if (arg == "-Rpass-missed" || arg.compare(0, 14, "-Rpass-missed=") == 0)
+      Opts.RemarksMissed = arg.size() > 14 ? arg.substr(14) : ".*";
+    else if (arg == "-Rpass-analysis" || arg.compare(0, 16, "-Rpass-analysis=") == 0)
+      Opts.RemarksAnalysis = arg.size() > 16 ? arg.substr(16) : ".*";
+    else if (arg == "-fsave-optimization-record" || arg.compare(0, 27, "-fsave-optimization-record=") == 0)
+    {
+      Opts.SaveOptimizationRecord = true;
+      Opts.OptimizationRecordFormat = arg.size() > 27 ? arg.substr(27) : "yaml";
+    }
+    else if (arg.compare(0, 27, "-foptimization-record-file=") == 0)
+    {
+      Opts.SaveOptimizationRecord = true;
+      Opts.OptimizationRecordFile = arg.substr(27);
+    }
+    else if (arg == "--export-summary" || arg.compare(0, 17, "--export-summary=") == 0)
+    {
+      Opts.ExportSummary = true;
+      Opts.ExportSummaryFile = arg.size() > 17 ? arg.substr(17) : "";
+    }
+    else if (arg.compare(0, 17, "--import-summary=") == 0)
+      Opts.ImportSummaries.push_back(arg.substr(17));
+    else if (arg == "-ftime-report")
+      Opts.TimeReport = true;
+    else if (arg == "-ftime-trace" || arg.compare(0, 13, "-ftime-trace=") == 0)
+    {
+      Opts.TimeTrace = true;
+      Opts.TimeTraceFile = arg.size() > 13 ? arg.substr(13) : "";
+    }
+    else if (arg.compare(0, 25, "-ftime-trace-granularity=") == 0)
+      Opts.TimeTraceGranularity = atoi(arg.substr(25).c_str());
+    else if (arg == "--stats" || arg == "--stats=json")
+    {
+      Opts.Stats = true;
+      Opts.StatsJSON = arg == "--stats=json";
+    }
+    else if (arg == "--watch")
+      Opts.Watch = true;
+    else if (arg == "--serve" || arg.compare(0, 8, "--serve=") == 0)
+    {
+      Opts.Serve = true;
+      Opts.SocketPath = arg.size() > 8 ? arg.substr(8) : "";
+    }
+    else if (arg.compare(0, 10, "--workers=") == 0)
+      Opts.Workers = atoi(arg.substr(10).c_str());
+    else if (arg[0] == '-')
+    {
+      fprintf(stderr, "Unknown option: %s\n", arg.c_str());
+      return false;
+    }
+    else if (Opts.InputFile.empty())
+      Opts.InputFile = arg;
+    else
+      return false;
+  }
+  return Opts.Serve || !Opts.InputFile.empty();
+}
+
+#endif
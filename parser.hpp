@@ -0,0 +1,886 @@
+#ifndef PARSER_HPP
+#define PARSER_HPP
+
+#include "mccomp.hpp"
+#include "stats.hpp"
+
+//===----------------------------------------------------------------------===//
+// Recursive Descent Parser - Function call for each production
+//===----------------------------------------------------------------------===//
+
+// every AST node is made here, so --stats can count them by class
+template <typename T, typename... Args>
+static std::unique_ptr<T> newNode(Args &&...args)
+{
+  if (CS->Stats)
+    CS->Stats->countNode(T::Kind, sizeof(T));
+  return std::make_unique<T>(std::forward<Args>(args)...);
+}
+
+// program ::= extern_list decl_list | decl_list
+static std::unique_ptr<ProgramASTnode> parseProgram()
+{
+  std::vector<std::unique_ptr<ExternASTnode>> externs = parseExternList();
+  std::vector<std::unique_ptr<ASTnode>> decls = parseDeclList();
+  return newNode<ProgramASTnode>(std::move(externs), std::move(decls));
+};
+
+// Same grammar as parseProgram(), but every extern and declaration is handed
+// to Emit as soon as it is parsed instead of being collected into a
+// ProgramASTnode. Stops early if Emit returns false.
+static void parseProgramStreaming(const std::function<bool(std::unique_ptr<ASTnode>)> &Emit)
+{
+  while (CS->CurTok.type == EXTERN)
+  {
+    if (!Emit(parseExtern()))
+      return;
+  }
+  while (CS->CurTok.type != EOF_TOK)
+  {
+    if (!Emit(parseDecl()))
+      return;
+  }
+};
+
+// extern_list ::= extern extern_list | extern
+static std::vector<std::unique_ptr<ExternASTnode>> parseExternList()
+{
+  std::vector<std::unique_ptr<ExternASTnode>> externs;
+  while (CS->CurTok.type == EXTERN)
+  {
+    externs.push_back(parseExtern());
+  }
+  return externs;
+};
+
+// attributes ::= "[[" attribute_names "]]" attributes | empty
+// attribute_names ::= attribute "," attribute_names | attribute
+// attribute ::= IDENT | IDENT "(" strings ")"
+// strings ::= STRING_LIT "," strings | STRING_LIT
+static std::vector<std::string> parseAttributes()
+{
+  std::vector<std::string> attrs;
+  FunctionAttrs Declared;
+  while (CS->CurTok.type == ATTR_OPEN)
+  {
+    getNextToken(); // eat [[
+    while (true)
+    {
+      if (CS->CurTok.type != IDENT)
+        error(CS->CurTok, "Expected attribute name");
+      TOKEN saveToken = CS->CurTok;
+      std::string name = CS->CurTok.lexeme, attr = name;
+      getNextToken(); // eat IDENT
+
+      // kept as written, see attributeArguments()
+      if (CS->CurTok.type == LPAR)
+      {
+        getNextToken(); // eat (
+        attr += "(";
+        while (true)
+        {
+          if (CS->CurTok.type != STRING_LIT)
+            error(CS->CurTok, "Expected string in the arguments of [[" + name + "]]");
+          attr += "\"" + CS->CurTok.lexeme + "\"";
+          getNextToken(); // eat STRING_LIT
+          if (CS->CurTok.type != COMMA)
+            break;
+          attr += ", ";
+          getNextToken(); // eat ,
+        }
+        if (CS->CurTok.type != RPAR)
+          error(CS->CurTok, "Expected ) after the arguments of [[" + name + "]]");
+        getNextToken(); // eat )
+        attr += ")";
+      }
+
+      if (!declareAttribute(Declared, name))
+        addWarning(saveToken, "Unknown attribute `" + name + "` ignored");
+      else if (name == "target_clones" && attr == name)
+        error(saveToken, "[[target_clones]] needs the targets to clone the function for");
+      else if (name != "target_clones" && attr != name)
+        error(saveToken, "[[" + name + "]] takes no arguments");
+      else
+        attrs.push_back(attr);
+
+      if (Declared.Hot && Declared.Cold)
+        error(saveToken, "A function can't be both [[hot]] and [[cold]]");
+      if (Declared.NoInline && (Declared.InlineHint || Declared.AlwaysInline))
+        error(saveToken, "A function can't be both [[noinline]] and [[inline]] or [[always_inline]]");
+      if (CS->CurTok.type != COMMA)
+        break;
+      getNextToken(); // eat ,
+    }
+    if (CS->CurTok.type != ATTR_CLOSE)
+      error(CS->CurTok, "Expected ]] after attributes");
+    getNextToken(); // eat ]]
+  }
+  return attrs;
+};
+
+// extern ::= "extern" attributes type_spec IDENT "(" params ")" ";"
+static std::unique_ptr<ExternASTnode> parseExtern()
+{
+  getNextToken(); // eat extern
+
+  TOKEN attrToken = CS->CurTok;
+  std::vector<std::string> attrs = parseAttributes();
+  for (auto &attr : attrs)
+    if (attributeName(attr) == "fast_math" || attributeName(attr) == "target_clones")
+      addWarning(attrToken, "[[" + attributeName(attr) + "]] has no effect on an extern declaration");
+  std::unique_ptr<TypeASTnode> type = parseTypeSpec(); // eat type_spec
+
+  if (CS->CurTok.type != IDENT)
+    error(CS->CurTok, "Expected identifier in extern declaration");
+  std::string externName = CS->CurTok.lexeme;
+  TOKEN saveToken = CS->CurTok;
+  getNextToken(); // eat IDENT
+
+  if (CS->CurTok.type != LPAR)
+    error(CS->CurTok, "Expected ( in extern declaration");
+  getNextToken(); // eat (
+
+  std::vector<std::unique_ptr<ParamASTnode>> params = parseParams();
+
+  if (CS->CurTok.type != RPAR)
+    error(CS->CurTok, "Expected ) in extern declaration");
+  getNextToken(); // eat )
+
+  if (CS->CurTok.type != SC)
+    error(CS->CurTok, "Expected ; in extern declaration");
+  getNextToken(); // eat ;
+  return newNode<ExternASTnode>(std::move(type), externName, std::move(params), saveToken, std::move(attrs));
+};
+
+// decl_list ::= decl decl_list | decl
+static std::vector<std::unique_ptr<ASTnode>> parseDeclList()
+{
+  std::vector<std::unique_ptr<ASTnode>> decls;
+  while (CS->CurTok.type != EOF_TOK)
+  {
+    decls.push_back(parseDecl());
+  }
+  return decls;
+};
+
+// decl ::= var_decl | fun_decl
+static std::unique_ptr<ASTnode> parseDecl()
+{
+  if (CS->RecordTokens)
+    resetRecordedTokens(); // the recorded range now starts at this declaration
+
+  TOKEN attrToken = CS->CurTok;
+  std::vector<std::string> attrs = parseAttributes();
+  std::unique_ptr<TypeASTnode> type = parseTypeSpec();
+  std::string name = CS->CurTok.lexeme;
+  TOKEN saveToken = CS->CurTok;
+  getNextToken(); // eat IDENT
+
+  if (CS->CurTok.type == SC)
+  {
+    if (!attrs.empty())
+      error(attrToken, "Attributes can only be given to functions");
+    getNextToken(); // eat ;
+    return newNode<VarDeclASTnode>(std::move(type), name, saveToken);
+  }
+  else if (CS->CurTok.type == LPAR)
+  {
+    // fun_decl ::= attributes type_spec IDENT "(" params ")" block
+    getNextToken(); // eat (
+    std::vector<std::unique_ptr<ParamASTnode>> params = parseParams();
+    if (CS->CurTok.type != RPAR)
+      error(CS->CurTok, "Expected ) in function declaration");
+    getNextToken(); // eat )
+    std::unique_ptr<ASTnode> body = parseBlock();
+    std::unique_ptr<FunctionASTnode> func = newNode<FunctionASTnode>(std::move(type), name, std::move(params), std::move(body), saveToken, std::move(attrs));
+    if (CS->RecordTokens)
+      recordFunctionTokens(*func);
+    return func;
+  }
+  else
+  {
+    error(CS->CurTok, "Expected ; or ( in declaration");
+    return nullptr;
+  }
+};
+
+// var_decl ::= var_type IDENT ";"
+static std::unique_ptr<VarDeclASTnode> parseVarDecl()
+{
+  std::unique_ptr<TypeASTnode> type = parseVarType();
+
+  if (CS->CurTok.type != IDENT)
+    error(CS->CurTok, "Expected identifier in variable declaration");
+  std::string varName = CS->CurTok.lexeme;
+  TOKEN saveToken = CS->CurTok;
+  getNextToken(); // eat IDENT
+
+  if (CS->CurTok.type != SC)
+    error(CS->CurTok, "Expected ; in variable declaration");
+  getNextToken(); // eat ;
+  return newNode<VarDeclASTnode>(std::move(type), varName, saveToken);
+};
+
+// type_spec ::= "void" | var_type
+static std::unique_ptr<TypeASTnode> parseTypeSpec()
+{
+  if (CS->CurTok.type == VOID_TOK)
+  {
+    TOKEN saveToken = CS->CurTok;
+    getNextToken(); // eat void
+    return newNode<TypeASTnode>("void", saveToken);
+  }
+  else
+  {
+    return parseVarType();
+  }
+};
+
+// var_type ::= "int" | "float" | "bool"
+static std::unique_ptr<TypeASTnode> parseVarType()
+{
+  TOKEN saveToken = CS->CurTok;
+  switch (CS->CurTok.type)
+  {
+  case INT_TOK:
+    getNextToken(); // eat int
+    return newNode<TypeASTnode>("int", saveToken);
+    break;
+  case FLOAT_TOK:
+    getNextToken(); // eat float
+    return newNode<TypeASTnode>("float", saveToken);
+    break;
+  case BOOL_TOK:
+    getNextToken(); // eat bool
+    return newNode<TypeASTnode>("bool", saveToken);
+    break;
+  default:
+    error(CS->CurTok, "Expected a type here");
+    return nullptr;
+    break;
+  }
+};
+
+// Not needed since we are parsing function declarations in due to lookahead requirement parseDecl()
+// fun_decl ::= type_spec IDENT "(" params ")" block
+static std::unique_ptr<FunctionASTnode> parseFunctionDecl()
+{
+  std::unique_ptr<TypeASTnode> type = parseTypeSpec();
+
+  if (CS->CurTok.type != IDENT)
+    error(CS->CurTok, "Expected identifier in function declaration");
+  std::string funcName = CS->CurTok.lexeme;
+  TOKEN saveToken = CS->CurTok;
+  getNextToken(); // eat IDENT
+
+  if (CS->CurTok.type != LPAR)
+    error(CS->CurTok, "Expected ( in function declaration");
+  getNextToken(); // eat (
+
+  std::vector<std::unique_ptr<ParamASTnode>> params = parseParams();
+
+  if (CS->CurTok.type != RPAR)
+    error(CS->CurTok, "Expected ) in function declaration");
+  getNextToken(); // eat )
+
+  std::unique_ptr<ASTnode> body = parseBlock();
+
+  return newNode<FunctionASTnode>(std::move(type), funcName, std::move(params), std::move(body), saveToken);
+};
+
+// params ::= param_list | "void" | empty
+static std::vector<std::unique_ptr<ParamASTnode>> parseParams()
+{
+  std::vector<std::unique_ptr<ParamASTnode>> params;
+  if (CS->CurTok.type == VOID_TOK)
+  {
+    getNextToken(); // eat void
+    return params;
+  }
+  else if (CS->CurTok.type == RPAR)
+  {
+    return params;
+  }
+  else
+  {
+    params = parseParamList();
+    return params;
+  }
+};
+
+// param_list ::= param "," param_list | param
+static std::vector<std::unique_ptr<ParamASTnode>> parseParamList()
+{
+  std::vector<std::unique_ptr<ParamASTnode>> params;
+  params.push_back(parseParam());
+  while (CS->CurTok.type == COMMA)
+  {
+    getNextToken(); // eat ,
+    params.push_back(parseParam());
+  }
+  return params;
+};
+
+// param ::= var_type IDENT
+static std::unique_ptr<ParamASTnode> parseParam()
+{
+  std::unique_ptr<TypeASTnode> type = parseVarType();
+
+  if (CS->CurTok.type != IDENT)
+    error(CS->CurTok, "Expected identifier in parameter declaration");
+  std::string paramName = CS->CurTok.lexeme;
+  TOKEN saveToken = CS->CurTok;
+  getNextToken(); // eat IDENT
+
+  return newNode<ParamASTnode>(std::move(type), paramName, saveToken);
+};
+
+// block ::= "{" local_decls stmt_list "}"
+static std::unique_ptr<BlockASTnode> parseBlock()
+{
+  if (CS->CurTok.type != LBRA)
+    error(CS->CurTok, "Expected { in block");
+  TOKEN saveToken = CS->CurTok;
+  getNextToken(); // eat {
+
+  std::vector<std::unique_ptr<ASTnode>> local_decls = parseLocalDecls();
+  std::vector<std::unique_ptr<ASTnode>> stmt_list = parseStmtList();
+
+  if (CS->CurTok.type != RBRA)
+    error(CS->CurTok, "Expected } in block");
+  getNextToken(); // eat }
+
+  return newNode<BlockASTnode>(std::move(local_decls), std::move(stmt_list), saveToken);
+};
+
+// local_decls ::= local_decl local_decls | empty
+static std::vector<std::unique_ptr<ASTnode>> parseLocalDecls()
+{
+  std::vector<std::unique_ptr<ASTnode>> local_decls;
+  while (CS->CurTok.type == INT_TOK || CS->CurTok.type == FLOAT_TOK || CS->CurTok.type == BOOL_TOK)
+  {
+    local_decls.push_back(parseLocalDecl());
+  }
+  return local_decls;
+};
+
+// local_decl ::= var_type IDENT ";"
+static std::unique_ptr<ASTnode> parseLocalDecl()
+{
+  std::unique_ptr<TypeASTnode> type = parseVarType();
+
+  if (CS->CurTok.type != IDENT)
+    error(CS->CurTok, "Expected identifier in local declaration");
+  std::string declName = CS->CurTok.lexeme;
+  TOKEN saveToken = CS->CurTok;
+  getNextToken(); // eat IDENT
+
+  if (CS->CurTok.type != SC)
+    error(CS->CurTok, "Expected ; at the end of a local declaration");
+  getNextToken(); // eat ;
+  return newNode<VarDeclASTnode>(std::move(type), declName, saveToken);
+};
+
+// stmt_list ::= stmt stmt_list | empty
+static std::vector<std::unique_ptr<ASTnode>> parseStmtList()
+{
+  std::vector<std::unique_ptr<ASTnode>> stmt_list;
+  while (CS->CurTok.type != RBRA)
+  {
+    stmt_list.push_back(parseStmt());
+  }
+  return stmt_list;
+};
+
+// stmt ::= expr_stmt | block | if_stmt | while_stmt | return_stmt
+static std::unique_ptr<ASTnode> parseStmt()
+{
+  switch (CS->CurTok.type)
+  {
+  case LBRA:
+    return parseBlock();
+    break;
+  case IF:
+    return parseIfStmt();
+    break;
+  case HASH:
+  case WHILE:
+    return parseWhileStmt();
+    break;
+  case RETURN:
+    return parseReturnStmt();
+    break;
+  default:
+    return parseExprStmt();
+    break;
+  }
+};
+
+// expr_stmt ::= expr ";"
+static std::unique_ptr<ASTnode> parseExprStmt()
+{
+  std::unique_ptr<ASTnode> expr = parseExpr();
+
+  if (CS->CurTok.type != SC)
+    error(CS->CurTok, "Expected ; in expression statement");
+  getNextToken(); // eat ;
+  return expr;
+};
+
+// loop_pragmas ::= loop_pragma loop_pragmas | empty
+// loop_pragma ::= "#" "pragma" IDENT "(" INT_LIT ")"
+static LoopHints parseLoopPragmas()
+{
+  LoopHints hints;
+  while (CS->CurTok.type == HASH)
+  {
+    getNextToken(); // eat #
+    if (CS->CurTok.type != IDENT || CS->CurTok.lexeme != "pragma")
+      error(CS->CurTok, "Expected pragma after #");
+    getNextToken(); // eat pragma
+
+    if (CS->CurTok.type != IDENT)
+      error(CS->CurTok, "Expected unroll, vectorize or interleave in pragma");
+    TOKEN nameToken = CS->CurTok;
+    unsigned *hint = nameToken.lexeme == "unroll"      ? &hints.Unroll
+                     : nameToken.lexeme == "vectorize"  ? &hints.VectorizeWidth
+                     : nameToken.lexeme == "interleave" ? &hints.Interleave
+                                                        : nullptr;
+    if (!hint)
+      error(nameToken, "Unknown pragma, expected unroll, vectorize or interleave");
+    getNextToken(); // eat IDENT
+
+    if (CS->CurTok.type != LPAR)
+      error(CS->CurTok, "Expected ( in pragma");
+    getNextToken(); // eat (
+    // getAsInteger() is true on overflow
+    if (CS->CurTok.type != INT_LIT || StringRef(CS->CurTok.lexeme).getAsInteger(10, *hint) || *hint < 1)
+      error(CS->CurTok, "Expected a positive integer in pragma");
+    getNextToken(); // eat INT_LIT
+    if (CS->CurTok.type != RPAR)
+      error(CS->CurTok, "Expected ) in pragma");
+    getNextToken(); // eat )
+  }
+  if (CS->CurTok.type != WHILE)
+    error(CS->CurTok, "Loop pragmas must be followed by a while loop");
+  return hints;
+};
+
+// while_stmt ::= loop_pragmas "while" "(" expr ")" stmt
+static std::unique_ptr<ASTnode> parseWhileStmt()
+{
+  LoopHints hints = parseLoopPragmas();
+  if (CS->CurTok.type != WHILE)
+    error(CS->CurTok, "Expected while in while statement");
+  TOKEN saveToken = CS->CurTok;
+  getNextToken(); // eat while
+
+  if (CS->CurTok.type != LPAR)
+    error(CS->CurTok, "Expected ( in while statement");
+  getNextToken(); // eat (
+
+  std::unique_ptr<ASTnode> expr = parseExpr();
+
+  if (CS->CurTok.type != RPAR)
+    error(CS->CurTok, "Expected ) in while statement");
+  getNextToken(); // eat )
+
+  std::unique_ptr<ASTnode> stmt = parseStmt();
+
+  return newNode<WhileASTnode>(std::move(expr), std::move(stmt), saveToken, hints);
+};
+
+// if_stmt ::= "if" "(" expr ")" block else_stmt
+static std::unique_ptr<ASTnode> parseIfStmt()
+{
+  if (CS->CurTok.type != IF)
+    error(CS->CurTok, "Expected if in if statement");
+  TOKEN saveToken = CS->CurTok;
+  getNextToken(); // eat if
+
+  if (CS->CurTok.type != LPAR)
+    error(CS->CurTok, "Expected ( in if statement");
+  getNextToken(); // eat (
+
+  std::unique_ptr<ASTnode> expr = parseExpr();
+
+  if (CS->CurTok.type != RPAR)
+    error(CS->CurTok, "Expected ) in if statement");
+  getNextToken(); // eat )
+
+  std::unique_ptr<ASTnode> block = parseBlock();
+
+  std::unique_ptr<ASTnode> else_stmt = parseElseStmt();
+
+  return newNode<IfASTnode>(std::move(expr), std::move(block), std::move(else_stmt), saveToken);
+};
+
+// else_stmt ::= "else" block | empty
+static std::unique_ptr<ASTnode> parseElseStmt()
+{
+  if (CS->CurTok.type == ELSE)
+  {
+    getNextToken(); // eat else
+    return parseBlock();
+  }
+  else
+  {
+    return nullptr;
+  }
+};
+
+// return_stmt ::= "return" ";" | "return" expr ";"
+static std::unique_ptr<ASTnode> parseReturnStmt()
+{
+  TOKEN saveToken = CS->CurTok;
+  getNextToken(); // eat return
+
+  if (CS->CurTok.type == SC)
+  {
+    getNextToken(); // eat ;
+    return newNode<ReturnASTnode>(nullptr, saveToken);
+  }
+  else
+  {
+    std::unique_ptr<ASTnode> expr = parseExpr();
+
+    if (CS->CurTok.type != SC)
+      error(CS->CurTok, "Expected ; in return statement");
+    getNextToken(); // eat ;
+    return newNode<ReturnASTnode>(std::move(expr), saveToken);
+  }
+};
+
+// expr ::= IDENT "=" expr | op1
+static std::unique_ptr<ASTnode> parseExpr()
+{
+  if (CS->CurTok.type == IDENT)
+  {
+    std::string identName = CS->CurTok.lexeme;
+    TOKEN saveToken = CS->CurTok;
+    getNextToken(); // eat IDENT
+
+    if (CS->CurTok.type == ASSIGN)
+    {
+      getNextToken(); // eat =
+      return newNode<AssignASTnode>(identName, parseExpr(), saveToken);
+    }
+    else
+    {
+      putBackToken(CS->CurTok);
+      CS->CurTok = saveToken;
+      return parseOp1(); // parse operation with IDENT as first operand
+    }
+  }
+  else
+  {
+    return parseOp1();
+  }
+};
+
+// op1 ::= op2 op1'
+static std::unique_ptr<ASTnode> parseOp1()
+{
+  std::unique_ptr<ASTnode> op2 = parseOp2();
+  return parseOp1Prime(std::move(op2));
+};
+
+// op1' ::= "||" op2 op1' | empty
+static std::unique_ptr<ASTnode> parseOp1Prime(std::unique_ptr<ASTnode> op2)
+{
+  if (CS->CurTok.type == OR)
+  {
+    TOKEN saveToken = CS->CurTok;
+    getNextToken(); // eat ||
+    std::unique_ptr<ASTnode> op2_prime = parseOp2();
+    return parseOp1Prime(newNode<BinOpNode>("||", std::move(op2), std::move(op2_prime), saveToken));
+  }
+  else
+  {
+    return op2;
+  }
+};
+
+// op2 ::= op3 op2'
+static std::unique_ptr<ASTnode> parseOp2()
+{
+  std::unique_ptr<ASTnode> op3 = parseOp3();
+  return parseOp2Prime(std::move(op3));
+};
+
+// op2' ::= "&&" op3 op2' | empty
+static std::unique_ptr<ASTnode> parseOp2Prime(std::unique_ptr<ASTnode> op3)
+{
+  if (CS->CurTok.type == AND)
+  {
+    TOKEN saveToken = CS->CurTok;
+    getNextToken(); // eat &&
+    std::unique_ptr<ASTnode> op3_prime = parseOp3();
+    return parseOp2Prime(newNode<BinOpNode>("&&", std::move(op3), std::move(op3_prime), saveToken));
+  }
+  else
+  {
+    return op3;
+  }
+};
+
+// op3 ::= op4 op3'
+static std::unique_ptr<ASTnode> parseOp3()
+{
+  std::unique_ptr<ASTnode> op4 = parseOp4();
+  return parseOp3Prime(std::move(op4));
+};
+
+// op3' ::= "==" op4 op3' | "!=" op4 op3' | empty
+static std::unique_ptr<ASTnode> parseOp3Prime(std::unique_ptr<ASTnode> op4)
+{
+  TOKEN saveToken = CS->CurTok;
+  if (CS->CurTok.type == EQ)
+  {
+    getNextToken(); // eat ==
+    std::unique_ptr<ASTnode> op4_prime = parseOp4();
+    return parseOp3Prime(newNode<BinOpNode>("==", std::move(op4), std::move(op4_prime), saveToken));
+  }
+  else if (CS->CurTok.type == NE)
+  {
+    getNextToken(); // eat !=
+    std::unique_ptr<ASTnode> op4_prime = parseOp4();
+    return parseOp3Prime(newNode<BinOpNode>("!=", std::move(op4), std::move(op4_prime), saveToken));
+  }
+  else
+  {
+    return op4;
+  }
+};
+
+// op4 ::= op5 op4'
+static std::unique_ptr<ASTnode> parseOp4()
+{
+  std::unique_ptr<ASTnode> op5 = parseOp5();
+  return parseOp4Prime(std::move(op5));
+};
+
+// op4' ::= "<=" op5 op4' | "<" op5 op4' | ">=" op5 op4' | ">" op5 op4' | empty
+static std::unique_ptr<ASTnode> parseOp4Prime(std::unique_ptr<ASTnode> op5)
+{
+  TOKEN saveToken = CS->CurTok;
+  if (CS->CurTok.type == LE)
+  {
+    getNextToken(); // eat <=
+    std::unique_ptr<ASTnode> op5_prime = parseOp5();
+    return parseOp4Prime(newNode<BinOpNode>("<=", std::move(op5), std::move(op5_prime), saveToken));
+  }
+  else if (CS->CurTok.type == LT)
+  {
+    getNextToken(); // eat <
+    std::unique_ptr<ASTnode> op5_prime = parseOp5();
+    return parseOp4Prime(newNode<BinOpNode>("<", std::move(op5), std::move(op5_prime), saveToken));
+  }
+  else if (CS->CurTok.type == GE)
+  {
+    getNextToken(); // eat >=
+    std::unique_ptr<ASTnode> op5_prime = parseOp5();
+    return parseOp4Prime(newNode<BinOpNode>(">=", std::move(op5), std::move(op5_prime), saveToken));
+  }
+  else if (CS->CurTok.type == GT)
+  {
+    getNextToken(); // eat >
+    std::unique_ptr<ASTnode> op5_prime = parseOp5();
+    return parseOp4Prime(newNode<BinOpNode>(">", std::move(op5), std::move(op5_prime), saveToken));
+  }
+  else
+  {
+    return op5;
+  }
+};
+
+// op5 ::= op6 op5'
+static std::unique_ptr<ASTnode> parseOp5()
+{
+  std::unique_ptr<ASTnode> op6 = parseOp6();
+  return parseOp5Prime(std::move(op6));
+};
+
+// op5' ::= "+" op6 op5' | "-" op6 op5' | empty
+static std::unique_ptr<ASTnode> parseOp5Prime(std::unique_ptr<ASTnode> op6)
+{
+  TOKEN saveToken = CS->CurTok;
+  if (CS->CurTok.type == PLUS)
+  {
+    getNextToken(); // eat +
+    std::unique_ptr<ASTnode> op6_prime = parseOp6();
+    return parseOp5Prime(newNode<BinOpNode>("+", std::move(op6), std::move(op6_prime), saveToken));
+  }
+  else if (CS->CurTok.type == MINUS)
+  {
+    getNextToken(); // eat -
+    std::unique_ptr<ASTnode> op6_prime = parseOp6();
+    return parseOp5Prime(newNode<BinOpNode>("-", std::move(op6), std::move(op6_prime), saveToken));
+  }
+  else
+  {
+    return op6;
+  }
+};
+
+// op6 ::= op7 op6'
+static std::unique_ptr<ASTnode> parseOp6()
+{
+  std::unique_ptr<ASTnode> op7 = parseOp7();
+  return parseOp6Prime(std::move(op7));
+};
+
+// op6' ::= "*" op7 op6' | "/" op7 op6' | "%" op7 op6' | empty
+static std::unique_ptr<ASTnode> parseOp6Prime(std::unique_ptr<ASTnode> op7)
+{
+  TOKEN saveToken = CS->CurTok;
+  if (CS->CurTok.type == ASTERIX)
+  {
+    getNextToken(); // eat *
+    std::unique_ptr<ASTnode> op7_prime = parseOp7();
+    return parseOp6Prime(newNode<BinOpNode>("*", std::move(op7), std::move(op7_prime), saveToken));
+  }
+  else if (CS->CurTok.type == DIV)
+  {
+    getNextToken(); // eat /
+    std::unique_ptr<ASTnode> op7_prime = parseOp7();
+    return parseOp6Prime(newNode<BinOpNode>("/", std::move(op7), std::move(op7_prime), saveToken));
+  }
+  else if (CS->CurTok.type == MOD)
+  {
+    getNextToken(); // eat %
+    std::unique_ptr<ASTnode> op7_prime = parseOp7();
+    return parseOp6Prime(newNode<BinOpNode>("%", std::move(op7), std::move(op7_prime), saveToken));
+  }
+  else
+  {
+    return op7;
+  }
+};
+
+// op7 ::= "-" op7 | "!" op7 | op8
+static std::unique_ptr<ASTnode> parseOp7()
+{
+  TOKEN saveToken = CS->CurTok;
+  if (CS->CurTok.type == MINUS)
+  {
+    getNextToken(); // eat -
+    std::unique_ptr<ASTnode> op7 = parseOp7();
+    return newNode<UnaryOpNode>("-", std::move(op7), saveToken);
+  }
+  else if (CS->CurTok.type == NOT)
+  {
+    getNextToken(); // eat !
+    std::unique_ptr<ASTnode> op7 = parseOp7();
+    return newNode<UnaryOpNode>("!", std::move(op7), saveToken);
+  }
+  else
+  {
+    return parseOp8();
+  }
+};
+
+// op8 ::= "(" expr ")" | op9
+static std::unique_ptr<ASTnode> parseOp8()
+{
+  if (CS->CurTok.type == LPAR)
+  {
+    getNextToken(); // eat (
+    std::unique_ptr<ASTnode> expr = parseExpr();
+    if (CS->CurTok.type != RPAR)
+      error(CS->CurTok, "Expected ) in expression");
+    getNextToken(); // eat )
+    return expr;
+  }
+  else
+  {
+    return parseOp9();
+  }
+};
+
+// op9 ::= IDENT | IDENT "(" args ")" | op10
+static std::unique_ptr<ASTnode> parseOp9()
+{
+  TOKEN saveToken = CS->CurTok;
+  if (CS->CurTok.type == IDENT)
+  {
+    std::string identName = CS->CurTok.lexeme;
+    getNextToken(); // eat IDENT
+    if (CS->CurTok.type == LPAR)
+    {
+      getNextToken(); // eat (
+      std::vector<std::unique_ptr<ASTnode>> args = parseArgs();
+      if (CS->CurTok.type != RPAR)
+        error(CS->CurTok, "Expected ) in function call");
+      getNextToken(); // eat )
+      return newNode<CallASTnode>(identName, std::move(args), saveToken);
+    }
+    else
+    {
+      return newNode<IdentASTnode>(identName, saveToken);
+    }
+  }
+  else
+  {
+    return parseOp10();
+  }
+};
+
+// op10 ::= INT_LIT | FLOAT_LIT | BOOL_LIT
+static std::unique_ptr<ASTnode> parseOp10()
+{
+  TOKEN saveToken = CS->CurTok;
+  if (CS->CurTok.type == INT_LIT)
+  {
+    int intVal = std::stoi(CS->CurTok.lexeme);
+    getNextToken(); // eat INT_LIT
+    return newNode<IntASTnode>(intVal, saveToken);
+  }
+  else if (CS->CurTok.type == FLOAT_LIT)
+  {
+    float floatVal = std::stof(CS->CurTok.lexeme);
+    getNextToken(); // eat FLOAT_LIT
+    return newNode<FloatASTnode>(floatVal, saveToken);
+  }
+  else if (CS->CurTok.type == BOOL_LIT)
+  {
+    bool boolVal = (CS->CurTok.lexeme == "true");
+    getNextToken(); // eat BOOL_LIT
+    return newNode<BoolASTnode>(boolVal, saveToken);
+  }
+  else
+  {
+    error(CS->CurTok, "Expected an expression here");
+    return nullptr;
+  }
+};
+
+// args ::= arg_list | empty
+static std::vector<std::unique_ptr<ASTnode>> parseArgs()
+{
+  std::vector<std::unique_ptr<ASTnode>> args;
+  if (CS->CurTok.type == RPAR)
+  {
+    return args;
+  }
+  else
+  {
+    args = parseArgList();
+    return std::move(args);
+  }
+};
+
+// arg_list ::= expr "," arg_list | expr
+static std::vector<std::unique_ptr<ASTnode>> parseArgList()
+{
+  std::vector<std::unique_ptr<ASTnode>> args;
+  args.push_back(parseExpr());
+  while (CS->CurTok.type == COMMA)
+  {
+    getNextToken(); // eat ,
+    args.push_back(parseExpr());
+  }
+  return std::move(args);
+};
+
+#endif
@@ -0,0 +1,104 @@
+#include <unistd.h>
+
+#include <atomic>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+//===----------------------------------------------------------------------===//
+// Runtime for -fprofile-generate
+//===----------------------------------------------------------------------===//
+//
+// Linked into instrumented programs from libmccomp-prof.a. The constructor of
+// every instrumented module registers its functions' counters here (see
+// pgo.hpp), and at exit they are written to $MCCOMP_PROFILE_FILE, or
+// mccomp.proftext, with "%p" replaced by the process id, in LLVM's text
+// profile format:
+//
+//   <function>
+//   # Func Hash:
+//   <hash>
+//   # Num Counters:
+//   <n>
+//   # Counter Values:
+//   <count>
+//   ...
+//
+// which mccomp -fprofile-use reads, and llvm-profdata merge turns into an
+// indexed profile, adding up several runs. The counters themselves are
+// updated inline without synchronisation, as clang's are by default, so
+// threads racing on the same counter may lose counts.
+
+// the record pgo.hpp emits for every function
+struct CounterRecord
+{
+  const char *Name;
+  uint64_t Hash;
+  uint64_t NumCounters;
+  uint64_t *Counters;
+  CounterRecord *Next;
+};
+
+static std::atomic<CounterRecord *> Records{nullptr};
+static std::once_flag Started;
+
+extern "C" int __mccomp_pgo_write(const char *Path);
+
+static std::string profilePath()
+{
+  const char *Env = getenv("MCCOMP_PROFILE_FILE");
+  std::string Path = Env && *Env ? Env : "mccomp.proftext";
+  for (size_t p; (p = Path.find("%p")) != std::string::npos;)
+    Path.replace(p, 2, std::to_string(getpid()));
+  return Path;
+}
+
+static void writeAtExit()
+{
+  std::string Path = profilePath();
+  if (__mccomp_pgo_write(Path.c_str()) != 0)
+    fprintf(stderr, "mccomp: could not write profile %s\n", Path.c_str());
+}
+
+extern "C" void __mccomp_pgo_register(CounterRecord *R)
+{
+  std::call_once(Started, []
+                 { atexit(writeAtExit); });
+  R->Next = Records.load();
+  while (!Records.compare_exchange_weak(R->Next, R))
+    ;
+}
+
+// write the counts so far to Path, returns 0 on success. Called at exit, and
+// can be called by the program at any time
+extern "C" int __mccomp_pgo_write(const char *Path)
+{
+  // a function registered more than once (by separate JITs, say) is added up
+  std::map<std::pair<std::string, uint64_t>, std::vector<uint64_t>> Counts;
+  for (CounterRecord *R = Records.load(); R; R = R->Next)
+  {
+    std::vector<uint64_t> &C = Counts[{R->Name, R->Hash}];
+    C.resize(R->NumCounters);
+    for (uint64_t i = 0; i < R->NumCounters; i++)
+      C[i] += R->Counters[i];
+  }
+
+  FILE *f = fopen(Path, "w");
+  if (f == NULL)
+    return -1;
+  for (auto &KV : Counts)
+  {
+    fprintf(f, "%s\n# Func Hash:\n%" PRIu64 "\n# Num Counters:\n%zu\n# Counter Values:\n", KV.first.first.c_str(),
+            KV.first.second, KV.second.size());
+    for (uint64_t c : KV.second)
+      fprintf(f, "%" PRIu64 "\n", c);
+    fprintf(f, "\n");
+  }
+  return fclose(f) == 0 ? 0 : -1;
+}
@@ -0,0 +1,243 @@
+#ifndef PGO_HPP
+#define PGO_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/MDBuilder.h"
+#include "llvm/IR/Module.h"
+#include "llvm/ProfileData/InstrProfReader.h"
+#include "llvm/ProfileData/ProfileCommon.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Transforms/Utils/ModuleUtils.h"
+
+#include "token.hpp"
+
+//===----------------------------------------------------------------------===//
+// Profile-guided optimisation
+//===----------------------------------------------------------------------===//
+//
+// -fprofile-generate gives every function an array of counters: the first
+// counts its calls, and every conditional branch if, while, && and || generate
+// gets two more, how often it ran and how often it was taken.
+//
+//   @__mccomp_pgo.counters.f = private global [N x i64] zeroinitializer
+//
+// A constructor in each module registers its functions' counters with the
+// runtime (pgo-rt.cpp, in libmccomp-prof.a), which writes them out at exit in
+// LLVM's text profile format, to $MCCOMP_PROFILE_FILE or mccomp.proftext
+// ("%p" in the name becomes the process id). llvm-profdata merge adds up the
+// profiles of several runs into an indexed profile.
+//
+// -fprofile-use=<file> reads either format back. It sets every function's
+// entry count and every branch's weights, and gives each module the profile
+// summary. The optimiser then inlines hot calls, lays hot paths out first and
+// moves functions that never ran to .text.unlikely.
+//
+// Counters are numbered in the order the branches are generated, and the hash
+// of a function covers the kinds of its branches in that order. A profile
+// stays valid across edits that leave a function's control flow alone; a
+// function whose control flow changed is warned about and its counts ignored.
+
+struct ProfileData
+{
+  // -fprofile-use: the hash and counters of every function in the profile
+  std::map<std::string, std::pair<uint64_t, std::vector<uint64_t>>> Counts;
+  std::unique_ptr<ProfileSummary> Summary;
+  std::string FileHash; // of the profile's contents, for the --incremental cache key
+
+  // the function being generated
+  GlobalVariable *Counters = nullptr; // -fprofile-generate, a stand-in until the number of counters is known
+  std::string Kinds;                  // a letter for each conditional branch so far
+  std::vector<BranchInst *> Branches;
+};
+
+// set up for a compile, reading the profile of -fprofile-use
+static void startProfile()
+{
+  CS->Profile.reset();
+  if (!CS->Opts.ProfileGenerate && CS->Opts.ProfileUse.empty())
+    return;
+  CS->Profile = std::make_unique<ProfileData>();
+  if (CS->Opts.ProfileUse.empty())
+    return;
+
+  const std::string &Path = CS->Opts.ProfileUse;
+  ErrorOr<std::unique_ptr<MemoryBuffer>> Buffer = MemoryBuffer::getFile(Path);
+  if (!Buffer)
+    error("Could not read profile " + Path + ": " + Buffer.getError().message());
+  MD5 Hash;
+  Hash.update((*Buffer)->getBuffer());
+  MD5::MD5Result Result;
+  Hash.final(Result);
+  CS->Profile->FileHash = Result.digest().str().str();
+
+  // text, indexed (from llvm-profdata merge) or raw
+  Expected<std::unique_ptr<InstrProfReader>> Reader = InstrProfReader::create(std::move(*Buffer));
+  if (!Reader)
+    error("Could not read profile " + Path + ": " + toString(Reader.takeError()));
+  InstrProfSummaryBuilder Summary(ProfileSummaryBuilder::DefaultCutoffs);
+  for (auto &Record : **Reader)
+  {
+    CS->Profile->Counts[Record.Name.str()] = {Record.Hash, Record.Counts};
+    Summary.addRecord(Record);
+  }
+  if ((*Reader)->hasError())
+    error("Could not read profile " + Path + ": " + toString((*Reader)->getError()));
+  CS->Profile->Summary = Summary.getSummary();
+}
+
+static void startModuleProfile(Module &M)
+{
+  if (CS->Profile && CS->Profile->Summary)
+    M.setProfileSummary(CS->Profile->Summary->getMD(M.getContext()), ProfileSummary::PSK_Instr);
+}
+
+// add By to counter Index of the current function, where the builder is
+static void incrementCounter(unsigned Index, Value *By)
+{
+  IRBuilder<> &B = *CS->Builder;
+  Value *Counter = B.CreateConstInBoundsGEP1_64(B.getInt64Ty(), CS->Profile->Counters, Index);
+  B.CreateStore(B.CreateAdd(B.CreateLoad(B.getInt64Ty(), Counter), By), Counter);
+}
+
+// at the start of F's entry block
+static void beginFunctionProfile(Function *F)
+{
+  if (!CS->Profile)
+    return;
+  ProfileData &P = *CS->Profile;
+  P.Kinds.clear();
+  P.Branches.clear();
+  if (!CS->Opts.ProfileGenerate)
+    return;
+  Type *I64 = Type::getInt64Ty(*CS->TheContext);
+  P.Counters = new GlobalVariable(*CS->TheModule, I64, false, GlobalValue::PrivateLinkage, ConstantInt::get(I64, 0));
+  incrementCounter(0, ConstantInt::get(I64, 1));
+}
+
+// a branch on __likely(c) or __unlikely(c) is weighted as LowerExpectIntrinsic
+// would, so the hint holds at -O0 too. A profile's counts replace the weights
+static BranchInst *createExpectedCondBr(Value *Cond, BasicBlock *True, BasicBlock *False)
+{
+  BranchInst *Br = CS->Builder->CreateCondBr(Cond, True, False);
+  auto *Expect = dyn_cast<IntrinsicInst>(Cond);
+  if (Expect && Expect->getIntrinsicID() == Intrinsic::expect)
+  {
+    bool Likely = cast<ConstantInt>(Expect->getArgOperand(1))->isOne();
+    Br->setMetadata(LLVMContext::MD_prof, MDBuilder(*CS->TheContext).createBranchWeights(Likely ? 2000 : 1, Likely ? 1 : 2000));
+  }
+  return Br;
+}
+
+// a conditional branch of Kind: 'i'f, 'w'hile, '&'& or '|'|
+static BranchInst *createProfiledCondBr(Value *Cond, BasicBlock *True, BasicBlock *False, char Kind)
+{
+  IRBuilder<> &B = *CS->Builder;
+  if (!CS->Profile)
+    return createExpectedCondBr(Cond, True, False);
+  ProfileData &P = *CS->Profile;
+  if (P.Counters)
+  {
+    unsigned Index = 1 + 2 * P.Kinds.size();
+    incrementCounter(Index, B.getInt64(1));
+    incrementCounter(Index + 1, B.CreateZExt(Cond, B.getInt64Ty()));
+  }
+  P.Kinds += Kind;
+  P.Branches.push_back(createExpectedCondBr(Cond, True, False));
+  return P.Branches.back();
+}
+
+// give F its counters and register them from the module's constructor
+static void registerCounters(Function *F, uint64_t Hash, unsigned NumCounters)
+{
+  ProfileData &P = *CS->Profile;
+  LLVMContext &C = *CS->TheContext;
+  Module &M = *CS->TheModule;
+  Type *I64 = Type::getInt64Ty(C);
+  PointerType *Ptr = PointerType::getUnqual(Type::getInt8Ty(C));
+
+  ArrayType *ArrayTy = ArrayType::get(I64, NumCounters);
+  auto *Counters = new GlobalVariable(M, ArrayTy, false, GlobalValue::PrivateLinkage, ConstantAggregateZero::get(ArrayTy),
+                                      "__mccomp_pgo.counters." + F->getName());
+  P.Counters->replaceAllUsesWith(ConstantExpr::getBitCast(Counters, P.Counters->getType()));
+  P.Counters->eraseFromParent();
+  P.Counters = nullptr;
+
+  // { name, hash, number of counters, counters, next }, the runtime links the records up
+  StructType *RecordTy = StructType::get(C, {Ptr, I64, I64, Ptr, Ptr});
+  Constant *Name = ConstantDataArray::getString(C, F->getName());
+  auto *NameVar = new GlobalVariable(M, Name->getType(), true, GlobalValue::PrivateLinkage, Name,
+                                     "__mccomp_pgo.name." + F->getName());
+  Constant *Init = ConstantStruct::get(RecordTy, {ConstantExpr::getPointerCast(NameVar, Ptr), ConstantInt::get(I64, Hash),
+                                                  ConstantInt::get(I64, NumCounters), ConstantExpr::getPointerCast(Counters, Ptr),
+                                                  ConstantPointerNull::get(Ptr)});
+  auto *Record = new GlobalVariable(M, RecordTy, false, GlobalValue::PrivateLinkage, Init, "__mccomp_pgo." + F->getName());
+
+  Function *Ctor = M.getFunction("__mccomp_pgo_init");
+  if (!Ctor)
+  {
+    Ctor = Function::Create(FunctionType::get(Type::getVoidTy(C), false), GlobalValue::InternalLinkage, "__mccomp_pgo_init", M);
+    ReturnInst::Create(C, BasicBlock::Create(C, "entry", Ctor));
+    appendToGlobalCtors(M, Ctor, 0);
+  }
+  FunctionCallee Register = M.getOrInsertFunction(
+      "__mccomp_pgo_register", FunctionType::get(Type::getVoidTy(C), {PointerType::getUnqual(RecordTy)}, false));
+  IRBuilder<>(Ctor->getEntryBlock().getTerminator()).CreateCall(Register, {Record});
+}
+
+// set F's entry count and its branches' weights from the profile
+static void applyProfile(Function *F, uint64_t Hash, unsigned NumCounters, const TOKEN &Tok)
+{
+  ProfileData &P = *CS->Profile;
+  auto It = P.Counts.find(F->getName().str());
+  if (It == P.Counts.end())
+    return;
+  const std::vector<uint64_t> &Counts = It->second.second;
+  if (It->second.first != Hash || Counts.size() != NumCounters)
+  {
+    addWarning(Tok, "The profile of `" + F->getName().str() + "` is out of date, its branches changed since it was collected");
+    return;
+  }
+
+  F->setEntryCount(Counts[0]);
+  MDBuilder MDB(*CS->TheContext);
+  for (size_t i = 0; i < P.Branches.size(); i++)
+  {
+    uint64_t Executed = Counts[1 + 2 * i], Taken = std::min(Counts[2 + 2 * i], Executed), NotTaken = Executed - Taken;
+    if (Executed == 0)
+      continue;
+    // weights are 32 bit, and never 0 so no edge looks impossible
+    uint64_t Scale = std::max(Taken, NotTaken) / UINT32_MAX + 1;
+    P.Branches[i]->setMetadata(LLVMContext::MD_prof,
+                               MDB.createBranchWeights(uint32_t(Taken / Scale + 1), uint32_t(NotTaken / Scale + 1)));
+  }
+}
+
+// once F's body is generated
+static void endFunctionProfile(Function *F, const TOKEN &Tok)
+{
+  if (!CS->Profile)
+    return;
+  ProfileData &P = *CS->Profile;
+  MD5 Hash;
+  Hash.update(P.Kinds);
+  MD5::MD5Result Result;
+  Hash.final(Result);
+  unsigned NumCounters = 1 + 2 * P.Kinds.size();
+  if (P.Counters)
+    registerCounters(F, Result.low(), NumCounters);
+  if (!CS->Opts.ProfileUse.empty())
+    applyProfile(F, Result.low(), NumCounters, Tok);
+  P.Branches.clear();
+}
+
+#endif
@@ -0,0 +1,180 @@
+#ifndef PIPELINE_HPP
+#define PIPELINE_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "astnode.hpp"
+#include "parser.hpp"
+#include "timing.hpp"
+
+//===----------------------------------------------------------------------===//
+// Pipelined compilation
+//===----------------------------------------------------------------------===//
+//
+// With --pipeline the lexer, the parser and codegen run on three threads. The
+// lexer fills a TokenRing (token.hpp), the parser pushes every top-level
+// declaration onto a bounded DeclQueue as soon as it is complete, and codegen,
+// on the calling thread, generates each declaration as it arrives. What is
+// held between the stages is bounded by the two queues, and codegen starts
+// with the first declaration instead of after the whole program is parsed.
+//
+// Every stage records how long it waited on its neighbours. A stage's
+// utilisation is the share of the pipeline's wall time it spent working, so
+// the bottleneck is the stage close to 100%.
+//
+// The AST is never complete, so it is not printed. An error in codegen can be
+// reported before a syntax error further down the file.
+
+// bounded queue of parsed declarations, parser -> codegen
+class DeclQueue
+{
+  static const size_t Capacity = 64;
+  std::mutex Lock;
+  std::condition_variable NotEmpty, NotFull;
+  std::deque<std::unique_ptr<ASTnode>> Decls;
+  bool Closed = false, Cancelled = false;
+
+public:
+  double PushWait = 0, PopWait = 0; // seconds
+
+  // returns false once the consumer has given up
+  bool push(std::unique_ptr<ASTnode> D)
+  {
+    std::unique_lock<std::mutex> L(Lock);
+    if (Decls.size() == Capacity && !Cancelled)
+    {
+      auto start = std::chrono::steady_clock::now();
+      NotFull.wait(L, [this] { return Decls.size() < Capacity || Cancelled; });
+      PushWait += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    if (Cancelled)
+      return false;
+    Decls.push_back(std::move(D));
+    NotEmpty.notify_one();
+    return true;
+  }
+
+  // returns nullptr once the queue is closed and drained
+  std::unique_ptr<ASTnode> pop()
+  {
+    std::unique_lock<std::mutex> L(Lock);
+    if (Decls.empty() && !Closed)
+    {
+      auto start = std::chrono::steady_clock::now();
+      NotEmpty.wait(L, [this] { return !Decls.empty() || Closed; });
+      PopWait += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    if (Decls.empty())
+      return nullptr;
+    std::unique_ptr<ASTnode> D = std::move(Decls.front());
+    Decls.pop_front();
+    NotFull.notify_one();
+    return D;
+  }
+
+  // producer: no more declarations will be pushed
+  void close()
+  {
+    std::lock_guard<std::mutex> L(Lock);
+    Closed = true;
+    NotEmpty.notify_all();
+  }
+
+  // consumer: stop the producer
+  void cancel()
+  {
+    std::lock_guard<std::mutex> L(Lock);
+    Cancelled = true;
+    NotFull.notify_all();
+  }
+};
+
+static double secondsSince(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Generate is called for every top-level declaration, in source order
+static void generateCodePipelined(const std::function<void(std::unique_ptr<ASTnode>)> &Generate)
+{
+  TokenRing Tokens;
+  DeclQueue Decls;
+  CompilerState *State = CS;
+  bool Trace = timeTraceProfilerEnabled();
+  std::exception_ptr ParseError;
+  double LexTime = 0, ParseTime = 0;
+  auto Start = std::chrono::steady_clock::now();
+
+  std::thread Lexer([&]
+                    {
+                      CurrentState Current(State);
+                      ThreadTrace Traced(Trace);
+                      TimeTraceScope Scope("Lexing");
+                      TOKEN tok;
+                      do
+                        tok = gettok();
+                      while (Tokens.push(tok) && tok.type != EOF_TOK);
+                      Tokens.close();
+                      LexTime = secondsSince(Start);
+                    });
+
+  std::thread Parser([&]
+                     {
+                       CurrentState Current(State);
+                       ThreadTrace Traced(Trace);
+                       TimeTraceScope Scope("Parsing");
+                       CS->Tokens = &Tokens;
+                       try
+                       {
+                         getNextToken();
+                         parseProgramStreaming([&](std::unique_ptr<ASTnode> D)
+                                               { return Decls.push(std::move(D)); });
+                       }
+                       catch (...)
+                       {
+                         ParseError = std::current_exception();
+                         Tokens.cancel();
+                       }
+                       CS->Tokens = nullptr;
+                       Decls.close();
+                       ParseTime = secondsSince(Start);
+                     });
+
+  try
+  {
+    while (std::unique_ptr<ASTnode> D = Decls.pop())
+      Generate(std::move(D));
+  }
+  catch (...)
+  {
+    Decls.cancel();
+    Tokens.cancel();
+    Parser.join();
+    Lexer.join();
+    throw;
+  }
+  double GenTime = secondsSince(Start);
+  Parser.join();
+  Lexer.join();
+  if (ParseError)
+    std::rethrow_exception(ParseError);
+
+  if (CS->Opts.Verbose)
+  {
+    double Total = secondsSince(Start);
+    auto percent = [Total](double Busy)
+    { return Total > 0 ? 100 * Busy / Total : 0; };
+    fprintf(stdout, "Pipeline utilisation over %.2f ms: lexer %.1f%%, parser %.1f%%, codegen %.1f%%\n", Total * 1000,
+            percent(LexTime - Tokens.PushWait),
+            percent(ParseTime - Tokens.PopWait - Decls.PushWait),
+            percent(GenTime - Decls.PopWait));
+  }
+}
+
+#endif
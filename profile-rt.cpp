@@ -0,0 +1,250 @@
+#include <time.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "profile.hpp"
+
+//===----------------------------------------------------------------------===//
+// Runtime for -finstrument=profile
+//===----------------------------------------------------------------------===//
+//
+// Linked into instrumented programs from libmccomp-prof.a (or into the host
+// of a JIT, exporting its symbols). Instrumented functions call
+// __mccomp_prof_enter and __mccomp_prof_exit, see instrument.hpp. Each thread
+// keeps a shadow stack and its totals in a buffer of its own, which only it
+// writes. Its counters are atomics written with relaxed stores, so they cost
+// no more than plain ones, and the buffer's lock is only taken when the buffer
+// grows, for a function or call edge the thread has not seen before. The
+// first call of a function anywhere in the process registers it under a lock
+// too. As the program exits the buffers of all threads are added up and
+// written out (see profile.hpp); those of threads still running then are read
+// under their locks, so they are read as they are but never mid-resize.
+//
+// Time is read from the cycle counter (rdtsc, cntvct_el0 on arm64, otherwise
+// the monotonic clock) and converted to nanoseconds at the rate measured
+// against the monotonic clock over the whole run.
+
+// the record instrument.hpp emits for every function
+struct FunctionRecord
+{
+  const char *Name;
+  std::atomic<int32_t> Id; // -1 until the first call
+};
+
+static inline uint64_t readClock()
+{
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return uint64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+static inline uint64_t readTicks()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#elif defined(__aarch64__)
+  uint64_t Ticks;
+  asm volatile("mrs %0, cntvct_el0" : "=r"(Ticks));
+  return Ticks;
+#else
+  return readClock();
+#endif
+}
+
+struct Frame
+{
+  int32_t Function;
+  uint64_t Start, Children; // ticks
+};
+
+// a total only its thread adds to, and __mccomp_prof_write reads at any time
+struct Counter
+{
+  std::atomic<uint64_t> Value{0};
+
+  Counter() = default;
+  Counter(const Counter &C) : Value(C.get()) {}
+
+  uint64_t get() const { return Value.load(std::memory_order_relaxed); }
+  void add(uint64_t N) { Value.store(get() + N, std::memory_order_relaxed); }
+};
+
+struct Totals
+{
+  Counter Calls, Inclusive, Exclusive; // ticks
+  uint32_t Active = 0;                 // calls on the stack, only its thread reads
+};
+
+struct EdgeTotals
+{
+  Counter Calls, Inclusive;
+};
+
+struct ThreadBuffer
+{
+  std::vector<Frame> Stack;
+  std::mutex Lock;                                // held while Functions or Edges grow, and while they are written out
+  std::vector<Totals> Functions;                  // by id
+  std::unordered_map<uint64_t, EdgeTotals> Edges; // by (caller id + 1) << 32 | callee id, 0 is <external>
+  ThreadBuffer *Next = nullptr;
+};
+
+// every thread's buffer, never freed so they can be written out at exit
+static std::atomic<ThreadBuffer *> Threads{nullptr};
+static thread_local ThreadBuffer *Buffer = nullptr;
+
+static std::mutex Registry; // guards Names and the start of the run
+static std::vector<const char *> Names;
+static uint64_t StartTicks, StartClock;
+
+extern "C" int __mccomp_prof_write(const char *Path);
+
+static void writeAtExit()
+{
+  std::string Path = defaultProfilePath();
+  if (__mccomp_prof_write(Path.c_str()) != 0)
+    fprintf(stderr, "mccomp-prof: could not write %s\n", Path.c_str());
+}
+
+static int32_t registerFunction(FunctionRecord *R)
+{
+  std::lock_guard<std::mutex> Guard(Registry);
+  int32_t Id = R->Id.load(std::memory_order_relaxed);
+  if (Id < 0)
+  {
+    if (Names.empty())
+    {
+      StartClock = readClock();
+      StartTicks = readTicks();
+      atexit(writeAtExit);
+    }
+    Id = Names.size();
+    Names.push_back(R->Name);
+    R->Id.store(Id, std::memory_order_release);
+  }
+  return Id;
+}
+
+static ThreadBuffer &getBuffer()
+{
+  if (Buffer == nullptr)
+  {
+    Buffer = new ThreadBuffer;
+    Buffer->Next = Threads.load();
+    while (!Threads.compare_exchange_weak(Buffer->Next, Buffer))
+      ;
+  }
+  return *Buffer;
+}
+
+extern "C" void __mccomp_prof_enter(FunctionRecord *R)
+{
+  int32_t Id = R->Id.load(std::memory_order_acquire);
+  if (Id < 0)
+    Id = registerFunction(R);
+  ThreadBuffer &B = getBuffer();
+  if (size_t(Id) >= B.Functions.size())
+  {
+    std::lock_guard<std::mutex> Guard(B.Lock);
+    B.Functions.resize(Id + 1);
+  }
+  B.Functions[Id].Active++;
+  B.Stack.push_back({Id, readTicks(), 0});
+}
+
+extern "C" void __mccomp_prof_exit(FunctionRecord *R)
+{
+  uint64_t Now = readTicks();
+  ThreadBuffer &B = getBuffer();
+  if (B.Stack.empty())
+    return;
+  Frame F = B.Stack.back();
+  B.Stack.pop_back();
+  uint64_t Elapsed = Now - F.Start;
+
+  Totals &T = B.Functions[F.Function];
+  T.Calls.add(1);
+  T.Exclusive.add(Elapsed > F.Children ? Elapsed - F.Children : 0);
+  uint64_t Caller = B.Stack.empty() ? 0 : uint64_t(B.Stack.back().Function) + 1;
+  uint64_t Key = Caller << 32 | uint32_t(F.Function);
+  auto It = B.Edges.find(Key);
+  if (It == B.Edges.end())
+  {
+    std::lock_guard<std::mutex> Guard(B.Lock);
+    It = B.Edges.emplace(Key, EdgeTotals()).first;
+  }
+  EdgeTotals &E = It->second;
+  E.Calls.add(1);
+  // a recursive call's time is already in the outermost call's
+  if (--T.Active == 0)
+  {
+    T.Inclusive.add(Elapsed);
+    E.Inclusive.add(Elapsed);
+  }
+  if (!B.Stack.empty())
+    B.Stack.back().Children += Elapsed;
+}
+
+// write the profile so far to Path, returns 0 on success. Called at exit, and
+// can be called by the program at any time
+extern "C" int __mccomp_prof_write(const char *Path)
+{
+  // the same function may have been registered more than once, by separate
+  // modules or JITs, so it is added up by name
+  Profile P;
+  std::map<std::pair<std::string, std::string>, EdgeProfile> Edges;
+  {
+    std::lock_guard<std::mutex> Guard(Registry);
+    uint64_t EndClock = readClock(), EndTicks = readTicks();
+    double NSPerTick = EndTicks > StartTicks ? double(EndClock - StartClock) / (EndTicks - StartTicks) : 1;
+    P.Time = Names.empty() ? 0 : double(EndClock - StartClock);
+    for (ThreadBuffer *B = Threads.load(); B; B = B->Next)
+    {
+      P.Threads++;
+      // the thread may still be running, and growing its buffer
+      std::lock_guard<std::mutex> BufferGuard(B->Lock);
+      for (size_t i = 0; i < B->Functions.size(); i++)
+      {
+        const Totals &T = B->Functions[i];
+        if (T.Calls.get() == 0)
+          continue;
+        FunctionProfile &F = P.Functions[Names[i]];
+        F.Calls += T.Calls.get();
+        F.Inclusive += T.Inclusive.get() * NSPerTick;
+        F.Exclusive += T.Exclusive.get() * NSPerTick;
+      }
+      for (auto &KV : B->Edges)
+      {
+        uint64_t Caller = KV.first >> 32, Callee = uint32_t(KV.first);
+        EdgeProfile &E = Edges[{Caller ? Names[Caller - 1] : ProfileExternal, Names[Callee]}];
+        E.Calls += KV.second.Calls.get();
+        E.Inclusive += KV.second.Inclusive.get() * NSPerTick;
+      }
+    }
+  }
+
+  FILE *f = fopen(Path, "w");
+  if (f == NULL)
+    return -1;
+  fprintf(f, "%s\ntime %.0f\nthreads %u\n", ProfileMagic, P.Time, P.Threads);
+  for (auto &KV : P.Functions)
+    fprintf(f, "function %s %llu %.0f %.0f\n", KV.first.c_str(), KV.second.Calls, KV.second.Inclusive,
+            KV.second.Exclusive);
+  for (auto &KV : Edges)
+    fprintf(f, "edge %s %s %llu %.0f\n", KV.first.first.c_str(), KV.first.second.c_str(), KV.second.Calls,
+            KV.second.Inclusive);
+  return fclose(f) == 0 ? 0 : -1;
+}
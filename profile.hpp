@@ -0,0 +1,100 @@
+#ifndef PROFILE_HPP
+#define PROFILE_HPP
+
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+//===----------------------------------------------------------------------===//
+// Function profiles
+//===----------------------------------------------------------------------===//
+//
+// Written by the -finstrument=profile runtime (profile-rt.cpp) as an
+// instrumented program exits, to $MCCOMP_PROF_FILE or mccomp-prof.out, and
+// read by mccomp-prof. A text file, all times in nanoseconds:
+//
+//   mccomp-profile 1
+//   time <ns>                       from the first instrumented call to exit
+//   threads <n>                     that called instrumented functions
+//   function <name> <calls> <inclusive> <exclusive>
+//   edge <caller> <callee> <calls> <inclusive>
+//
+// Functions called from code that is not instrumented are called by
+// <external>. The inclusive time of a recursive function counts only its
+// outermost calls, so the edges from a function to itself have calls but no
+// time.
+
+static const char *const ProfileMagic = "mccomp-profile 1";
+static const char *const ProfileExternal = "<external>";
+
+static std::string defaultProfilePath()
+{
+  const char *Path = getenv("MCCOMP_PROF_FILE");
+  return Path && *Path ? Path : "mccomp-prof.out";
+}
+
+struct FunctionProfile
+{
+  unsigned long long Calls = 0;
+  double Inclusive = 0, Exclusive = 0; // ns
+};
+
+struct EdgeProfile
+{
+  std::string Caller, Callee;
+  unsigned long long Calls = 0;
+  double Inclusive = 0; // ns, of the callee when called from the caller
+};
+
+struct Profile
+{
+  double Time = 0; // ns
+  unsigned Threads = 0;
+  std::map<std::string, FunctionProfile> Functions;
+  std::vector<EdgeProfile> Edges;
+};
+
+// returns an error message, empty on success
+static std::string readProfile(const std::string &Path, Profile &P)
+{
+  std::ifstream in(Path);
+  if (!in)
+    return "could not open " + Path;
+  std::string Line;
+  if (!std::getline(in, Line) || Line != ProfileMagic)
+    return Path + " is not a mccomp profile";
+  for (unsigned n = 2; std::getline(in, Line); n++)
+  {
+    std::istringstream ss(Line);
+    std::string Kind;
+    ss >> Kind;
+    bool ok;
+    if (Kind == "time")
+      ok = bool(ss >> P.Time);
+    else if (Kind == "threads")
+      ok = bool(ss >> P.Threads);
+    else if (Kind == "function")
+    {
+      std::string Name;
+      FunctionProfile F;
+      ok = bool(ss >> Name >> F.Calls >> F.Inclusive >> F.Exclusive);
+      P.Functions[Name] = F;
+    }
+    else if (Kind == "edge")
+    {
+      EdgeProfile E;
+      ok = bool(ss >> E.Caller >> E.Callee >> E.Calls >> E.Inclusive);
+      P.Edges.push_back(E);
+    }
+    else
+      ok = Kind.empty();
+    if (!ok)
+      return Path + ":" + std::to_string(n) + ": malformed line: " + Line;
+  }
+  return "";
+}
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef PROTOCOL_HPP
+#define PROTOCOL_HPP
+
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <vector>
+
+//===----------------------------------------------------------------------===//
+// Compile server protocol
+//===----------------------------------------------------------------------===//
+//
+// Shared by the compile server (mccomp --serve) and mccomp-client, kept free
+// of LLVM so the client starts instantly. One request per connection:
+//
+//   request:  cwd, argc, argv[1..], source    (all as frames)
+//   response: exit code, stdout, stderr, output
+//
+// The output is the module the client writes to its output file, empty when
+// there is none because the compile wrote its own files (--stream).
+//
+// A frame is a 32 bit length followed by that many bytes, numbers are sent as
+// their decimal string. A request the server can't read, such as one with an
+// argc that isn't a number from 0 to MaxRequestArgs or longer than
+// MaxRequestSize, gets exit code 1 and an error on stderr back.
+
+// more arguments than any compile needs, the client compiles locally instead
+static const int MaxRequestArgs = 4096;
+
+// the most all frames of a request may hold, the client compiles a larger
+// source locally
+static const size_t MaxRequestSize = 64 << 20;
+
+// default socket, overridden by the MCCOMP_SERVER environment variable
+static std::string defaultSocketPath()
+{
+  if (const char *path = getenv("MCCOMP_SERVER"))
+    return path;
+  return "/tmp/mccomp-" + std::to_string(getuid()) + ".sock";
+}
+
+static bool writeAll(int fd, const char *data, size_t len)
+{
+  while (len > 0)
+  {
+    ssize_t n = write(fd, data, len);
+    if (n <= 0)
+      return false;
+    data += n;
+    len -= n;
+  }
+  return true;
+}
+
+static bool readAll(int fd, char *data, size_t len)
+{
+  while (len > 0)
+  {
+    ssize_t n = read(fd, data, len);
+    if (n <= 0)
+      return false;
+    data += n;
+    len -= n;
+  }
+  return true;
+}
+
+static bool sendFrame(int fd, const std::string &data)
+{
+  uint32_t len = data.size();
+  return writeAll(fd, (const char *)&len, sizeof(len)) && writeAll(fd, data.data(), len);
+}
+
+static bool recvFrameLength(int fd, uint32_t &len)
+{
+  return readAll(fd, (char *)&len, sizeof(len));
+}
+
+static bool recvFrame(int fd, std::string &data)
+{
+  uint32_t len;
+  if (!recvFrameLength(fd, len))
+    return false;
+  data.resize(len);
+  return readAll(fd, &data[0], len);
+}
+
+static sockaddr_un socketAddress(const std::string &path)
+{
+  sockaddr_un addr = {};
+  addr.sun_family = AF_UNIX;
+  path.copy(addr.sun_path, sizeof(addr.sun_path) - 1);
+  return addr;
+}
+
+#endif
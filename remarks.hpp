@@ -0,0 +1,186 @@
+#ifndef REMARKS_HPP
+#define REMARKS_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "llvm/IR/DebugInfoMetadata.h"
+#include "llvm/IR/DiagnosticInfo.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/LLVMRemarkStreamer.h"
+#include "llvm/Remarks/RemarkFormat.h"
+#include "llvm/Remarks/RemarkSerializer.h"
+#include "llvm/Remarks/RemarkStreamer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Regex.h"
+#include "llvm/Support/ToolOutputFile.h"
+
+#include "token.hpp"
+
+//===----------------------------------------------------------------------===//
+// Optimisation remarks
+//===----------------------------------------------------------------------===//
+//
+// The passes of the optimisation pipeline and the code generator report what
+// they did (-Rpass), what they could not do (-Rpass-missed) and why
+// (-Rpass-analysis), each filtered by a regular expression on the pass name.
+// The remarks are reported with the warnings, as clang prints them:
+//
+//   sum.c:4:13: remark: loop not vectorized [-Rpass-missed=loop-vectorize]
+//
+// -fsave-optimization-record writes every remark to <output>.opt.yaml (or
+// .opt.bitstream), for opt-viewer and llvm-remarkutil. A compile can
+// generate code in more than one context (a chunk at a time with --stream),
+// each is attached to the remark filters and the record when it is created.
+//
+// Remarks point at the instruction they are about, so they need the source
+// location of every instruction. Without -g the compile unit is created to
+// track locations only and no debug info is emitted (see debuginfo.hpp). With
+// -fprofile-use each remark also carries the hotness of its code.
+
+static bool remarksRequested()
+{
+  const CompilerOptions &O = CS->Opts;
+  return !O.RemarksPassed.empty() || !O.RemarksMissed.empty() || !O.RemarksAnalysis.empty() || O.SaveOptimizationRecord;
+}
+
+struct RemarkState
+{
+  std::unique_ptr<ToolOutputFile> Record;             // -fsave-optimization-record
+  std::unique_ptr<remarks::RemarkStreamer> Streamer; // writes Record, for every context of the compile
+};
+
+struct RemarkHandler : DiagnosticHandler
+{
+  std::unique_ptr<Regex> Passed, Missed, Analysis;
+
+  bool isPassedOptRemarkEnabled(StringRef PassName) const override { return Passed && Passed->match(PassName); }
+  bool isMissedOptRemarkEnabled(StringRef PassName) const override { return Missed && Missed->match(PassName); }
+  bool isAnalysisRemarkEnabled(StringRef PassName) const override { return Analysis && Analysis->match(PassName); }
+  bool isAnyRemarkEnabled() const override { return Passed || Missed || Analysis; }
+
+  bool handleDiagnostics(const DiagnosticInfo &DI) override
+  {
+    auto *Remark = dyn_cast<DiagnosticInfoOptimizationBase>(&DI);
+    if (!Remark)
+      return false; // everything else is reported as LLVM always has
+    if (!Remark->isEnabled())
+      return true;
+
+    // a remark about no instruction in particular points at its function
+    std::string Where = Remark->getLocationStr();
+    auto *Located = dyn_cast<DiagnosticInfoWithLocationBase>(Remark);
+    if (Located && !Located->isLocationAvailable())
+      if (DISubprogram *SP = Located->getFunction().getSubprogram())
+        Where = SP->getFilename().str() + ":" + std::to_string(SP->getLine()) + ":0";
+
+    std::string Text = Where + ": remark: " + Remark->getMsg();
+    if (auto Hotness = Remark->getHotness())
+      Text += " (hotness: " + std::to_string(*Hotness) + ")";
+    std::string Flag = Remark->isPassed() ? "-Rpass" : Remark->isMissed() ? "-Rpass-missed" : "-Rpass-analysis";
+    addWarningText(Text + " [" + Flag + "=" + Remark->getPassName().str() + "]");
+    return true;
+  }
+};
+
+static std::unique_ptr<Regex> remarkFilter(const std::string &Flag, const std::string &Pattern)
+{
+  if (Pattern.empty())
+    return nullptr;
+  auto Filter = std::make_unique<Regex>(Pattern);
+  std::string Problem;
+  if (!Filter->isValid(Problem))
+    error("Invalid regular expression for " + Flag + ": " + Problem);
+  return Filter;
+}
+
+// -fsave-optimization-record writes next to the output by default
+static std::string optimizationRecordPath()
+{
+  if (!CS->Opts.OptimizationRecordFile.empty())
+    return CS->Opts.OptimizationRecordFile;
+  SmallString<128> Path(CS->Opts.OutputFile.empty() ? "output" : CS->Opts.OutputFile);
+  sys::path::replace_extension(Path, "opt." + CS->Opts.OptimizationRecordFormat);
+  return Path.str().str();
+}
+
+// report the remarks generated in context C, which the compile has just
+// created (--stream creates one per chunk)
+static void attachRemarks(LLVMContext &C)
+{
+  if (!CS->Remarks)
+    return;
+  const CompilerOptions &O = CS->Opts;
+  if (!O.ProfileUse.empty())
+    C.setDiagnosticsHotnessRequested(true);
+
+  if (!O.RemarksPassed.empty() || !O.RemarksMissed.empty() || !O.RemarksAnalysis.empty())
+  {
+    auto Handler = std::make_unique<RemarkHandler>();
+    Handler->Passed = remarkFilter("-Rpass", O.RemarksPassed);
+    Handler->Missed = remarkFilter("-Rpass-missed", O.RemarksMissed);
+    Handler->Analysis = remarkFilter("-Rpass-analysis", O.RemarksAnalysis);
+    C.setDiagnosticHandler(std::move(Handler));
+  }
+  if (CS->Remarks->Streamer)
+    C.setLLVMRemarkStreamer(std::make_unique<LLVMRemarkStreamer>(*CS->Remarks->Streamer));
+}
+
+// stop reporting the remarks of context C, which outlives the compile or is
+// handed over with its module
+static void detachRemarks(LLVMContext &C)
+{
+  if (!CS->Remarks)
+    return;
+  C.setLLVMRemarkStreamer(nullptr);
+  C.setDiagnosticHandler(std::make_unique<DiagnosticHandler>());
+}
+
+// report the remarks of this compile, once its first context exists
+static void startRemarks()
+{
+  CS->Remarks.reset();
+  if (!remarksRequested())
+    return;
+  const CompilerOptions &O = CS->Opts;
+  CS->Remarks = std::make_unique<RemarkState>();
+
+  // one record for the whole compile, which every context streams into. No
+  // context owns it, so the code generator never references it from a
+  // section of the object file, as only Mach-O linkers would use
+  if (O.SaveOptimizationRecord)
+  {
+    std::string Path = optimizationRecordPath();
+    Expected<remarks::Format> Format = remarks::parseFormat(O.OptimizationRecordFormat);
+    if (!Format)
+      error("Could not write optimization record " + Path + ": " + toString(Format.takeError()));
+    std::error_code EC;
+    CS->Remarks->Record = std::make_unique<ToolOutputFile>(
+        Path, EC, *Format == remarks::Format::YAML ? sys::fs::OF_TextWithCRLF : sys::fs::OF_None);
+    if (EC)
+      error("Could not write optimization record " + Path + ": " + EC.message());
+    Expected<std::unique_ptr<remarks::RemarkSerializer>> Serializer =
+        remarks::createRemarkSerializer(*Format, remarks::SerializerMode::Separate, CS->Remarks->Record->os());
+    if (!Serializer)
+      error("Could not write optimization record " + Path + ": " + toString(Serializer.takeError()));
+    CS->Remarks->Streamer = std::make_unique<remarks::RemarkStreamer>(std::move(*Serializer), StringRef(Path));
+  }
+  attachRemarks(*CS->TheContext);
+}
+
+// keep the record of a successful compile, and detach the handler and the
+// record from the compile's last context, if it hasn't been handed over
+static void finishRemarks(bool Success)
+{
+  if (!CS->Remarks)
+    return;
+  if (CS->TheContext)
+    detachRemarks(*CS->TheContext);
+  CS->Remarks->Streamer.reset();
+  if (CS->Remarks->Record && Success)
+    CS->Remarks->Record->keep();
+  CS->Remarks.reset();
+}
+
+#endif
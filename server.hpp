@@ -0,0 +1,216 @@
+#ifndef SERVER_HPP
+#define SERVER_HPP
+
+#include <cerrno>
+#include <csignal>
+#include <set>
+#include <sys/wait.h>
+#include <thread>
+
+#include "libmccomp.hpp"
+#include "options.hpp"
+#include "protocol.hpp"
+
+//===----------------------------------------------------------------------===//
+// Compile server
+//===----------------------------------------------------------------------===//
+//
+// mccomp --serve initialises LLVM and the target machine once, then forks a
+// pool of worker processes that all accept() on the same Unix-domain socket.
+// Each worker inherits that warm CompilerInstance and compiles one request at
+// a time, so requests are served concurrently across workers while none of
+// them pays process startup or target initialisation. The parent respawns
+// workers that die and removes the socket on SIGINT/SIGTERM.
+
+static volatile sig_atomic_t ServerStopping = 0;
+
+static void stopServer(int) { ServerStopping = 1; }
+
+static std::string readCaptured(FILE *f)
+{
+  std::string text;
+  char buf[4096];
+  size_t n;
+  rewind(f);
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+    text.append(buf, n);
+  return text;
+}
+
+// the response to a request that could not be read
+static void sendProtocolError(int conn, const std::string &message)
+{
+  sendFrame(conn, "1") && sendFrame(conn, "") &&
+      sendFrame(conn, "Invalid compile server request: " + message + "\n") && sendFrame(conn, "");
+}
+
+// read the next frame of a request that may still hold Budget bytes, a
+// longer one gets a protocol error before anything is allocated for it
+static bool recvRequestFrame(int conn, std::string &data, size_t &Budget)
+{
+  uint32_t len;
+  if (!recvFrameLength(conn, len))
+    return false;
+  if (len > Budget)
+  {
+    sendProtocolError(conn, "longer than " + std::to_string(MaxRequestSize) + " bytes");
+    return false;
+  }
+  Budget -= len;
+  data.resize(len);
+  return readAll(conn, &data[0], len);
+}
+
+// compile a single request, anything the compiler prints to stdout/stderr is
+// captured and sent back to the client
+static void serveRequest(CompilerInstance &Compiler, int conn)
+{
+  std::string cwd, argcStr, source;
+  size_t Budget = MaxRequestSize;
+  if (!recvRequestFrame(conn, cwd, Budget) || !recvRequestFrame(conn, argcStr, Budget))
+    return;
+  char *end;
+  long argc = strtol(argcStr.c_str(), &end, 10);
+  if (argcStr.empty() || *end != '\0' || argc < 0 || argc > MaxRequestArgs)
+  {
+    sendProtocolError(conn, "argc \"" + argcStr + "\" is not a number from 0 to " + std::to_string(MaxRequestArgs));
+    return;
+  }
+  std::vector<std::string> args(argc);
+  for (auto &a : args)
+  {
+    if (!recvRequestFrame(conn, a, Budget))
+      return;
+  }
+  if (!recvRequestFrame(conn, source, Budget))
+    return;
+
+  std::vector<char *> argv = {(char *)"mccomp"};
+  for (auto &a : args)
+    argv.push_back(&a[0]);
+
+  FILE *capturedOut = tmpfile();
+  FILE *capturedErr = tmpfile();
+  fflush(stdout);
+  fflush(stderr);
+  int savedOut = dup(1), savedErr = dup(2);
+  dup2(fileno(capturedOut), 1);
+  dup2(fileno(capturedErr), 2);
+
+  int rc = 1;
+  std::string output;
+  CompilerOptions RequestOpts;
+  RequestOpts.Verbose = true;
+  if (chdir(cwd.c_str()) != 0)
+    perror("Could not change to the client's working directory");
+  else if (!parseCommandLine(argv.size(), argv.data(), RequestOpts) || RequestOpts.Watch || RequestOpts.Serve)
+    fprintf(stderr, "Invalid compile server request\n");
+  else
+    rc = compile(Compiler, RequestOpts, &source, output);
+
+  std::cout.flush();
+  fflush(stdout);
+  fflush(stderr);
+  dup2(savedOut, 1);
+  dup2(savedErr, 2);
+  close(savedOut);
+  close(savedErr);
+
+  sendFrame(conn, std::to_string(rc)) &&
+      sendFrame(conn, readCaptured(capturedOut)) &&
+      sendFrame(conn, readCaptured(capturedErr)) &&
+      sendFrame(conn, output);
+  fclose(capturedOut);
+  fclose(capturedErr);
+}
+
+static void serverWorker(CompilerInstance &Compiler, int listenFd)
+{
+  signal(SIGINT, SIG_DFL);
+  signal(SIGTERM, SIG_DFL);
+  signal(SIGPIPE, SIG_IGN); // a client that went away must not kill the worker
+  while (true)
+  {
+    int conn = accept(listenFd, nullptr, nullptr);
+    if (conn < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      perror("accept");
+      return;
+    }
+    serveRequest(Compiler, conn);
+    close(conn);
+  }
+}
+
+static pid_t spawnWorker(CompilerInstance &Compiler, int listenFd)
+{
+  pid_t pid = fork();
+  if (pid == 0)
+  {
+    serverWorker(Compiler, listenFd);
+    _exit(1);
+  }
+  return pid;
+}
+
+static int runServer(CompilerInstance &Compiler)
+{
+  std::string path = Opts.SocketPath.empty() ? defaultSocketPath() : Opts.SocketPath;
+  unsigned workers = Opts.Workers ? Opts.Workers : std::max(1u, std::thread::hardware_concurrency());
+
+  // initialise the target before forking so every worker starts warm
+  std::string Err = Compiler.initializeTarget();
+  if (!Err.empty())
+  {
+    fprintf(stderr, "%s", Err.c_str());
+    return 1;
+  }
+
+  int listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+  sockaddr_un addr = socketAddress(path);
+  unlink(path.c_str());
+  if (listenFd < 0 || bind(listenFd, (sockaddr *)&addr, sizeof(addr)) < 0 || listen(listenFd, 128) < 0)
+  {
+    perror(("Could not listen on " + path).c_str());
+    return 1;
+  }
+
+  // no SA_RESTART, so wait() below returns when we are asked to stop
+  struct sigaction sa = {};
+  sa.sa_handler = stopServer;
+  sigaction(SIGINT, &sa, nullptr);
+  sigaction(SIGTERM, &sa, nullptr);
+
+  std::set<pid_t> children;
+  for (unsigned i = 0; i < workers; i++)
+    children.insert(spawnWorker(Compiler, listenFd));
+  fprintf(stdout, "mccomp server listening on %s with %u workers\n", path.c_str(), workers);
+  fflush(stdout);
+
+  while (!ServerStopping)
+  {
+    int status;
+    pid_t pid = wait(&status);
+    if (pid < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      break;
+    }
+    children.erase(pid);
+    if (!ServerStopping)
+      children.insert(spawnWorker(Compiler, listenFd));
+  }
+
+  for (pid_t pid : children)
+    kill(pid, SIGTERM);
+  for (pid_t pid : children)
+    waitpid(pid, nullptr, 0);
+  close(listenFd);
+  unlink(path.c_str());
+  return 0;
+}
+
+#endif
@@ -0,0 +1,233 @@
+#ifndef STATS_HPP
+#define STATS_HPP
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+
+#include "libmccomp.hpp"
+#include "token.hpp"
+
+//===----------------------------------------------------------------------===//
+// Compiler statistics
+//===----------------------------------------------------------------------===//
+//
+// --stats[=json] reports, for one compile:
+//  - the number of tokens lexed
+//  - AST nodes created, by class, with the bytes of the nodes themselves, and
+//    the heap the AST holds once it is parsed (everything allocated while
+//    parsing and not freed again)
+//  - the instructions, basic blocks and allocas generated for every function,
+//    counted before optimisation
+//  - narrowing conversion warnings
+//  - heap allocations and bytes allocated in every phase (see PhaseScope)
+//  - the peak RSS of the process
+//
+// Heap figures come from TheHeapCounters (libmccomp.hpp), which only count when
+// the program has replaced operator new, as mccomp does; they are left out
+// otherwise. They are process wide, so allocations made by the lexer and
+// parser threads of --pipeline count towards the code generation phase. The
+// AST is never held in full with --pipeline or --stream, so its heap is only
+// reported for other compiles. Functions brought up to date from the cache of
+// an incremental build are not generated and not counted.
+
+struct FunctionStats
+{
+  std::string Name;
+  unsigned Instructions = 0, Blocks = 0, Allocas = 0;
+};
+
+struct CompileStats
+{
+  unsigned long long Tokens = 0; // CompilerState::TokensLexed once finished
+  std::map<std::string, std::pair<unsigned long long, unsigned long long>> Nodes; // class -> count, bytes
+  long long ASTHeap = -1; // bytes, -1 if unknown
+  std::vector<FunctionStats> Functions;
+  unsigned NarrowingWarnings = 0;
+  std::vector<std::pair<std::string, std::pair<unsigned long long, unsigned long long>>> Phases; // allocations, bytes
+  long PeakRSS = 0; // KB
+
+  void countNode(const char *Kind, size_t Bytes)
+  {
+    auto &N = Nodes[Kind];
+    N.first++;
+    N.second += Bytes;
+  }
+
+  void countAllocations(const char *Phase, unsigned long long Allocations, unsigned long long Bytes)
+  {
+    auto it = std::find_if(Phases.begin(), Phases.end(), [Phase](auto &P)
+                           { return P.first == Phase; });
+    if (it == Phases.end())
+      it = Phases.insert(Phases.end(), {Phase, {0, 0}});
+    it->second.first += Allocations;
+    it->second.second += Bytes;
+  }
+
+  // count what codegen generated for every function defined in M
+  void countIR(const Module &M)
+  {
+    for (const Function &F : M)
+    {
+      if (F.isDeclaration())
+        continue;
+      FunctionStats S;
+      S.Name = F.getName().str();
+      for (const BasicBlock &BB : F)
+      {
+        S.Blocks++;
+        for (const Instruction &I : BB)
+        {
+          S.Instructions++;
+          S.Allocas += isa<AllocaInst>(I);
+        }
+      }
+      Functions.push_back(S);
+    }
+  }
+
+  // called once the compile is over
+  void finish(const std::vector<std::string> &warnings)
+  {
+    Tokens = CS->TokensLexed;
+    for (auto &w : warnings)
+      NarrowingWarnings += w.find("Narrowing conversion") != std::string::npos;
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    PeakRSS = usage.ru_maxrss / 1024; // bytes on macOS
+#else
+    PeakRSS = usage.ru_maxrss;
+#endif
+  }
+
+  std::string print(bool JSON) const
+  {
+    FunctionStats Total;
+    for (auto &F : Functions)
+    {
+      Total.Instructions += F.Instructions;
+      Total.Blocks += F.Blocks;
+      Total.Allocas += F.Allocas;
+    }
+    unsigned long long NodeCount = 0, NodeBytes = 0;
+    for (auto &N : Nodes)
+    {
+      NodeCount += N.second.first;
+      NodeBytes += N.second.second;
+    }
+    bool Heap = TheHeapCounters.Allocations.load() > 0;
+    std::string out;
+    char line[256];
+
+    if (JSON)
+    {
+      auto field = [&out, &line](const char *Name, unsigned long long Value)
+      {
+        snprintf(line, sizeof(line), "\"%s\": %llu, ", Name, Value);
+        out += line;
+      };
+      out += "{";
+      field("tokens", Tokens);
+      field("narrowing_warnings", NarrowingWarnings);
+      field("peak_rss_kb", PeakRSS);
+      if (Heap && ASTHeap >= 0)
+        field("ast_heap_bytes", ASTHeap);
+      out += "\"ast_nodes\": {";
+      for (auto it = Nodes.begin(); it != Nodes.end(); ++it)
+      {
+        out += it == Nodes.begin() ? "" : ", ";
+        snprintf(line, sizeof(line), "\"%s\": {\"count\": %llu, \"bytes\": %llu}", it->first.c_str(), it->second.first, it->second.second);
+        out += line;
+      }
+      out += "}, \"functions\": [";
+      for (size_t i = 0; i < Functions.size(); i++)
+      {
+        const FunctionStats &F = Functions[i];
+        out += (i ? ", {\"name\": \"" : "{\"name\": \"") + F.Name + "\", ";
+        snprintf(line, sizeof(line), "\"instructions\": %u, \"blocks\": %u, \"allocas\": %u}", F.Instructions, F.Blocks, F.Allocas);
+        out += line;
+      }
+      out += "]";
+      if (Heap)
+      {
+        out += ", \"phases\": {";
+        for (size_t i = 0; i < Phases.size(); i++)
+        {
+          snprintf(line, sizeof(line), "%s\"%s\": {\"allocations\": %llu, \"bytes\": %llu}",
+                   i ? ", " : "", Phases[i].first.c_str(), Phases[i].second.first, Phases[i].second.second);
+          out += line;
+        }
+        out += "}";
+      }
+      return out + "}\n";
+    }
+
+    out += "===-------------------------------------------------------------------------===\n"
+           "                              Compiler statistics\n"
+           "===-------------------------------------------------------------------------===\n";
+    snprintf(line, sizeof(line), "  %-32s %12llu\n  %-32s %12u\n  %-32s %9ld KB\n", "Tokens", Tokens,
+             "Narrowing conversion warnings", NarrowingWarnings, "Peak RSS", PeakRSS);
+    out += line;
+    if (Heap && ASTHeap >= 0)
+    {
+      snprintf(line, sizeof(line), "  %-32s %12lld\n", "AST heap (bytes)", ASTHeap);
+      out += line;
+    }
+
+    snprintf(line, sizeof(line), "\n  %-32s %12s %12s\n", "AST nodes", "Count", "Bytes");
+    out += line;
+    for (auto &N : Nodes)
+    {
+      snprintf(line, sizeof(line), "  %-32s %12llu %12llu\n", N.first.c_str(), N.second.first, N.second.second);
+      out += line;
+    }
+    snprintf(line, sizeof(line), "  %-32s %12llu %12llu\n", "Total", NodeCount, NodeBytes);
+    out += line;
+
+    // the largest functions only, --stats=json lists all of them
+    std::vector<FunctionStats> Largest = Functions;
+    std::sort(Largest.begin(), Largest.end(), [](const FunctionStats &A, const FunctionStats &B)
+              { return A.Instructions > B.Instructions; });
+    Largest.resize(std::min<size_t>(Largest.size(), 10));
+    snprintf(line, sizeof(line), "\n  %-32s %12s %12s %12s\n", "Generated IR", "Instructions", "Blocks", "Allocas");
+    out += line;
+    for (auto &F : Largest)
+    {
+      snprintf(line, sizeof(line), "  %-32.32s %12u %12u %12u\n", F.Name.c_str(), F.Instructions, F.Blocks, F.Allocas);
+      out += line;
+    }
+    std::string Label = "Total (" + std::to_string(Functions.size()) + " functions)";
+    snprintf(line, sizeof(line), "  %-32s %12u %12u %12u\n", Label.c_str(), Total.Instructions, Total.Blocks, Total.Allocas);
+    out += line;
+
+    if (Heap)
+    {
+      snprintf(line, sizeof(line), "\n  %-32s %12s %12s\n", "Heap", "Allocations", "Bytes");
+      out += line;
+      for (auto &P : Phases)
+      {
+        snprintf(line, sizeof(line), "  %-32s %12llu %12llu\n", P.first.c_str(), P.second.first, P.second.second);
+        out += line;
+      }
+    }
+    return out;
+  }
+};
+
+// bytes allocated and not yet freed by the process, if heap use is counted
+static long long liveHeap()
+{
+  return (long long)(TheHeapCounters.Allocated.load() - TheHeapCounters.Freed.load());
+}
+
+#endif
@@ -0,0 +1,149 @@
+#ifndef STREAMING_HPP
+#define STREAMING_HPP
+
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+
+#include "astnode.hpp"
+#include "backend.hpp"
+#include "incremental.hpp"
+#include "optimizer.hpp"
+#include "remarks.hpp"
+#include "timing.hpp"
+
+//===----------------------------------------------------------------------===//
+// Streaming compilation
+//===----------------------------------------------------------------------===//
+//
+// --stream[=<n>] generates code for every top-level declaration as soon as it
+// has been parsed and frees its AST straight away. Code goes into a chunk
+// module of at most n functions (256 by default) that has a context of its own
+// and declares only the functions and globals the chunk uses. A full chunk is
+// optimised, written to a file of its own (output.0.ll, output.1.ll, ... or .o
+// with --emit=obj) and then freed together with its context.
+//
+// The only things kept for the whole program are the prototypes of the
+// declarations seen so far (DeclEnv), the warnings and remarks, and the
+// optimisation record, which every chunk's context reports to (see
+// remarks.hpp). Peak memory is therefore the largest chunk plus the largest
+// single declaration, plus a prototype (a few hundred bytes) per top-level
+// declaration, rather than the AST and IR of the whole program. Link all the chunk files to build the
+// program. Nothing is inlined across chunks.
+
+class StreamEmitter
+{
+  DeclEnv Env;
+  std::string Stem, Ext;
+  unsigned ChunkSize;
+  unsigned Chunks = 0;
+  unsigned InChunk = 0; // functions in the current chunk
+  bool Pending = false; // the current chunk has anything in it
+
+  void startChunk()
+  {
+    CS->GlobalNamedValues.clear();
+    CS->TheModule.reset();
+    CS->Builder.reset();
+    CS->TheContext = std::make_unique<LLVMContext>();
+    attachRemarks(*CS->TheContext);
+    CS->Builder = std::make_unique<IRBuilder<>>(*CS->TheContext);
+    CS->TheModule = createModule("mini-c", *CS->TheContext);
+  }
+
+  // declare Name in the chunk if it was declared earlier in the program
+  void declare(const std::string &Name, const std::map<std::string, Prototype> &Table)
+  {
+    auto it = Table.find(Name);
+    if (it != Table.end() && !CS->TheModule->getNamedValue(Name))
+      declarePrototype(it->second);
+  }
+
+  void flushChunk()
+  {
+    if (CS->Stats)
+      CS->Stats->countIR(*CS->TheModule);
+    lowerModule(*CS->TheModule);
+    checkModule(*CS->TheModule, CS->Opts.Verify);
+    optimizeModule(*CS->TheModule, CS->Opts.OptLevel);
+
+    PhaseScope Phase("emit", "Emission");
+    std::string Path = Stem + "." + std::to_string(Chunks++) + Ext;
+    std::error_code EC;
+    raw_fd_ostream out(Path, EC, sys::fs::OF_None);
+    if (EC)
+      error("Could not open file " + Path + ": " + EC.message());
+    if (CS->Opts.Output == OutputKind::Object)
+      emitObject(*CS->TheModule, out);
+    else
+      CS->TheModule->print(out, nullptr);
+    Files.push_back(Path);
+
+    startChunk();
+    InChunk = 0;
+    Pending = false;
+  }
+
+public:
+  std::vector<std::string> Files; // chunk files written so far
+
+  StreamEmitter(unsigned ChunkSize) : ChunkSize(ChunkSize)
+  {
+    std::string Output = CS->Opts.OutputFile;
+    if (Output.empty())
+      Output = CS->Opts.Output == OutputKind::Object ? "output.o" : "output.ll";
+    Ext = sys::path::extension(Output).str();
+    Stem = Output.substr(0, Output.size() - Ext.size());
+    startChunk();
+  }
+
+  // generate D into the current chunk and free it
+  void add(std::unique_ptr<ASTnode> D)
+  {
+    Prototype P;
+    if (D->isFunction())
+      P = static_cast<FunctionASTnode *>(D.get())->getPrototype();
+    else if (D->isExtern())
+      P = static_cast<ExternASTnode *>(D.get())->getPrototype();
+    else
+      P = static_cast<VarDeclASTnode *>(D.get())->getPrototype();
+    std::map<std::string, Prototype> &Table = P.IsFunction ? Env.Functions : Env.Globals;
+
+    // so redefinitions are still reported by codegen()
+    declare(P.Name, Table);
+    std::set<std::string> Calls, Vars;
+    D->collectDeps(Calls, Vars);
+    for (auto &c : Calls)
+      declare(c, Env.Functions);
+    for (auto &v : Vars)
+      declare(v, Env.Globals);
+
+    {
+      PhaseScope Phase("codegen", "Code generation");
+      D->codegen();
+    }
+    Table[P.Name] = P;
+    Pending = true;
+    if (D->isFunction() && ++InChunk == ChunkSize)
+      flushChunk();
+  }
+
+  // write the last chunk and remove chunk files left over from a previous,
+  // larger build so they don't get linked in by accident
+  void finish()
+  {
+    if (Pending || Chunks == 0)
+      flushChunk();
+    for (unsigned i = Chunks; sys::fs::exists(Stem + "." + std::to_string(i) + Ext); i++)
+      sys::fs::remove(Stem + "." + std::to_string(i) + Ext);
+  }
+
+  // compilation failed, don't leave part of the program behind
+  void abandon()
+  {
+    for (auto &f : Files)
+      sys::fs::remove(f);
+    Files.clear();
+  }
+};
+
+#endif
@@ -0,0 +1,57 @@
+// MiniC program whose function attributes the driver checks, the comments
+// say what each function is inferred to be
+
+extern int print_int(int X);
+
+int counter;
+
+// readnone nounwind norecurse willreturn nocallback
+int square(int x) {
+    return x * x;
+}
+
+// the same, through square
+int sum_squares(int a, int b) {
+    return square(a) + square(b);
+}
+
+// readnone nounwind nocallback, it recurses
+int fact(int n) {
+    if (n < 2) {
+        return 1;
+    }
+    return n * fact(n - 1);
+}
+
+// readonly nounwind norecurse willreturn nocallback
+int get_counter() {
+    return counter;
+}
+
+// nounwind norecurse nocallback, it writes a global and loops
+int count(int n) {
+    int i;
+    i = 0;
+    while (i < n) {
+        i = i + 1;
+    }
+    counter = counter + i;
+    return counter;
+}
+
+// readnone nounwind norecurse willreturn nocallback, the parameter and the
+// local hide the global
+int shadow(int counter) {
+    counter = counter + 1;
+    {
+        int counter;
+        counter = 2;
+    }
+    return counter;
+}
+
+// nothing, print_int may do anything
+int attributes_driver(int n) {
+    print_int(sum_squares(n, n));
+    return count(n) + get_counter() + fact(n) + shadow(n);
+}
@@ -0,0 +1,57 @@
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+#include "../ir_check.hpp"
+
+// ../../mccomp ./attributes.c
+// clang++ driver.cpp output.ll -o attributes
+//
+// Compiles attributes.c again with --export-summary and checks what was
+// inferred, then compiles a file calling its functions extern with
+// --import-summary and checks the calls to the pure function were CSE'd.
+
+#ifdef _WIN32
+#define DLLEXPORT __declspec(dllexport)
+#else
+#define DLLEXPORT
+#endif
+
+extern "C" DLLEXPORT int print_int(int X) {
+  fprintf(stderr, "%d\n", X);
+  return 0;
+}
+
+extern "C" {
+    int attributes_driver(int n);
+}
+
+int main() {
+  int result = attributes_driver(5);
+
+  std::string Summary = tempPath(".summary");
+  bool summary = compile("--export-summary=" + Summary, "attributes.c").Ok &&
+                 readFile(Summary) == "mccomp-summary 1\n"
+                                      "attributes_driver\n"
+                                      "count nounwind norecurse nocallback\n"
+                                      "fact readnone nounwind nocallback\n"
+                                      "get_counter readonly nounwind norecurse willreturn nocallback\n"
+                                      "shadow readnone nounwind norecurse willreturn nocallback\n"
+                                      "square readnone nounwind norecurse willreturn nocallback\n"
+                                      "sum_squares readnone nounwind norecurse willreturn nocallback\n";
+
+  // square is only known through the summary here, so both calls stay at
+  // -O1 without it
+  std::string Source = writeSource("extern int square(int x);\n"
+                                   "int twice(int x) { return square(x) + square(x); }\n");
+  bool imported = countCalls(functionBody(compileIR("-O1 --import-summary=" + Summary, Source), "twice"), "square") == 1 &&
+                  countCalls(functionBody(compileIR("-O1", Source), "twice"), "square") == 2;
+  remove(Summary.c_str());
+  remove(Source.c_str());
+
+  // 5*5 + 5*5 printed, count 5, counter 5, 5! and 5 + 1
+  if (result == 136 && summary && imported)
+    std::cout << "PASSED Result: " << result << std::endl;
+  else
+    std::cout << "FAILED Result: " << result << " summary: " << summary << " imported: " << imported << std::endl;
+}
@@ -0,0 +1,31 @@
+// MiniC program using the optimisation hints, the driver checks what they
+// were generated as
+
+extern int print_int(int X);
+
+// only ever called with 0 or 1
+int classify(int x) {
+    if (x == 0) {
+        return 10;
+    }
+    if (x == 1) {
+        return 20;
+    }
+    __unreachable();
+}
+
+int builtins_driver(int n) {
+    int i;
+    int sum;
+    __assume(n > 0);
+    i = 0;
+    sum = 0;
+    while (__likely(i < n)) {
+        if (__unlikely(i % 1000 == 999)) {
+            print_int(i);
+        }
+        sum = sum + i;
+        i = i + 1;
+    }
+    return sum + classify(0) + classify(1);
+}
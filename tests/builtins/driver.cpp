@@ -0,0 +1,49 @@
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../ir_check.hpp"
+
+// ../../mccomp ./builtins.c
+// clang++ driver.cpp output.ll -o builtins
+//
+// Runs builtins_driver, then compiles builtins.c again and checks the hints
+// became intrinsics and branch weights, and no symbol of their own.
+
+#ifdef _WIN32
+#define DLLEXPORT __declspec(dllexport)
+#else
+#define DLLEXPORT
+#endif
+
+static int printed = 0;
+
+extern "C" DLLEXPORT int print_int(int X) {
+  printed++;
+  return 0;
+}
+
+extern "C" {
+    int builtins_driver(int n);
+}
+
+int main() {
+  int result = builtins_driver(3000);
+
+  std::string IR = compileIR("", "builtins.c");
+  // the loop's condition is generated at its guard and its latch
+  bool lowered = !IR.empty() && !contains(IR, "@__") && countCalls(IR, "llvm.expect.i1") == 3 &&
+                 countCalls(IR, "llvm.assume") == 1 && countInstructions(IR, "unreachable") >= 1;
+  std::vector<std::vector<unsigned>> Weights = branchWeights(IR);
+  bool weighted = std::count(Weights.begin(), Weights.end(), std::vector<unsigned>{2000, 1}) == 1 &&
+                  std::count(Weights.begin(), Weights.end(), std::vector<unsigned>{1, 2000}) == 1;
+
+  // 0 + 1 + ... + 2999, classify(0) and classify(1)
+  if (result == 4498530 && printed == 3 && lowered && weighted)
+    std::cout << "PASSED Result: " << result << std::endl;
+  else
+    std::cout << "FAILED Result: " << result << " printed: " << printed << " lowered: " << lowered
+              << " weighted: " << weighted << std::endl;
+}
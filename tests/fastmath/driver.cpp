@@ -0,0 +1,50 @@
+#include <iostream>
+#include <string>
+
+#include "../ir_check.hpp"
+
+// ../../mccomp ./fastmath.c
+// clang++ driver.cpp output.ll -o fastmath
+//
+// Runs fastmath_driver, then compiles fastmath.c again with each of the
+// float options and checks the flags its instructions carry.
+
+extern "C" {
+    float fastmath_driver(int n);
+}
+
+// the IR of fastmath.c compiled with Options, "" if it did not compile
+static std::string compile(const std::string &Options) {
+  return compileIR(Options, "fastmath.c");
+}
+
+int main() {
+  float result = fastmath_driver(10);
+
+  // only [[fast_math]] norm2 is relaxed by default
+  std::string IR = compile("");
+  bool strict = countInstructions(functionBody(IR, "norm2"), "fmul", "fast") == 2 &&
+                countInstructions(functionBody(IR, "norm2"), "fadd", "fast") == 1 && countInstructions(IR, "fmul") == 2 &&
+                attributeValue(IR, "norm2", "unsafe-fp-math") == "true" && !hasAttribute(IR, "axpy", "unsafe-fp-math") &&
+                countCalls(IR, "llvm.fmuladd.f32") == 0;
+  // norm2's x * x, axpy's a * x and axmy's a * x, negated
+  IR = compile("-ffp-contract=on");
+  bool on = countCalls(functionBody(IR, "norm2"), "llvm.fmuladd.f32", "fast") == 1 &&
+            countCalls(functionBody(IR, "axpy"), "llvm.fmuladd.f32", "") == 1 &&
+            countCalls(functionBody(IR, "axmy"), "llvm.fmuladd.f32", "") == 1 &&
+            countInstructions(functionBody(IR, "axmy"), "fneg") == 1;
+  IR = compile("-ffp-contract=fast");
+  bool fast = countInstructions(IR, "fmul", "contract") == 2 && countInstructions(IR, "fmul") == 0;
+  IR = compile("-fassociative-math");
+  bool reassoc = countInstructions(IR, "fadd", "reassoc") >= 2 && countInstructions(IR, "fsub", "reassoc") >= 2;
+  IR = compile("-ffast-math");
+  bool fastmath = countInstructions(IR, "fmul", "fast") == 4 && countInstructions(IR, "fmul") == 0 &&
+                  countInstructions(IR, "fadd") == 0;
+
+  // the sum of 3i - i * i for i from 0 to 9
+  if (result == -150.0f && strict && on && fast && reassoc && fastmath)
+    std::cout << "PASSED Result: " << result << std::endl;
+  else
+    std::cout << "FAILED Result: " << result << " strict: " << strict << " on: " << on << " fast: " << fast
+              << " reassoc: " << reassoc << " fast-math: " << fastmath << std::endl;
+}
@@ -0,0 +1,28 @@
+// MiniC program with float code for -ffast-math, -fassociative-math and
+// -ffp-contract, the driver checks the flags it is generated with
+
+[[fast_math]] float norm2(float x, float y) {
+    return x * x + y * y;
+}
+
+float axpy(float a, float x, float y) {
+    return a * x + y;
+}
+
+float axmy(float a, float x, float y) {
+    return y - a * x;
+}
+
+float fastmath_driver(int n) {
+    int i;
+    float x;
+    float sum;
+    i = 0;
+    sum = 0.0;
+    while (i < n) {
+        x = i;
+        sum = sum + axpy(2.0, x, 1.0) - axmy(1.0, x, norm2(x, 1.0));
+        i = i + 1;
+    }
+    return sum;
+}
@@ -0,0 +1,54 @@
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+#include "../ir_check.hpp"
+
+// ../../mccomp ./funcattrs.c
+// clang++ driver.cpp output.ll -o funcattrs
+//
+// Runs funcattrs_driver, then compiles funcattrs.c again at -O2 and checks
+// the declared attributes made it into the IR and the optimiser used them.
+
+#ifdef _WIN32
+#define DLLEXPORT __declspec(dllexport)
+#else
+#define DLLEXPORT
+#endif
+
+extern "C" DLLEXPORT int report(int code) {
+  fprintf(stderr, "report %d\n", code);
+  return 0;
+}
+
+extern "C" DLLEXPORT float cosine(float x) {
+  return cosf(x);
+}
+
+extern "C" {
+    int funcattrs_driver(int n);
+}
+
+int main() {
+  int result = funcattrs_driver(5);
+
+  Compiled C = compile("-O2", "funcattrs.c");
+  std::string IR = C.Output;
+  bool attributes = C.Ok && hasAttribute(IR, "report", "cold") && hasAttribute(IR, "add_one", "noinline") &&
+                    hasAttribute(IR, "twice", "hot") && hasAttribute(IR, "cosine", "readnone");
+  bool optimised = countCalls(IR, "cosine") == 1 && countCalls(IR, "add_one") == 1;
+  bool warned = count(C.Out, "`bump` is declared [[pure]] but may write global variables") == 1;
+
+  // only functions can be given attributes
+  std::string Source = writeSource("[[cold]] int x;\n");
+  bool rejected = !compile("", Source).Ok;
+  remove(Source.c_str());
+
+  // twice(5 + 1) + 5 + 100
+  if (result == 117 && attributes && optimised && warned && rejected)
+    std::cout << "PASSED Result: " << result << std::endl;
+  else
+    std::cout << "FAILED Result: " << result << " attributes: " << attributes << " optimised: " << optimised
+              << " warned: " << warned << " rejected: " << rejected << std::endl;
+}
@@ -0,0 +1,40 @@
+// MiniC program declaring what can't be inferred, the driver checks the
+// attributes reach the optimised IR
+
+extern [[cold]] int report(int code);
+extern [[const]] float cosine(float x);
+
+int calls;
+
+[[noinline]] int add_one(int x) {
+    return x + 1;
+}
+
+[[always_inline, hot]] int twice(int x) {
+    return x + x;
+}
+
+// warned about, it writes a global
+[[pure]] int bump() {
+    calls = calls + 1;
+    return calls;
+}
+
+int funcattrs_driver(int n) {
+    int i;
+    float total;
+    i = 0;
+    total = 0.0;
+    // both calls are CSE'd and hoisted out of the loop from -O1 on
+    while (i < n) {
+        total = total + cosine(1.0) + cosine(1.0);
+        i = i + 1;
+    }
+    if (n < 0) {
+        report(n);
+    }
+    if (total > 5.0) {
+        i = i + 100;
+    }
+    return twice(add_one(n)) + i;
+}
@@ -0,0 +1,275 @@
+#ifndef IR_CHECK_HPP
+#define IR_CHECK_HPP
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Helpers for drivers that compile their test program again with other
+// options and check what mccomp made of it. A driver runs in tests/<name>/,
+// as the runner and tests.sh run it, and includes this as "../ir_check.hpp".
+//
+// The IR is matched by its structure: the functions it defines, their
+// attributes and the instructions and calls in their bodies, so checks don't
+// depend on how LLVM happens to print or order them.
+
+static std::string readFile(const std::string &Path) {
+  std::ifstream f(Path, std::ios::binary);
+  std::stringstream ss;
+  ss << f.rdbuf();
+  return ss.str();
+}
+
+static int count(const std::string &S, const std::string &Part) {
+  int n = 0;
+  for (size_t p = S.find(Part); p != std::string::npos; p = S.find(Part, p + 1))
+    n++;
+  return n;
+}
+
+static bool contains(const std::string &S, const std::string &Part) {
+  return S.find(Part) != std::string::npos;
+}
+
+// a path in /tmp no other test run uses, ending in Suffix
+static std::string tempPath(const std::string &Suffix) {
+  static int n = 0;
+  return "/tmp/mccomp-test-" + std::to_string(getpid()) + "-" + std::to_string(n++) + Suffix;
+}
+
+// a MiniC file in /tmp holding Text, for the driver to remove
+static std::string writeSource(const std::string &Text) {
+  std::string Path = tempPath(".c");
+  std::ofstream(Path) << Text;
+  return Path;
+}
+
+struct Compiled {
+  bool Ok = false;
+  std::string Output; // the IR, or the object file with --emit=obj, the chunks one after another with --stream
+  std::string Out;    // what mccomp printed, warnings and remarks included
+};
+
+// compile Source with ../../mccomp and Options
+static Compiled compile(const std::string &Options, const std::string &Source) {
+  bool Object = contains(Options, "--emit=obj");
+  std::string Stem = tempPath(""), Ext = Object ? ".o" : ".ll", Path = Stem + Ext, Log = Path + ".out";
+  std::string Cmd = "../../mccomp " + Options + " -o " + Path + " " + Source + " > " + Log + " 2>&1";
+  Compiled C;
+  C.Ok = system(Cmd.c_str()) == 0;
+  C.Out = readFile(Log);
+  remove(Log.c_str());
+  if (!contains(Options, "--stream")) {
+    C.Output = C.Ok ? readFile(Path) : "";
+    remove(Path.c_str());
+    return C;
+  }
+  // output.0.ll, output.1.ll, ...
+  for (int i = 0;; i++) {
+    std::string Chunk = Stem + "." + std::to_string(i) + Ext;
+    std::ifstream f(Chunk);
+    if (!f)
+      break;
+    C.Output += C.Ok ? readFile(Chunk) : "";
+    remove(Chunk.c_str());
+  }
+  return C;
+}
+
+// the IR of Source compiled with Options, "" if it did not compile
+static std::string compileIR(const std::string &Options, const std::string &Source) {
+  return compile(Options, Source).Output;
+}
+
+//===----------------------------------------------------------------------===//
+// IR structure
+//===----------------------------------------------------------------------===//
+
+static std::vector<std::string> lines(const std::string &Text) {
+  std::vector<std::string> Lines;
+  std::istringstream in(Text);
+  std::string Line;
+  while (std::getline(in, Line))
+    Lines.push_back(Line);
+  return Lines;
+}
+
+// the "define ..." or "declare ..." line of function Name, "" if IR has
+// neither
+static std::string functionHeader(const std::string &IR, const std::string &Name) {
+  for (auto &Line : lines(IR))
+    if ((Line.compare(0, 7, "define ") == 0 || Line.compare(0, 8, "declare ") == 0) && contains(Line, " @" + Name + "("))
+      return Line;
+  return "";
+}
+
+static bool defines(const std::string &IR, const std::string &Name) {
+  return functionHeader(IR, Name).compare(0, 7, "define ") == 0;
+}
+
+static bool declares(const std::string &IR, const std::string &Name) {
+  return functionHeader(IR, Name).compare(0, 8, "declare ") == 0;
+}
+
+// the body of function Name, "" if IR doesn't define it
+static std::string functionBody(const std::string &IR, const std::string &Name) {
+  std::string Header = functionHeader(IR, Name);
+  if (!defines(IR, Name))
+    return "";
+  size_t Start = IR.find(Header);
+  return IR.substr(Start, IR.find("\n}\n", Start) - Start);
+}
+
+// the items of an attribute list: words, "key" and "key"="value"
+static std::vector<std::string> attributeItems(const std::string &List) {
+  std::vector<std::string> Items;
+  std::string Item;
+  bool Quoted = false;
+  for (char c : List) {
+    if (c == '"')
+      Quoted = !Quoted;
+    if (!Quoted && (c == ' ' || c == '{' || c == '}')) {
+      if (!Item.empty())
+        Items.push_back(Item);
+      Item.clear();
+    } else {
+      Item += c;
+    }
+  }
+  if (!Item.empty())
+    Items.push_back(Item);
+  return Items;
+}
+
+// the attributes of function Name, written on its define line and in the
+// attribute groups (#0, #1, ...) it refers to
+static std::vector<std::string> functionAttributes(const std::string &IR, const std::string &Name) {
+  std::string Header = functionHeader(IR, Name);
+  std::vector<std::string> Attrs;
+  size_t Params = Header.find(" @" + Name + "(");
+  if (Params == std::string::npos)
+    return Attrs;
+  // after the parameter list's closing parenthesis
+  int Depth = 0;
+  size_t End = Params + Name.size() + 2;
+  for (; End < Header.size(); End++) {
+    Depth += Header[End] == '(' ? 1 : Header[End] == ')' ? -1 : 0;
+    if (Depth == 0)
+      break;
+  }
+  for (auto &Item : attributeItems(Header.substr(End + 1))) {
+    if (Item[0] != '#') {
+      Attrs.push_back(Item);
+      continue;
+    }
+    for (auto &Line : lines(IR))
+      if (Line.compare(0, 11 + Item.size() + 3, "attributes " + Item + " = ") == 0)
+        for (auto &A : attributeItems(Line.substr(11 + Item.size() + 3)))
+          Attrs.push_back(A);
+  }
+  return Attrs;
+}
+
+// whether function Name has attribute Attr: a word like cold, or a "key" with
+// or without a value
+static bool hasAttribute(const std::string &IR, const std::string &Name, const std::string &Attr) {
+  for (auto &A : functionAttributes(IR, Name))
+    if (A == Attr || A == "\"" + Attr + "\"" || A.compare(0, Attr.size() + 3, "\"" + Attr + "\"=") == 0)
+      return true;
+  return false;
+}
+
+// the value of function Name's "Key"="value" attribute, "" if it has none
+static std::string attributeValue(const std::string &IR, const std::string &Name, const std::string &Key) {
+  std::string Prefix = "\"" + Key + "\"=\"";
+  for (auto &A : functionAttributes(IR, Name))
+    if (A.compare(0, Prefix.size(), Prefix) == 0)
+      return A.substr(Prefix.size(), A.size() - Prefix.size() - 1);
+  return "";
+}
+
+// the +feature and -feature items of function Name's target-features
+static std::set<std::string> targetFeatures(const std::string &IR, const std::string &Name) {
+  std::set<std::string> Features;
+  std::istringstream in(attributeValue(IR, Name, "target-features"));
+  std::string Feature;
+  while (std::getline(in, Feature, ','))
+    Features.insert(Feature);
+  return Features;
+}
+
+// the words of an instruction, without its result, e.g. {"fmul", "fast",
+// "float", ...} for "%multmp = fmul fast float %x, %x"
+static std::vector<std::string> instructionWords(const std::string &Line) {
+  std::istringstream in(Line);
+  std::vector<std::string> Words;
+  std::string Word;
+  while (in >> Word)
+    Words.push_back(Word);
+  if (Words.size() > 2 && Words[0][0] == '%' && Words[1] == "=")
+    Words.erase(Words.begin(), Words.begin() + 2);
+  if (!Words.empty() && (Words[0] == "tail" || Words[0] == "musttail" || Words[0] == "notail"))
+    Words.erase(Words.begin());
+  return Words;
+}
+
+static bool isFlag(const std::string &Word) {
+  static const std::set<std::string> Flags = {"fast", "reassoc", "nnan", "ninf", "nsz", "arcp",
+                                              "contract", "afn", "nuw", "nsw", "exact", "inbounds"};
+  return Flags.count(Word) > 0;
+}
+
+// the instructions in Code with opcode Opcode and exactly the flags in Flags,
+// space separated, e.g. countInstructions(Body, "fmul", "fast")
+static int countInstructions(const std::string &Code, const std::string &Opcode, const std::string &Flags = "") {
+  std::set<std::string> Wanted;
+  std::istringstream in(Flags);
+  std::string Flag;
+  while (in >> Flag)
+    Wanted.insert(Flag);
+  int n = 0;
+  for (auto &Line : lines(Code)) {
+    std::vector<std::string> Words = instructionWords(Line);
+    if (Words.empty() || Words[0] != Opcode)
+      continue;
+    std::set<std::string> Has;
+    for (size_t i = 1; i < Words.size() && isFlag(Words[i]); i++)
+      Has.insert(Words[i]);
+    n += Has == Wanted;
+  }
+  return n;
+}
+
+// the calls in Code to Callee, with exactly the flags in Flags if given
+static int countCalls(const std::string &Code, const std::string &Callee, const char *Flags = nullptr) {
+  int n = 0;
+  for (auto &Line : lines(Code)) {
+    std::vector<std::string> Words = instructionWords(Line);
+    if (!Words.empty() && Words[0] == "call" && contains(Line, "@" + Callee + "("))
+      n += !Flags || countInstructions(Line, "call", Flags) == 1;
+  }
+  return n;
+}
+
+// the weights of every branch_weights node in IR, taken first
+static std::vector<std::vector<unsigned>> branchWeights(const std::string &IR) {
+  std::vector<std::vector<unsigned>> Weights;
+  for (auto &Line : lines(IR)) {
+    size_t p = Line.find("!\"branch_weights\"");
+    if (p == std::string::npos)
+      continue;
+    std::vector<unsigned> W;
+    for (p = Line.find("i32 ", p); p != std::string::npos; p = Line.find("i32 ", p + 4))
+      W.push_back(std::stoul(Line.substr(p + 4)));
+    Weights.push_back(W);
+  }
+  return Weights;
+}
+
+#endif
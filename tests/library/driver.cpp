@@ -0,0 +1,94 @@
+#include <iostream>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+
+#include "../../libmccomp.hpp"
+
+// clang++ driver.cpp ../../libmccomp.a `llvm-config --cxxflags --ldflags --system-libs --libs all` -rdynamic -o library
+
+#ifdef _WIN32
+#define DLLEXPORT __declspec(dllexport)
+#else
+#define DLLEXPORT
+#endif
+
+extern "C" DLLEXPORT int print_int(int X) {
+  fprintf(stderr, "%d\n", X);
+  return 0;
+}
+
+extern "C" DLLEXPORT float print_float(float X) {
+  fprintf(stderr, "%f\n", X);
+  return 0;
+}
+
+// compile library.c with a CompilerInstance of its own and run it in the JIT
+static bool compileAndRun(int n) {
+  CompilerInstance CI;
+  CompilerOptions Opts;
+  Opts.Output = OutputKind::JIT;
+  Opts.OptLevel = n % 4;
+  for (int i = 0; i < 5; i++) {
+    CompileResult R = CI.compileFile("library.c", Opts);
+    if (!R.Success)
+      return false;
+    auto Sym = R.JIT->lookup("library_driver");
+    if (!Sym) {
+      llvm::consumeError(Sym.takeError());
+      return false;
+    }
+#if LLVM_VERSION_MAJOR >= 15
+    auto Driver = Sym->toPtr<int (*)(int)>();
+#else
+    auto Driver = (int (*)(int))Sym->getAddress();
+#endif
+    if (Driver(n + i) != (n + i) * (n + i + 1) / 2)
+      return false;
+  }
+  return true;
+}
+
+int main() {
+  std::vector<std::thread> threads;
+  std::vector<char> ok(8);
+  for (int t = 0; t < 8; t++)
+    threads.emplace_back([t, &ok] { ok[t] = compileAndRun(10 + t); });
+  for (auto &th : threads)
+    th.join();
+
+  int passed = 0;
+  for (char o : ok)
+    passed += o;
+
+  // errors come back as diagnostics and leave the instance usable
+  CompilerInstance CI;
+  CompilerOptions Opts;
+  CompileResult Bad = CI.compileString("int f() { return x; }", Opts);
+  CompileResult Good = CI.compileString("int f() { return 1; }", Opts);
+  bool diagnostics = !Bad.Success && Bad.Error.find("x") != std::string::npos &&
+                     Good.Success && Good.Buffer.find("define i32 @f()") != std::string::npos;
+
+  // the pipelined compiler generates the same module
+  CompilerOptions Piped;
+  Piped.Pipeline = true;
+  CompileResult Seq = CI.compileFile("library.c", Opts);
+  CompileResult Pip = CI.compileFile("library.c", Piped);
+  bool pipeline = Seq.Success && Pip.Success && Seq.Buffer == Pip.Buffer;
+
+  // -g describes the functions and their variables, and locates the code
+  CompilerOptions Debug;
+  Debug.Debug = true;
+  CompileResult G = CI.compileFile("library.c", Debug);
+  bool debug = G.Success && G.Buffer.find("DISubprogram(name: \"library_driver\"") != std::string::npos &&
+               G.Buffer.find("DILocalVariable(") != std::string::npos && G.Buffer.find("!dbg") != std::string::npos &&
+               Seq.Buffer.find("!dbg") == std::string::npos;
+
+  if (passed == 8 && diagnostics && pipeline && debug)
+    std::cout << "PASSED Result: " << passed << std::endl;
+  else
+    std::cout << "FALIED Result: " << passed << std::endl;
+}
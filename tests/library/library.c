@@ -0,0 +1,22 @@
+// MiniC program compiled through libmccomp on several threads at once
+
+extern int print_int(int X);
+
+int sum;
+
+int addNumbers(int n)
+{
+    int i;
+    i = 1;
+    sum = 0;
+    while (i <= n) {
+        sum = sum + i;
+        i = i + 1;
+    }
+    return sum;
+}
+
+int library_driver(int n) {
+    print_int(n);
+    return addNumbers(n);
+}
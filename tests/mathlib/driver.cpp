@@ -0,0 +1,47 @@
+#include <cmath>
+#include <iostream>
+#include <string>
+
+#include "../ir_check.hpp"
+
+// ../../mccomp ./mathlib.c
+// clang++ driver.cpp output.ll -o mathlib
+//
+// Runs mathlib_driver, whose math calls are answered by libm, then compiles
+// mathlib.c again and checks they became intrinsics, that -fno-builtin keeps
+// them calls, and that -fveclib=libmvec vectorises the loop calling sin and
+// cos.
+
+extern "C" {
+    float mathlib_driver(int n);
+}
+
+// the IR of mathlib.c compiled with Options, "" if it did not compile
+static std::string compile(const std::string &Options) {
+  return compileIR(Options, "mathlib.c");
+}
+
+int main() {
+  float result = mathlib_driver(100);
+
+  std::string IR = compile("");
+  bool lowered = countCalls(IR, "llvm.sqrt.f32") == 1 && countCalls(IR, "llvm.fabs.f32") == 1 &&
+                 countCalls(IR, "llvm.floor.f32") == 1 && countCalls(IR, "llvm.minnum.f32") == 1 &&
+                 countCalls(IR, "llvm.maxnum.f32") == 1 && countCalls(IR, "llvm.sin.f32") == 2 &&
+                 countCalls(IR, "llvm.cos.f32") == 2 && functionHeader(IR, "sqrt").empty() &&
+                 functionHeader(IR, "sin").empty() && declares(IR, "round");
+  IR = compile("-fno-builtin");
+  bool calls = countCalls(IR, "sqrt") == 1 && countCalls(IR, "sin") == 2 && countCalls(IR, "llvm.sqrt.f32") == 0;
+  bool vectorised = true;
+#if defined(__x86_64__) && defined(__linux__)
+  IR = compile("-O2 -ffast-math -fveclib=libmvec");
+  vectorised = countCalls(IR, "_ZGVbN4v_sinf") >= 1 && countCalls(IR, "_ZGVbN4v_cosf") >= 1;
+#endif
+
+  // 5 + 2.5 - 3 - 2.5 + 1, and sin^2 + cos^2 a hundred times
+  if (std::fabs(result - 103.0f) < 0.01f && lowered && calls && vectorised)
+    std::cout << "PASSED Result: " << result << std::endl;
+  else
+    std::cout << "FAILED Result: " << result << " lowered: " << lowered << " calls: " << calls
+              << " vectorised: " << vectorised << std::endl;
+}
@@ -0,0 +1,39 @@
+// MiniC program calling the C math library, the driver checks the calls
+// became intrinsics
+
+extern float sqrt(float x);
+extern float fabs(float x);
+extern float floor(float x);
+extern float fmin(float x, float y);
+extern float fmaxf(float x, float y);
+extern float sin(float x);
+extern float cos(float x);
+
+// not the math library's, it takes an int
+extern int round(int x);
+
+float hypot2(float x, float y) {
+    return sqrt(x * x + y * y);
+}
+
+// sin^2 + cos^2 of n points, n if the library is right
+float unit(int n) {
+    int i;
+    float x;
+    float sum;
+    i = 0;
+    sum = 0.0;
+#pragma vectorize(4)
+    while (i < n) {
+        x = i;
+        sum = sum + sin(x) * sin(x) + cos(x) * cos(x);
+        i = i + 1;
+    }
+    return sum;
+}
+
+float mathlib_driver(int n) {
+    float x;
+    x = -2.5;
+    return hypot2(3.0, 4.0) + fabs(x) + floor(x) + fmin(x, 1.0) + fmaxf(x, 1.0) + unit(n);
+}
@@ -0,0 +1,71 @@
+#include <cstdio>
+#include <iostream>
+#include <set>
+#include <string>
+
+#include "../ir_check.hpp"
+
+// ../../mccomp ./multiversion.c
+// clang++ driver.cpp output.ll -o multiversion
+//
+// Runs squares through the clone the resolver picked for this CPU, then
+// compiles multiversion.c again and checks there is a clone for every target
+// with its features, an ifunc and a resolver reading __cpu_model, that
+// -fmultiversion clones every function but main and that bad targets fail.
+
+extern "C" {
+    float squares(int n);
+    float twice(int n);
+}
+
+// the IR of Source compiled with Options, "" if it did not compile
+static std::string compile(const std::string &Options, const char *Source = "multiversion.c") {
+  return compileIR(Options, Source);
+}
+
+// whether IR defines Name as an ifunc with a resolver
+static bool isIFunc(const std::string &IR, const std::string &Name) {
+  return contains(IR, "\n@" + Name + " = ifunc ") && defines(IR, Name + ".resolver") && !defines(IR, Name);
+}
+
+// whether IR defines clone Name.Target, internal, with +Target on top of Base
+static bool isClone(const std::string &IR, const std::string &Name, const std::string &Target,
+                    std::set<std::string> Base = {}) {
+  Base.insert("+" + Target);
+  return contains(functionHeader(IR, Name + "." + Target), "define internal ") &&
+         targetFeatures(IR, Name + "." + Target) == Base;
+}
+
+int main() {
+  float result = squares(10) + twice(3);
+
+  bool clones = true, global = true;
+#if defined(__x86_64__) && defined(__ELF__)
+  std::string IR = compile("-O2 -ffast-math");
+  std::string Resolver = functionBody(IR, "squares.resolver");
+  clones = isIFunc(IR, "squares") && countCalls(Resolver, "__cpu_indicator_init") == 1 && contains(Resolver, "@__cpu_model") &&
+           contains(functionHeader(IR, "squares.default"), "define internal ") &&
+           targetFeatures(IR, "squares.default").empty() && isClone(IR, "squares", "avx2") &&
+           isClone(IR, "squares", "avx512f") && contains(functionBody(IR, "squares.avx512f"), "<16 x float>") &&
+           defines(IR, "twice") && !isIFunc(IR, "twice");
+  // every function, on top of -mattr's features
+  std::string Main = writeSource("int main() {\n    return 0;\n}\n");
+  IR = compile("-fmultiversion=avx2,default -mattr=+sse4.2", Main.c_str());
+  global = defines(IR, "main") && !contains(IR, " = ifunc ");
+  IR = compile("-fmultiversion=sse4.1,default -mattr=+popcnt");
+  global = global && isIFunc(IR, "twice") && isClone(IR, "twice", "sse4.1", {"+popcnt"}) &&
+           isClone(IR, "squares", "avx2", {"+popcnt"}) && !defines(IR, "squares.sse4.1");
+  remove(Main.c_str());
+#endif
+  std::string Bare = writeSource("[[target_clones]] int f() {\n    return 0;\n}\n");
+  bool bad = compile("-fmultiversion=avx2").empty() && compile("-fmultiversion=avx9,default").empty() &&
+             compile("", Bare.c_str()).empty();
+  remove(Bare.c_str());
+
+  // 285 + 2 * (0 + 1 + 4)
+  if (result == 295.0f && clones && global && bad)
+    std::cout << "PASSED Result: " << result << std::endl;
+  else
+    std::cout << "FAILED Result: " << result << " clones: " << clones << " global: " << global << " bad: " << bad
+              << std::endl;
+}
@@ -0,0 +1,21 @@
+// MiniC program with a loop compiled once per instruction set, the driver
+// checks the clones and the resolver that picks between them
+
+[[target_clones("avx512f", "avx2", "default")]]
+float squares(int n) {
+    int i;
+    float x;
+    float sum;
+    i = 0;
+    sum = 0.0;
+    while (i < n) {
+        x = i;
+        sum = sum + x * x;
+        i = i + 1;
+    }
+    return sum;
+}
+
+float twice(int n) {
+    return squares(n) + squares(n);
+}
@@ -0,0 +1,95 @@
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+
+#include "../../libmccomp.hpp"
+#include "../ir_check.hpp"
+
+// clang++ driver.cpp ../../libmccomp.a `llvm-config --cxxflags --ldflags --system-libs --libs all` -rdynamic -o perf
+//
+// JITs perf.c with CompilerOptions::JITProfiling, checks the perf map names
+// hot_loop, then runs itself under perf record and checks perf report puts
+// the samples in hot_loop. Without perf (or permission to use it, see
+// /proc/sys/kernel/perf_event_paranoid) only the map is checked.
+
+// whether Map has a line for Name, starting at Address
+static bool mapped(const std::string &Map, const std::string &Name, unsigned long long Address) {
+  std::istringstream in(Map);
+  std::string Line;
+  while (std::getline(in, Line)) {
+    unsigned long long Start, Size;
+    char Symbol[256];
+    if (sscanf(Line.c_str(), "%llx %llx %255s", &Start, &Size, Symbol) == 3 && Name == Symbol &&
+        Start == Address && Size > 0)
+      return true;
+  }
+  return false;
+}
+
+int main(int argc, char **argv) {
+  CompilerInstance CI;
+  CompilerOptions Opts;
+  Opts.Output = OutputKind::JIT;
+  Opts.JITProfiling = true;
+  CompileResult R = CI.compileFile("perf.c", Opts);
+  if (!R.Success) {
+    std::cout << "FAILED " << R.Error << std::endl;
+    return 1;
+  }
+  auto Sym = R.JIT->lookup("hot_loop");
+  if (!Sym) {
+    llvm::consumeError(Sym.takeError());
+    std::cout << "FAILED hot_loop not found" << std::endl;
+    return 1;
+  }
+#if LLVM_VERSION_MAJOR >= 15
+  auto HotLoop = Sym->toPtr<int (*)(int)>();
+#else
+  auto HotLoop = (int (*)(int))Sym->getAddress();
+#endif
+
+  std::string Map = "/tmp/perf-" + std::to_string(getpid()) + ".map";
+  bool map = mapped(readFile(Map), "hot_loop", (unsigned long long)HotLoop);
+
+  // long enough for perf to take a few hundred samples
+  int n = 100000000, expected = 0;
+  for (int i = 0; i < n; i++)
+    expected += i % 7;
+  bool result = HotLoop(n) == expected;
+
+  // the run under perf below, which leaves its map for perf report
+  if (getenv("MCCOMP_PERF_CHILD")) {
+    std::cout << (map && result ? "PASSED" : "FAILED") << " pid " << getpid() << std::endl;
+    return 0;
+  }
+  remove(Map.c_str());
+
+  bool samples = true;
+  std::string Note;
+  std::string Data = "/tmp/mccomp-perf-" + std::to_string(getpid()) + ".data", Log = Data + ".log";
+  if (system("perf --version > /dev/null 2>&1") != 0)
+    Note = "perf is not installed, samples not checked";
+  else if (system(("MCCOMP_PERF_CHILD=1 perf record -q -F 999 -o " + Data + " " + argv[0] + " > " + Log + " 2>&1").c_str()) != 0)
+    Note = "perf record failed, samples not checked:\n" + readFile(Log);
+  else {
+    std::string Child = readFile(Log);
+    std::string Report = "perf report -i " + Data + " --stdio --sort sym 2> /dev/null | grep -q hot_loop";
+    samples = Child.find("PASSED") != std::string::npos && system(Report.c_str()) == 0;
+    size_t Pid = Child.find(" pid ");
+    if (Pid != std::string::npos)
+      remove(("/tmp/perf-" + std::to_string(atoi(Child.c_str() + Pid + 5)) + ".map").c_str());
+  }
+  remove(Data.c_str());
+  remove(Log.c_str());
+
+  if (map && result && samples)
+    std::cout << "PASSED " << Note << std::endl;
+  else
+    std::cout << "FAILED map: " << map << " result: " << result << " samples: " << samples << std::endl;
+}
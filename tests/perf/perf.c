@@ -0,0 +1,14 @@
+// MiniC program profiled under perf through the JIT, nearly all of its time
+// is spent in hot_loop
+
+int hot_loop(int n) {
+    int i;
+    int sum;
+    i = 0;
+    sum = 0;
+    while (i < n) {
+        sum = sum + i % 7;
+        i = i + 1;
+    }
+    return sum;
+}
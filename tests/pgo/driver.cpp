@@ -0,0 +1,76 @@
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "../ir_check.hpp"
+
+// ../../mccomp -fprofile-generate pgo.c
+// clang++ driver.cpp output.ll ../../libmccomp-prof.a -lpthread -o pgo
+//
+// Runs pgo_driver in a child process, which writes the profile as it exits,
+// checks the counts in it, then compiles pgo.c again with -fprofile-use and
+// checks the counts made it onto the IR and cold into .text.unlikely.
+
+extern "C" {
+    int pgo_driver(int n);
+}
+
+// the counters of every function in a text profile
+static std::map<std::string, std::vector<unsigned long long>> readCounts(const std::string &Path) {
+  std::map<std::string, std::vector<unsigned long long>> Counts;
+  std::ifstream f(Path);
+  std::string Name, Line;
+  while (std::getline(f, Name)) {
+    if (Name.empty() || Name[0] == '#' || Name[0] == ':')
+      continue;
+    unsigned long long Hash, N;
+    f >> Line >> Line >> Line >> Hash >> Line >> Line >> Line >> N >> Line >> Line >> Line;
+    std::vector<unsigned long long> &C = Counts[Name];
+    C.resize(N);
+    for (auto &c : C)
+      f >> c;
+    std::getline(f, Line);
+  }
+  return Counts;
+}
+
+int main() {
+  std::string Path = tempPath(".proftext");
+  setenv("MCCOMP_PROFILE_FILE", Path.c_str(), 1);
+  pid_t pid = fork();
+  if (pid == 0) {
+    pgo_driver(100);
+    exit(0);
+  }
+  int status;
+  waitpid(pid, &status, 0);
+
+  // entry, then executed and taken for every branch in the order they are
+  // generated: && left and right, if, || left and right, if, and the while
+  // loop's guard and latch
+  auto Counts = readCounts(Path);
+  bool counts = Counts["pgo_driver"] == std::vector<unsigned long long>{1, 1, 1, 100, 99, 1, 0} &&
+                Counts["classify"] == std::vector<unsigned long long>{100, 100, 89, 89, 8, 100, 8, 100, 0, 100, 0, 100, 0} &&
+                Counts["cold"] == std::vector<unsigned long long>{0};
+
+  Compiled Use = compile("-O2 -fprofile-use=" + Path, "pgo.c");
+  bool use = Use.Ok && contains(Use.Output, "function_entry_count") && !branchWeights(Use.Output).empty() &&
+             contains(Use.Output, "ProfileSummary");
+#ifdef __linux__
+  // sections are named for ELF only
+  Use = compile("-O2 -fprofile-use=" + Path + " --emit=obj", "pgo.c");
+  use &= Use.Ok && contains(Use.Output, ".text.unlikely");
+#endif
+  remove(Path.c_str());
+
+  if (counts && use)
+    std::cout << "PASSED Result: " << pgo_driver(100) << std::endl;
+  else
+    std::cout << "FAILED counts: " << counts << " use: " << use << std::endl;
+}
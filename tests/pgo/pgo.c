@@ -0,0 +1,33 @@
+// MiniC program compiled with -fprofile-generate, the driver checks the counts
+// it records and that -fprofile-use puts them back on the code
+
+int cold(int n) {
+    return n * 2;
+}
+
+int classify(int n) {
+    int k;
+    k = 0;
+    if (n > 10 && n % 10 == 0) {
+        k = 1;
+    }
+    if (n < 0 || n > 1000) {
+        k = 2;
+    }
+    return k;
+}
+
+int pgo_driver(int n) {
+    int i;
+    int s;
+    i = 0;
+    s = 0;
+    while (i < n) {
+        s = s + classify(i);
+        i = i + 1;
+    }
+    if (n < 0) {
+        s = cold(n);
+    }
+    return s;
+}
@@ -0,0 +1,39 @@
+#include <iostream>
+#include <string>
+
+#include "../ir_check.hpp"
+
+// ../../mccomp ./pragmas.c
+// clang++ driver.cpp output.ll -o pragmas
+//
+// Runs pragmas_driver, then compiles pragmas.c again at -O2 and checks each
+// loop was vectorized and unrolled as its pragmas say, and that a count too
+// big for an unsigned is an error.
+
+extern "C" {
+    int pragmas_driver(int n);
+}
+
+int main() {
+  int result = pragmas_driver(1000);
+
+  std::string IR = compileIR("-O2", "pragmas.c");
+  std::string Scalar = functionBody(IR, "scalar_sum"), Vector = functionBody(IR, "vector_sum"),
+              Unrolled = functionBody(IR, "unrolled_sum");
+  bool scalar = !Scalar.empty() && !contains(Scalar, " x i32>") && countInstructions(Scalar, "srem") == 1;
+  bool vector = contains(Vector, "<8 x i32>");
+  bool unrolled = countInstructions(Unrolled, "srem") == 4;
+
+  // a count that doesn't fit is reported like any other bad count
+  std::string Source = writeSource("int f(int n) {\n  #pragma unroll(99999999999999999999)\n  while (n > 0) n = n - 1;\n  return n;\n}\n");
+  Compiled Big = compile("", Source);
+  bool rejected = !Big.Ok && contains(Big.Out, "Expected a positive integer in pragma");
+  remove(Source.c_str());
+
+  // (i * i) % 7 repeats 0 1 4 2 2 4 1, 14 a week, 142 weeks and 0 1 4 2 2 4
+  if (result == 3 * 2001 && scalar && vector && unrolled && rejected)
+    std::cout << "PASSED Result: " << result << std::endl;
+  else
+    std::cout << "FAILED Result: " << result << " scalar: " << scalar << " vector: " << vector
+              << " unrolled: " << unrolled << " rejected: " << rejected << std::endl;
+}
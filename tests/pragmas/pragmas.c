@@ -0,0 +1,54 @@
+// MiniC program with loop pragmas, the driver checks they reach the
+// unroller and the vectorizer
+
+// never vectorized or unrolled
+int scalar_sum(int n) {
+    int i;
+    int sum;
+    i = 0;
+    sum = 0;
+    #pragma vectorize(1)
+    #pragma unroll(1)
+    while (i < n) {
+        sum = sum + (i * i) % 7;
+        i = i + 1;
+    }
+    return sum;
+}
+
+// vectorized 8 wide, twice over
+int vector_sum(int n) {
+    int i;
+    int sum;
+    i = 0;
+    sum = 0;
+    #pragma vectorize(8)
+    #pragma interleave(2)
+    while (i < n) {
+        sum = sum + (i * i) % 7;
+        i = i + 1;
+    }
+    return sum;
+}
+
+// unrolled 4 times
+int unrolled_sum(int n) {
+    int i;
+    int sum;
+    i = 0;
+    sum = 0;
+    #pragma unroll(4)
+    while (i < n && sum >= 0) {
+        sum = sum + (i * i) % 7;
+        i = i + 1;
+    }
+    return sum;
+}
+
+int pragmas_driver(int n) {
+    // the guard skips the loop
+    while (n < 0) {
+        n = n + 1;
+    }
+    return scalar_sum(n) + vector_sum(n) + unrolled_sum(n);
+}
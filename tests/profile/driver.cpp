@@ -0,0 +1,80 @@
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "../../profile.hpp"
+
+// ../../mccomp -finstrument=profile profile.c
+// clang++ driver.cpp output.ll ../../libmccomp-prof.a -lpthread -o profile
+//
+// Runs profile_driver on two threads in a child process, which writes the
+// profile as it exits, then checks the calls, times and edges in it.
+
+extern "C" {
+    int profile_driver(int n);
+}
+
+static unsigned long long calls(const Profile &P, const std::string &Name) {
+  auto It = P.Functions.find(Name);
+  return It == P.Functions.end() ? 0 : It->second.Calls;
+}
+
+static unsigned long long edge(const Profile &P, const std::string &Caller, const std::string &Callee) {
+  for (auto &E : P.Edges)
+    if (E.Caller == Caller && E.Callee == Callee)
+      return E.Calls;
+  return 0;
+}
+
+int main() {
+  std::string Path = "/tmp/mccomp-prof-test-" + std::to_string(getpid()) + ".out";
+  setenv("MCCOMP_PROF_FILE", Path.c_str(), 1);
+  pid_t pid = fork();
+  if (pid == 0) {
+    std::thread t([] { profile_driver(100000); });
+    profile_driver(100000);
+    t.join();
+    exit(0);
+  }
+  int status;
+  waitpid(pid, &status, 0);
+
+  Profile P;
+  std::string Error = readProfile(Path, P);
+  remove(Path.c_str());
+  if (!Error.empty()) {
+    std::cout << "FAILED " << Error << std::endl;
+    return 1;
+  }
+
+  // fib(10) makes 177 calls, 176 of them from itself
+  bool counts = P.Threads == 2 && calls(P, "profile_driver") == 2 && calls(P, "middle") == 2 &&
+                calls(P, "leaf") == 6 && calls(P, "fib") == 354;
+  bool edges = edge(P, ProfileExternal, "profile_driver") == 2 && edge(P, "profile_driver", "middle") == 2 &&
+               edge(P, "profile_driver", "leaf") == 2 && edge(P, "middle", "leaf") == 4 &&
+               edge(P, "profile_driver", "fib") == 2 && edge(P, "fib", "fib") == 352;
+
+  // all the time in profile_driver is spent in exactly one function, and leaf
+  // calls nothing
+  double Exclusive = 0;
+  bool times = true;
+  for (auto &KV : P.Functions) {
+    Exclusive += KV.second.Exclusive;
+    times &= KV.second.Inclusive > 0 && KV.second.Exclusive <= KV.second.Inclusive + 1;
+  }
+  const FunctionProfile &Root = P.Functions["profile_driver"], &Leaf = P.Functions["leaf"];
+  times &= std::fabs(Exclusive - Root.Inclusive) <= 0.01 * Root.Inclusive + 10 &&
+           std::fabs(Leaf.Exclusive - Leaf.Inclusive) <= 0.01 * Leaf.Inclusive + 10 &&
+           Leaf.Inclusive > 0.5 * Root.Inclusive && P.Time > 0;
+
+  if (counts && edges && times)
+    std::cout << "PASSED Result: " << calls(P, "fib") << std::endl;
+  else
+    std::cout << "FAILED counts: " << counts << " edges: " << edges << " times: " << times << std::endl;
+}
@@ -0,0 +1,31 @@
+// MiniC program compiled with -finstrument=profile, the driver checks the
+// calls and time the profiling runtime attributes to each function
+
+int leaf(int n) {
+    int i;
+    int s;
+    i = 0;
+    s = 0;
+    while (i < n) {
+        s = s + i % 3;
+        i = i + 1;
+    }
+    return s;
+}
+
+int middle(int n) {
+    return leaf(n) + leaf(n);
+}
+
+int fib(int n) {
+    if (n < 2) {
+        return n;
+    }
+    return fib(n - 1) + fib(n - 2);
+}
+
+int profile_driver(int n) {
+    int s;
+    s = middle(n) + leaf(n);
+    return s + fib(10);
+}
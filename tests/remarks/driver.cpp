@@ -0,0 +1,58 @@
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+#include "../ir_check.hpp"
+
+// ../../mccomp ./remarks.c
+// clang++ driver.cpp output.ll -o remarks
+//
+// Compiles remarks.c again with -Rpass and -fsave-optimization-record and
+// checks the remarks point at its source lines, without any debug info, also
+// with --stream=1, which generates each function in a context of its own.
+
+#ifdef _WIN32
+#define DLLEXPORT __declspec(dllexport)
+#else
+#define DLLEXPORT
+#endif
+
+extern "C" DLLEXPORT int print_int(int X) {
+  fprintf(stderr, "%d\n", X);
+  return 0;
+}
+
+extern "C" {
+    int remarks_driver(int n);
+}
+
+int main() {
+  int result = remarks_driver(4);
+
+  Compiled C = compile("-O2 -Rpass=inline -Rpass-missed=loop-vectorize", "remarks.c");
+  bool remarks = contains(C.Out, "remarks.c:16:17: remark: 'square' inlined into 'remarks_driver'") &&
+                 contains(C.Out, "remarks.c:15:5: remark: loop not vectorized [-Rpass-missed=loop-vectorize]") &&
+                 !contains(C.Out, "[-Rpass-analysis=") && !contains(C.Output, "DILocalVariable");
+
+  std::string Record = tempPath(".opt.yaml");
+  compile("-O2 -fsave-optimization-record -foptimization-record-file=" + Record, "remarks.c");
+  std::string YAML = readFile(Record);
+  bool record = contains(YAML, "--- !Passed\nPass:            inline\n") &&
+                contains(YAML, "DebugLoc:        { File: remarks.c, Line: 16, Column: 17 }");
+  remove(Record.c_str());
+
+  // the loop is in the second chunk's context
+  Compiled S = compile("--stream=1 -O2 -Rpass-missed=loop-vectorize", "remarks.c");
+  compile("--stream=1 -O2 -fsave-optimization-record -foptimization-record-file=" + Record, "remarks.c");
+  YAML = readFile(Record);
+  bool stream = S.Ok && contains(S.Out, "remarks.c:15:5: remark: loop not vectorized [-Rpass-missed=loop-vectorize]") &&
+                contains(YAML, "--- !Missed\nPass:            loop-vectorize\n") &&
+                contains(YAML, "DebugLoc:        { File: remarks.c, Line: 15, Column: 5 }");
+  remove(Record.c_str());
+
+  if (result == 14 && remarks && record && stream)
+    std::cout << "PASSED Result: " << result << std::endl;
+  else
+    std::cout << "FAILED Result: " << result << " remarks: " << remarks << " record: " << record
+              << " stream: " << stream << std::endl;
+}
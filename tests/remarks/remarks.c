@@ -0,0 +1,21 @@
+// MiniC program whose optimisation the driver reports with -Rpass, the
+// remarks must point at the lines and columns below
+
+extern int print_int(int X);
+
+int square(int x) {
+    return x * x;
+}
+
+int remarks_driver(int n) {
+    int i;
+    int s;
+    i = 0;
+    s = 0;
+    while (i < n) {
+        s = s + square(i);
+        print_int(s);
+        i = i + 1;
+    }
+    return s;
+}
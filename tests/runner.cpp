@@ -0,0 +1,370 @@
+#include <dirent.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../libmccomp.hpp"
+
+//===----------------------------------------------------------------------===//
+// Parallel test runner
+//===----------------------------------------------------------------------===//
+//
+// Runs every test in tests/, any directory with a driver.cpp, on all cores:
+//  - compiles the MiniC program (<name>.c) in process with a CompilerInstance
+//    of its own, to an object file
+//  - links it against the driver, compiled once and kept until driver.cpp
+//    changes
+//  - runs the binary in the test directory, with a timeout, and checks it
+//    printed PASSED
+//
+//   make tests/runner
+//   tests/runner [--jobs=n] [--timeout=s] [--cxx=clang++] [--build-dir=dir] [test ...]
+//
+// Objects and binaries go to --build-dir (test-build by default), not into the
+// test directories. Each test's compile, link and run time is printed as it
+// finishes; the exit status is 0 only if every test passed.
+
+struct TestConfig
+{
+  std::string Name, Dir, Source;
+  bool Skip = false;
+  std::string SkipReason;
+  bool ExpectTimeout = false;     // passes if it is still running when the timeout hits
+  double Timeout;                 // seconds
+  unsigned Stream = 0;            // compile with --stream=n, linking every chunk
+  bool InstrumentProfile = false; // compile with -finstrument=profile
+  bool ProfileGenerate = false;   // compile with -fprofile-generate
+  std::string DriverFlags, LinkFlags;
+};
+
+struct RunnerOptions
+{
+  std::string Tests = "tests", BuildDir = "test-build", CXX = "clang++";
+  unsigned Jobs = std::max(1u, std::thread::hardware_concurrency());
+  double Timeout = 10;
+  std::vector<std::string> Only;
+};
+
+static std::string absolute(const std::string &Path)
+{
+  char *p = realpath(Path.c_str(), nullptr);
+  std::string out = p ? p : Path;
+  free(p);
+  return out;
+}
+
+// the tests that can't run like the others
+static void configure(TestConfig &T, const RunnerOptions &Opts)
+{
+  if (T.Name == "implicit")
+  {
+    T.Skip = true;
+    T.SkipReason = "implicit narrowing of arguments is not supported";
+  }
+  else if (T.Name == "infinite")
+  {
+    // never returns, it passes if it compiles and is still looping
+    T.ExpectTimeout = true;
+    T.Timeout = std::min(Opts.Timeout, 1.0);
+  }
+  else if (T.Name == "stream")
+  {
+    // compiled as tests.sh always has, with --stream=1; the driver runs ../../mccomp itself
+    T.Stream = 1;
+  }
+  else if (T.Name == "profile")
+  {
+    // instrumented, linked against the profiling runtime
+    T.InstrumentProfile = true;
+    T.LinkFlags = absolute(Opts.Tests + "/../libmccomp-prof.a") + " -lpthread";
+  }
+  else if (T.Name == "pgo")
+  {
+    // counting branches, linked against the profiling runtime; the driver runs ../../mccomp itself
+    T.ProfileGenerate = true;
+    T.LinkFlags = absolute(Opts.Tests + "/../libmccomp-prof.a") + " -lpthread";
+  }
+  else if (T.Name == "library" || T.Name == "perf")
+  {
+    // programs using libmccomp, <name>.c is compiled by the driver itself
+    T.Source.clear();
+    T.DriverFlags = "`llvm-config --cxxflags`";
+    T.LinkFlags = absolute(Opts.Tests + "/../libmccomp.a") + " `llvm-config --ldflags --system-libs --libs all` -rdynamic";
+  }
+}
+
+struct TestResult
+{
+  bool Passed = false, Skipped = false;
+  std::string Status, Detail;
+  double Compile = 0, Link = 0, Run = 0; // seconds
+};
+
+using Clock = std::chrono::steady_clock;
+
+static double since(Clock::time_point Start)
+{
+  return std::chrono::duration<double>(Clock::now() - Start).count();
+}
+
+static bool newer(const std::string &A, const std::string &B)
+{
+  struct stat a, b;
+  return stat(A.c_str(), &a) == 0 && (stat(B.c_str(), &b) != 0 || a.st_mtime >= b.st_mtime);
+}
+
+static std::string readFile(const std::string &Path)
+{
+  std::ifstream in(Path, std::ios::binary);
+  std::stringstream ss;
+  ss << in.rdbuf();
+  return ss.str();
+}
+
+// run Command with /bin/sh in Dir, output to Log, killing it after Timeout
+// seconds (0 is none). Returns the exit status, -1 if it timed out, or 128 +
+// the signal that killed it
+static int run(const std::string &Command, const std::string &Dir, const std::string &Log, double Timeout)
+{
+  pid_t pid = fork();
+  if (pid == 0)
+  {
+    // its own process group, so a timeout kills everything it started
+    setpgid(0, 0);
+    int fd = open(Log.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || chdir(Dir.c_str()) != 0)
+      _exit(127);
+    dup2(fd, 1);
+    dup2(fd, 2);
+    execl("/bin/sh", "sh", "-c", Command.c_str(), (char *)NULL);
+    _exit(127);
+  }
+  if (pid < 0)
+    return 127;
+  Clock::time_point Start = Clock::now();
+  int status;
+  while (waitpid(pid, &status, WNOHANG) == 0)
+  {
+    if (Timeout > 0 && since(Start) > Timeout)
+    {
+      kill(-pid, SIGKILL);
+      waitpid(pid, &status, 0);
+      return -1;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+  return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+}
+
+static TestResult runTest(const TestConfig &T, const RunnerOptions &Opts)
+{
+  TestResult R;
+  if (T.Skip)
+  {
+    R.Skipped = true;
+    R.Status = "SKIP";
+    R.Detail = T.SkipReason;
+    return R;
+  }
+  std::string Build = absolute(Opts.BuildDir) + "/" + T.Name;
+  mkdir(Build.c_str(), 0755);
+  std::string Log = Build + "/log.txt", Driver = Build + "/driver.o", Binary = Build + "/" + T.Name;
+
+  // the MiniC program, in process
+  Clock::time_point Start = Clock::now();
+  std::vector<std::string> Objects;
+  if (!T.Source.empty())
+  {
+    CompilerInstance CI;
+    CompilerOptions CO;
+    CO.Output = OutputKind::Object;
+    CO.Stream = T.Stream;
+    CO.InstrumentProfile = T.InstrumentProfile;
+    CO.ProfileGenerate = T.ProfileGenerate;
+    CO.OutputFile = Build + "/output.o";
+    CompileResult C = CI.compileFile(T.Source, CO);
+    if (!C.Success)
+    {
+      R.Status = "FAIL";
+      R.Detail = "compile error: " + C.Error;
+      return R;
+    }
+    if (T.Stream)
+      Objects = C.OutputFiles;
+    else
+    {
+      std::ofstream out(CO.OutputFile, std::ios::binary);
+      out << C.Buffer;
+      Objects.push_back(CO.OutputFile);
+    }
+  }
+  R.Compile = since(Start);
+
+  // the driver, compiled once, then link
+  Start = Clock::now();
+  std::string DriverSource = absolute(T.Dir) + "/driver.cpp";
+  if (newer(DriverSource, Driver) &&
+      run(Opts.CXX + " -std=c++17 -O1 -w -c " + DriverSource + " " + T.DriverFlags + " -o " + Driver, T.Dir, Log, 0) != 0)
+  {
+    remove(Driver.c_str());
+    R.Status = "FAIL";
+    R.Detail = "driver does not compile:\n" + readFile(Log);
+    return R;
+  }
+  std::string Link = Opts.CXX + " " + Driver;
+  for (auto &o : Objects)
+    Link += " " + o;
+  if (run(Link + " " + T.LinkFlags + " -o " + Binary, T.Dir, Log, 0) != 0)
+  {
+    R.Status = "FAIL";
+    R.Detail = "link error:\n" + readFile(Log);
+    return R;
+  }
+  R.Link = since(Start);
+
+  Start = Clock::now();
+  int status = run(Binary, T.Dir, Log, T.Timeout);
+  R.Run = since(Start);
+  std::string Output = readFile(Log);
+  if (T.ExpectTimeout)
+  {
+    R.Passed = status == -1;
+    R.Detail = R.Passed ? "" : "expected to run until the timeout, exited with status " + std::to_string(status);
+  }
+  else if (status == -1)
+    R.Detail = "timed out after " + std::to_string(int(T.Timeout)) + " s";
+  else if (status >= 128)
+    R.Detail = "crashed with " + std::string(strsignal(status - 128));
+  else if (Output.find("PASSED") == std::string::npos)
+    R.Detail = "did not pass:\n" + Output;
+  else
+    R.Passed = true;
+  R.Status = R.Passed ? "PASS" : "FAIL";
+  return R;
+}
+
+// every directory in Tests with a driver.cpp, by name
+static std::vector<TestConfig> discover(const RunnerOptions &Opts)
+{
+  std::vector<TestConfig> Found;
+  DIR *d = opendir(Opts.Tests.c_str());
+  if (!d)
+    return Found;
+  while (struct dirent *e = readdir(d))
+  {
+    TestConfig T;
+    T.Name = e->d_name;
+    T.Dir = Opts.Tests + "/" + T.Name;
+    T.Source = T.Dir + "/" + T.Name + ".c";
+    T.Timeout = Opts.Timeout;
+    struct stat s;
+    if (T.Name[0] == '.' || stat((T.Dir + "/driver.cpp").c_str(), &s) != 0 || stat(T.Source.c_str(), &s) != 0)
+      continue;
+    if (!Opts.Only.empty() && std::find(Opts.Only.begin(), Opts.Only.end(), T.Name) == Opts.Only.end())
+      continue;
+    configure(T, Opts);
+    Found.push_back(T);
+  }
+  closedir(d);
+  std::sort(Found.begin(), Found.end(), [](const TestConfig &A, const TestConfig &B)
+            { return A.Name < B.Name; });
+  return Found;
+}
+
+static bool option(const std::string &arg, const char *Name, std::string &Value)
+{
+  std::string prefix = std::string(Name) + "=";
+  if (arg.compare(0, prefix.size(), prefix) != 0)
+    return false;
+  Value = arg.substr(prefix.size());
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  RunnerOptions Opts;
+  for (int i = 1; i < argc; i++)
+  {
+    std::string arg = argv[i], value;
+    if (option(arg, "--jobs", value))
+      Opts.Jobs = std::max(1ul, std::stoul(value));
+    else if (option(arg, "--timeout", value))
+      Opts.Timeout = std::stod(value);
+    else if (option(arg, "--cxx", value))
+      Opts.CXX = value;
+    else if (option(arg, "--build-dir", value))
+      Opts.BuildDir = value;
+    else if (option(arg, "--tests", value))
+      Opts.Tests = value;
+    else if (arg[0] == '-')
+    {
+      std::cerr << "Usage: runner [--jobs=n] [--timeout=s] [--cxx=clang++] [--build-dir=dir] [--tests=dir] [test ...]\n";
+      return 1;
+    }
+    else
+      Opts.Only.push_back(arg);
+  }
+
+  std::vector<TestConfig> Tests = discover(Opts);
+  if (Tests.empty())
+  {
+    std::cerr << "No tests found in " << Opts.Tests << "\n";
+    return 1;
+  }
+  mkdir(Opts.BuildDir.c_str(), 0755);
+
+  // the target is set up once, before the workers race to do it
+  CompilerInstance().initializeTarget();
+
+  Clock::time_point Start = Clock::now();
+  std::atomic<size_t> Next{0};
+  std::vector<TestResult> Results(Tests.size());
+  std::mutex Print;
+  std::vector<std::thread> Workers;
+  for (unsigned w = 0; w < std::min<size_t>(Opts.Jobs, Tests.size()); w++)
+    Workers.emplace_back([&]
+                         {
+                           for (size_t i; (i = Next++) < Tests.size();)
+                           {
+                             Results[i] = runTest(Tests[i], Opts);
+                             const TestResult &R = Results[i];
+                             std::lock_guard<std::mutex> Lock(Print);
+                             if (R.Skipped)
+                               fprintf(stdout, "%s %-16s %s\n", R.Status.c_str(), Tests[i].Name.c_str(), R.Detail.c_str());
+                             else
+                               fprintf(stdout, "%s %-16s compile %7.1f ms   link %7.1f ms   run %7.1f ms\n", R.Status.c_str(),
+                                       Tests[i].Name.c_str(), R.Compile * 1e3, R.Link * 1e3, R.Run * 1e3);
+                             if (!R.Passed && !R.Skipped)
+                               fprintf(stdout, "     %s\n", R.Detail.c_str());
+                             fflush(stdout);
+                           }
+                         });
+  for (auto &w : Workers)
+    w.join();
+
+  unsigned Passed = 0, Failed = 0, Skipped = 0;
+  for (auto &R : Results)
+  {
+    Passed += R.Passed;
+    Skipped += R.Skipped;
+    Failed += !R.Passed && !R.Skipped;
+  }
+  fprintf(stdout, "\n%u passed, %u failed, %u skipped in %.2f s on %u jobs\n", Passed, Failed, Skipped, since(Start),
+          std::min<unsigned>(Opts.Jobs, Tests.size()));
+  return Failed == 0 ? 0 : 1;
+}
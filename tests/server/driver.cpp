@@ -0,0 +1,119 @@
+#include <climits>
+#include <csignal>
+#include <cstring>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <sys/wait.h>
+#include <vector>
+
+#include "../../protocol.hpp"
+#include "../ir_check.hpp"
+
+// ../../mccomp ./server.c
+// clang++ driver.cpp output.ll -o server
+//
+// Starts a compile server and sends it requests it must refuse before
+// allocating for them: argc that isn't a small number, a frame longer than a
+// whole request may be and frames that together are, then a good request, and
+// has mccomp-client compile through it with --stream.
+
+#ifdef _WIN32
+#define DLLEXPORT __declspec(dllexport)
+#else
+#define DLLEXPORT
+#endif
+
+extern "C" DLLEXPORT int print_int(int X) {
+  fprintf(stderr, "%d\n", X);
+  return 0;
+}
+
+extern "C" {
+    int server_driver(int n);
+}
+
+// a connection to the server at Socket, waiting for it to start listening
+static int connectTo(const std::string &Socket) {
+  sockaddr_un addr = socketAddress(Socket);
+  for (int i = 0; i < 500; i++) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (connect(fd, (sockaddr *)&addr, sizeof(addr)) == 0)
+      return fd;
+    close(fd);
+    usleep(10000);
+  }
+  return -1;
+}
+
+// the exit code and stderr the server replied with
+static std::string reply(int fd, std::string &Err) {
+  std::string rc, out, output;
+  if (!recvFrame(fd, rc) || !recvFrame(fd, out) || !recvFrame(fd, Err) || !recvFrame(fd, output))
+    rc = "no reply";
+  close(fd);
+  return rc;
+}
+
+// whether a request whose frames are Frames, followed by a frame that claims
+// to be Length bytes long but never sends them, is refused with Message
+static bool refused(const std::string &Socket, const std::vector<std::string> &Frames, uint32_t Length,
+                    const std::string &Message) {
+  int fd = connectTo(Socket);
+  bool sent = fd >= 0;
+  for (auto &F : Frames)
+    sent = sent && sendFrame(fd, F);
+  if (Length)
+    sent = sent && writeAll(fd, (const char *)&Length, sizeof(Length));
+  std::string Err;
+  return sent && reply(fd, Err) == "1" && contains(Err, "Invalid compile server request: " + Message);
+}
+
+int main() {
+  int result = server_driver(10);
+
+  std::string Socket = tempPath(".sock");
+  pid_t server = fork();
+  if (server == 0) {
+    freopen("/dev/null", "w", stdout);
+    execl("../../mccomp", "mccomp", ("--serve=" + Socket).c_str(), "--workers=1", (char *)nullptr);
+    _exit(127);
+  }
+
+  char cwd[PATH_MAX];
+  getcwd(cwd, sizeof(cwd));
+  std::string Limit = "longer than " + std::to_string(MaxRequestSize) + " bytes";
+  bool argc = refused(Socket, {cwd, "-5"}, 0, "argc \"-5\"") &&
+              refused(Socket, {cwd, "99999999999"}, 0, "argc \"99999999999\"") &&
+              refused(Socket, {cwd, "abc"}, 0, "argc \"abc\"");
+  // the last is one byte more than the request may still hold
+  bool size = refused(Socket, {cwd, "1"}, 0xfffffff0, Limit) &&
+              refused(Socket, {}, MaxRequestSize + 1, Limit) &&
+              refused(Socket, {cwd, "2", "server.c"}, MaxRequestSize - strlen(cwd) - 9 + 1, Limit);
+
+  // and a request it can serve still compiles
+  int fd = connectTo(Socket);
+  std::string rc = "no connection", Err;
+  if (fd >= 0 && sendFrame(fd, cwd) && sendFrame(fd, "1") && sendFrame(fd, "server.c") &&
+      sendFrame(fd, readFile("server.c")))
+    rc = reply(fd, Err);
+  bool compiled = rc == "0";
+
+  // the client leaves -o alone when --stream wrote chunk files instead
+  setenv("MCCOMP_SERVER", Socket.c_str(), 1);
+  std::string Stem = tempPath(""), Output = Stem + ".ll";
+  std::ofstream(Output) << "kept\n";
+  bool client = system(("../../mccomp-client --stream=1 -o " + Output + " server.c").c_str()) == 0 &&
+                readFile(Output) == "kept\n" && contains(readFile(Stem + ".0.ll"), "define i32 @server_driver(");
+  remove(Output.c_str());
+  remove((Stem + ".0.ll").c_str());
+
+  kill(server, SIGTERM);
+  waitpid(server, nullptr, 0);
+
+  if (result == 55 && argc && size && compiled && client)
+    std::cout << "PASSED Result: " << result << std::endl;
+  else
+    std::cout << "FAILED Result: " << result << " argc: " << argc << " size: " << size
+              << " compiled: " << compiled << " client: " << client << " " << Err << std::endl;
+}
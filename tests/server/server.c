@@ -0,0 +1,16 @@
+// MiniC program the driver also sends to a compile server, mccomp --serve
+
+extern int print_int(int X);
+
+int server_driver(int n) {
+    int i;
+    int s;
+    i = 1;
+    s = 0;
+    while (i <= n) {
+        s = s + i;
+        i = i + 1;
+    }
+    print_int(s);
+    return s;
+}
@@ -0,0 +1,70 @@
+#include <iostream>
+#include <cstdio>
+#include <string>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// ../../mccomp --stream=1 ./stream.c
+// clang++ driver.cpp output.*.ll -o stream
+
+#ifdef _WIN32
+#define DLLEXPORT __declspec(dllexport)
+#else
+#define DLLEXPORT
+#endif
+
+extern "C" DLLEXPORT int print_int(int X) {
+  fprintf(stderr, "%d\n", X);
+  return 0;
+}
+
+extern "C" DLLEXPORT float print_float(float X) {
+  fprintf(stderr, "%f\n", X);
+  return 0;
+}
+
+extern "C" {
+    int stream_driver(int n);
+}
+
+// peak RSS in KB of mccomp --stream compiling a generated program of n functions
+static long peakRSS(int n) {
+  FILE *f = fopen("generated.c", "w");
+  fprintf(f, "extern int print_int(int X);\n");
+  for (int i = 0; i < n; i++)
+    fprintf(f, "int f%d(int a) { int c; c = a * %d; while (c > 10) { c = c - 3; if (c > 15) { c = c + 1; } } return c + f%d(a); }\n",
+            i, i, i > 0 ? i - 1 : 0);
+  fclose(f);
+
+  pid_t pid = fork();
+  if (pid == 0) {
+    freopen("/dev/null", "w", stdout);
+    execl("../../mccomp", "mccomp", "--stream", "-o", "generated.ll", "generated.c", (char *)NULL);
+    _exit(127);
+  }
+  int status;
+  struct rusage usage;
+  if (wait4(pid, &status, 0, &usage) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    return -1;
+  system("rm -f generated.c generated.*.ll");
+#ifdef __APPLE__
+  return usage.ru_maxrss / 1024; // bytes on macOS
+#else
+  return usage.ru_maxrss;
+#endif
+}
+
+int main() {
+  int result = stream_driver(10);
+
+  // a program four times the size must not need much more memory
+  long small = peakRSS(5000);
+  long large = peakRSS(20000);
+  std::cout << "Peak RSS: " << small << " KB for 5000 functions, " << large << " KB for 20000" << std::endl;
+
+  if (result == 396 && small > 0 && large > 0 && large < small * 3 / 2)
+    std::cout << "PASSED Result: " << result << std::endl;
+  else
+    std::cout << "FALIED Result: " << result << std::endl;
+}
@@ -0,0 +1,31 @@
+// MiniC program compiled one function at a time with --stream=1
+
+extern int print_int(int X);
+
+int calls;
+
+int square(int x) {
+    calls = calls + 1;
+    return x * x;
+}
+
+float half(float x) {
+    calls = calls + 1;
+    return x / 2.0;
+}
+
+int stream_driver(int n) {
+    int i;
+    int sum;
+    i = 1;
+    sum = 0;
+    while (i <= n) {
+        sum = sum + square(i);
+        i = i + 1;
+    }
+    if (half(4.0) == 2.0) {
+        sum = sum + calls;
+    }
+    print_int(calls);
+    return sum;
+}
@@ -0,0 +1,48 @@
+#include <iostream>
+#include <string>
+
+#include "../ir_check.hpp"
+
+// ../../mccomp ./target.c
+// clang++ driver.cpp output.ll -o target
+//
+// Runs squares, then compiles target.c again for the host's CPU and for
+// others and checks the functions carry the CPU and its features and the loop
+// is vectorised as wide as the CPU's vectors.
+
+extern "C" {
+    float squares(int n);
+}
+
+// the IR of target.c compiled with Options, "" if it did not compile
+static std::string compile(const std::string &Options) {
+  return compileIR(Options, "target.c");
+}
+
+int main() {
+  float result = squares(10);
+
+  std::string Generic = compile("-O2 -ffast-math");
+  bool generic = defines(Generic, "squares") && !hasAttribute(Generic, "squares", "target-cpu") &&
+                 !contains(Generic, "<8 x float>");
+  std::string IR = compile("-march=native");
+  bool native = contains(IR, "\ntarget triple = ") && !attributeValue(IR, "squares", "target-cpu").empty() &&
+                !targetFeatures(IR, "squares").empty();
+  bool bogus = compile("-mcpu=bogus").empty();
+  bool wide = true;
+#if defined(__x86_64__)
+  // SSE's 4 floats by default, AVX2's 8 on skylake, unless AVX is turned off
+  wide = contains(functionBody(Generic, "squares"), "<4 x float>");
+  IR = compile("-O2 -ffast-math -mcpu=skylake");
+  wide &= contains(functionBody(IR, "squares"), "<8 x float>") && attributeValue(IR, "squares", "target-cpu") == "skylake";
+  IR = compile("-O2 -ffast-math -mcpu=skylake -mattr=-avx");
+  wide &= !contains(functionBody(IR, "squares"), "<8 x float>") && targetFeatures(IR, "squares").count("-avx") == 1;
+#endif
+
+  // 0 + 1 + 4 + ... + 81
+  if (result == 285.0f && generic && native && bogus && wide)
+    std::cout << "PASSED Result: " << result << std::endl;
+  else
+    std::cout << "FAILED Result: " << result << " generic: " << generic << " native: " << native
+              << " bogus: " << bogus << " wide: " << wide << std::endl;
+}
@@ -0,0 +1,16 @@
+// MiniC program with a loop to vectorise, the driver checks how wide the
+// vectors are for each CPU it is compiled for
+
+float squares(int n) {
+    int i;
+    float x;
+    float sum;
+    i = 0;
+    sum = 0.0;
+    while (i < n) {
+        x = i;
+        sum = sum + x * x;
+        i = i + 1;
+    }
+    return sum;
+}
@@ -0,0 +1,115 @@
+#ifndef TIMING_HPP
+#define TIMING_HPP
+
+#include <map>
+#include <memory>
+#include <string>
+
+#include "llvm/IR/PassTimingInfo.h"
+#include "llvm/Support/TimeProfiler.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "stats.hpp"
+#include "token.hpp"
+
+//===----------------------------------------------------------------------===//
+// Compile time reporting
+//===----------------------------------------------------------------------===//
+//
+// -ftime-report times every phase of a compile (lexing, parsing, AST dump,
+// code generation, IR verification, optimisation and emission) with a Timer
+// in a "Compiler phases" TimerGroup, and every optimisation pass with a
+// TimePassesHandler. The tables, with wall, user and system time, are handed
+// back in CompileResult::TimeReport; the command line prints them to stderr.
+// User and system time are those of the whole process.
+//
+// -ftime-trace records the same phases, the code generation of every function
+// and every pass run over it with TimeTraceScopes, and writes them out as a
+// Chrome trace event file (chrome://tracing or https://ui.perfetto.dev). With
+// --pipeline the lexer and parser threads get their own tracks. Spans shorter
+// than -ftime-trace-granularity (500us by default) are dropped. LLVM's trace
+// profiler keeps the spans of finished threads process wide, so only trace one
+// compile at a time.
+//
+// With --pipeline and --stream lexing and parsing overlap code generation and
+// are only traced, not timed. Otherwise the input is lexed in full before it
+// is parsed (see lexAll()) so the two can be told apart, here and in --stats.
+
+struct PhaseTimers
+{
+  std::string Report;
+  raw_string_ostream ReportStream{Report};
+  TimerGroup Phases{"mccomp", "Compiler phases"};
+  std::map<std::string, std::unique_ptr<Timer>> Timers;
+  TimePassesHandler Passes{true};
+
+  Timer &get(const char *Name, const char *Description)
+  {
+    std::unique_ptr<Timer> &T = Timers[Name];
+    if (!T)
+      T = std::make_unique<Timer>(Name, Description, Phases);
+    return *T;
+  }
+
+  // the phase and pass tables for everything timed so far
+  std::string print()
+  {
+    Phases.print(ReportStream, true);
+    Passes.setOutStream(ReportStream);
+    Passes.print();
+    return ReportStream.str();
+  }
+};
+
+// times and traces one phase of the compile while it is in scope, and counts
+// its heap allocations for --stats (see stats.hpp). Phases must not nest
+class PhaseScope
+{
+  Timer *T = nullptr;
+  TimeTraceScope Trace;
+  const char *Description;
+  unsigned long long Allocations, Bytes;
+
+public:
+  PhaseScope(const char *Name, const char *Description) : Trace(Description), Description(Description)
+  {
+    if (CS->Timers)
+    {
+      T = &CS->Timers->get(Name, Description);
+      T->startTimer();
+    }
+    Allocations = TheHeapCounters.Allocations.load(std::memory_order_relaxed);
+    Bytes = TheHeapCounters.Allocated.load(std::memory_order_relaxed);
+  }
+
+  ~PhaseScope()
+  {
+    if (T)
+      T->stopTimer();
+    if (CS->Stats)
+      CS->Stats->countAllocations(Description, TheHeapCounters.Allocations.load(std::memory_order_relaxed) - Allocations,
+                                  TheHeapCounters.Allocated.load(std::memory_order_relaxed) - Bytes);
+  }
+};
+
+// traces the thread it is created on for its lifetime, if Enabled
+class ThreadTrace
+{
+  bool Enabled;
+
+public:
+  ThreadTrace(bool Enabled) : Enabled(Enabled)
+  {
+    if (Enabled)
+      timeTraceProfilerInitialize(CS->Opts.TimeTraceGranularity, "mccomp");
+  }
+
+  ~ThreadTrace()
+  {
+    if (Enabled)
+      timeTraceProfilerFinishThread();
+  }
+};
+
+#endif
@@ -1,13 +1,15 @@
 #ifndef TOKEN_HPP
 #define TOKEN_HPP
 
+#include <atomic>
+#include <chrono>
 #include <cstdio>
 #include <cstdlib>
 #include <queue>
 #include <iostream>
+#include <stdexcept>
 #include <string>
-
-FILE *pFile;
+#include <thread>
 
 //===----------------------------------------------------------------------===//
 // Lexer
@@ -27,6 +29,7 @@ enum TOKEN_TYPE
   RPAR = int(')'),  // right parenthesis
   SC = int(';'),    // semicolon
   COMMA = int(','), // comma
+  HASH = int('#'),  // starts a #pragma
 
   // types
   INT_TOK = -2,   // "int"
@@ -68,6 +71,11 @@ enum TOKEN_TYPE
   GE = -23,      // greater than or equal to
   GT = int('>'), // greater than
 
+  // attributes
+  ATTR_OPEN = -24,  // "[["
+  ATTR_CLOSE = -25, // "]]"
+  STRING_LIT = -26, // "[^"\n]*", only the arguments of attributes
+
   // special tokens
   EOF_TOK = 0, // signal end of file
 
@@ -84,20 +92,17 @@ struct TOKEN
   int columnNo;
 };
 
-static std::string IdentifierStr; // Filled in if IDENT
-static int IntVal;                // Filled in if INT_LIT
-static bool BoolVal;              // Filled in if BOOL_LIT
-static float FloatVal;            // Filled in if FLOAT_LIT
-static std::string StringVal;     // Filled in if String Literal
-static int lineNo, columnNo;
+// per-compilation state, needs TOKEN
+#include "compiler.hpp"
 
 static TOKEN returnTok(std::string lexVal, int tok_type)
 {
+  CS->TokensLexed++;
   TOKEN return_tok;
   return_tok.lexeme = lexVal;
   return_tok.type = tok_type;
-  return_tok.lineNo = lineNo;
-  return_tok.columnNo = columnNo - lexVal.length() - 1;
+  return_tok.lineNo = CS->lineNo;
+  return_tok.columnNo = CS->columnNo - lexVal.length() - 1;
   return return_tok;
 }
 
@@ -107,265 +112,311 @@ static TOKEN returnTok(std::string lexVal, int tok_type)
 static TOKEN gettok()
 {
 
-  static int LastChar = ' ';
-  static int NextChar = ' ';
-
   // Skip any whitespace.
-  while (isspace(LastChar))
+  while (isspace(CS->LastChar))
   {
-    if (LastChar == '\n' || LastChar == '\r')
+    if (CS->LastChar == '\n' || CS->LastChar == '\r')
     {
-      lineNo++;
-      columnNo = 1;
+      CS->lineNo++;
+      CS->columnNo = 1;
     }
-    LastChar = getc(pFile);
-    columnNo++;
+    CS->LastChar = getc(CS->pFile);
+    CS->columnNo++;
   }
 
-  if (isalpha(LastChar) ||
-      (LastChar == '_'))
+  if (isalpha(CS->LastChar) ||
+      (CS->LastChar == '_'))
   { // identifier: [a-zA-Z_][a-zA-Z_0-9]*
-    IdentifierStr = LastChar;
-    columnNo++;
+    CS->IdentifierStr = CS->LastChar;
+    CS->columnNo++;
 
-    while (isalnum((LastChar = getc(pFile))) || (LastChar == '_'))
+    while (isalnum((CS->LastChar = getc(CS->pFile))) || (CS->LastChar == '_'))
     {
-      IdentifierStr += LastChar;
-      columnNo++;
+      CS->IdentifierStr += CS->LastChar;
+      CS->columnNo++;
     }
 
-    if (IdentifierStr == "int")
+    if (CS->IdentifierStr == "int")
       return returnTok("int", INT_TOK);
-    if (IdentifierStr == "bool")
+    if (CS->IdentifierStr == "bool")
       return returnTok("bool", BOOL_TOK);
-    if (IdentifierStr == "float")
+    if (CS->IdentifierStr == "float")
       return returnTok("float", FLOAT_TOK);
-    if (IdentifierStr == "void")
+    if (CS->IdentifierStr == "void")
       return returnTok("void", VOID_TOK);
-    if (IdentifierStr == "bool")
+    if (CS->IdentifierStr == "bool")
       return returnTok("bool", BOOL_TOK);
-    if (IdentifierStr == "extern")
+    if (CS->IdentifierStr == "extern")
       return returnTok("extern", EXTERN);
-    if (IdentifierStr == "if")
+    if (CS->IdentifierStr == "if")
       return returnTok("if", IF);
-    if (IdentifierStr == "else")
+    if (CS->IdentifierStr == "else")
       return returnTok("else", ELSE);
-    if (IdentifierStr == "while")
+    if (CS->IdentifierStr == "while")
       return returnTok("while", WHILE);
-    if (IdentifierStr == "return")
+    if (CS->IdentifierStr == "return")
       return returnTok("return", RETURN);
-    if (IdentifierStr == "true")
+    if (CS->IdentifierStr == "true")
     {
-      BoolVal = true;
+      CS->BoolVal = true;
       return returnTok("true", BOOL_LIT);
     }
-    if (IdentifierStr == "false")
+    if (CS->IdentifierStr == "false")
     {
-      BoolVal = false;
+      CS->BoolVal = false;
       return returnTok("false", BOOL_LIT);
     }
 
-    return returnTok(IdentifierStr.c_str(), IDENT);
+    return returnTok(CS->IdentifierStr.c_str(), IDENT);
   }
 
-  if (LastChar == '=')
+  if (CS->LastChar == '=')
   {
-    NextChar = getc(pFile);
-    if (NextChar == '=')
+    CS->NextChar = getc(CS->pFile);
+    if (CS->NextChar == '=')
     { // EQ: ==
-      LastChar = getc(pFile);
-      columnNo += 2;
+      CS->LastChar = getc(CS->pFile);
+      CS->columnNo += 2;
       return returnTok("==", EQ);
     }
     else
     {
-      LastChar = NextChar;
-      columnNo++;
+      CS->LastChar = CS->NextChar;
+      CS->columnNo++;
       return returnTok("=", ASSIGN);
     }
   }
 
-  if (LastChar == '{')
+  if (CS->LastChar == '{')
   {
-    LastChar = getc(pFile);
-    columnNo++;
+    CS->LastChar = getc(CS->pFile);
+    CS->columnNo++;
     return returnTok("{", LBRA);
   }
-  if (LastChar == '}')
+  if (CS->LastChar == '}')
   {
-    LastChar = getc(pFile);
-    columnNo++;
+    CS->LastChar = getc(CS->pFile);
+    CS->columnNo++;
     return returnTok("}", RBRA);
   }
-  if (LastChar == '(')
+  if (CS->LastChar == '(')
   {
-    LastChar = getc(pFile);
-    columnNo++;
+    CS->LastChar = getc(CS->pFile);
+    CS->columnNo++;
     return returnTok("(", LPAR);
   }
-  if (LastChar == ')')
+  if (CS->LastChar == ')')
   {
-    LastChar = getc(pFile);
-    columnNo++;
+    CS->LastChar = getc(CS->pFile);
+    CS->columnNo++;
     return returnTok(")", RPAR);
   }
-  if (LastChar == ';')
+  if (CS->LastChar == ';')
   {
-    LastChar = getc(pFile);
-    columnNo++;
+    CS->LastChar = getc(CS->pFile);
+    CS->columnNo++;
     return returnTok(";", SC);
   }
-  if (LastChar == ',')
+  if (CS->LastChar == ',')
   {
-    LastChar = getc(pFile);
-    columnNo++;
+    CS->LastChar = getc(CS->pFile);
+    CS->columnNo++;
     return returnTok(",", COMMA);
   }
 
-  if (isdigit(LastChar) || LastChar == '.')
+  if (isdigit(CS->LastChar) || CS->LastChar == '.')
   { // Number: [0-9]+.
     std::string NumStr;
 
-    if (LastChar == '.')
+    if (CS->LastChar == '.')
     { // Floatingpoint Number: .[0-9]+
       do
       {
-        NumStr += LastChar;
-        LastChar = getc(pFile);
-        columnNo++;
-      } while (isdigit(LastChar));
+        NumStr += CS->LastChar;
+        CS->LastChar = getc(CS->pFile);
+        CS->columnNo++;
+      } while (isdigit(CS->LastChar));
 
-      FloatVal = strtof(NumStr.c_str(), nullptr);
+      CS->FloatVal = strtof(NumStr.c_str(), nullptr);
       return returnTok(NumStr, FLOAT_LIT);
     }
     else
     {
       do
       { // Start of Number: [0-9]+
-        NumStr += LastChar;
-        LastChar = getc(pFile);
-        columnNo++;
-      } while (isdigit(LastChar));
+        NumStr += CS->LastChar;
+        CS->LastChar = getc(CS->pFile);
+        CS->columnNo++;
+      } while (isdigit(CS->LastChar));
 
-      if (LastChar == '.')
+      if (CS->LastChar == '.')
       { // Floatingpoint Number: [0-9]+.[0-9]+)
         do
         {
-          NumStr += LastChar;
-          LastChar = getc(pFile);
-          columnNo++;
-        } while (isdigit(LastChar));
+          NumStr += CS->LastChar;
+          CS->LastChar = getc(CS->pFile);
+          CS->columnNo++;
+        } while (isdigit(CS->LastChar));
 
-        FloatVal = strtof(NumStr.c_str(), nullptr);
+        CS->FloatVal = strtof(NumStr.c_str(), nullptr);
         return returnTok(NumStr, FLOAT_LIT);
       }
       else
       { // Integer : [0-9]+
-        IntVal = strtod(NumStr.c_str(), nullptr);
+        CS->IntVal = strtod(NumStr.c_str(), nullptr);
         return returnTok(NumStr, INT_LIT);
       }
     }
   }
 
-  if (LastChar == '&')
+  if (CS->LastChar == '&')
   {
-    NextChar = getc(pFile);
-    if (NextChar == '&')
+    CS->NextChar = getc(CS->pFile);
+    if (CS->NextChar == '&')
     { // AND: &&
-      LastChar = getc(pFile);
-      columnNo += 2;
+      CS->LastChar = getc(CS->pFile);
+      CS->columnNo += 2;
       return returnTok("&&", AND);
     }
     else
     {
-      LastChar = NextChar;
-      columnNo++;
+      CS->LastChar = CS->NextChar;
+      CS->columnNo++;
       return returnTok("&", int('&'));
     }
   }
 
-  if (LastChar == '|')
+  if (CS->LastChar == '|')
   {
-    NextChar = getc(pFile);
-    if (NextChar == '|')
+    CS->NextChar = getc(CS->pFile);
+    if (CS->NextChar == '|')
     { // OR: ||
-      LastChar = getc(pFile);
-      columnNo += 2;
+      CS->LastChar = getc(CS->pFile);
+      CS->columnNo += 2;
       return returnTok("||", OR);
     }
     else
     {
-      LastChar = NextChar;
-      columnNo++;
+      CS->LastChar = CS->NextChar;
+      CS->columnNo++;
       return returnTok("|", int('|'));
     }
   }
 
-  if (LastChar == '!')
+  if (CS->LastChar == '!')
   {
-    NextChar = getc(pFile);
-    if (NextChar == '=')
+    CS->NextChar = getc(CS->pFile);
+    if (CS->NextChar == '=')
     { // NE: !=
-      LastChar = getc(pFile);
-      columnNo += 2;
+      CS->LastChar = getc(CS->pFile);
+      CS->columnNo += 2;
       return returnTok("!=", NE);
     }
     else
     {
-      LastChar = NextChar;
-      columnNo++;
+      CS->LastChar = CS->NextChar;
+      CS->columnNo++;
       return returnTok("!", NOT);
       ;
     }
   }
 
-  if (LastChar == '<')
+  if (CS->LastChar == '<')
   {
-    NextChar = getc(pFile);
-    if (NextChar == '=')
+    CS->NextChar = getc(CS->pFile);
+    if (CS->NextChar == '=')
     { // LE: <=
-      LastChar = getc(pFile);
-      columnNo += 2;
+      CS->LastChar = getc(CS->pFile);
+      CS->columnNo += 2;
       return returnTok("<=", LE);
     }
     else
     {
-      LastChar = NextChar;
-      columnNo++;
+      CS->LastChar = CS->NextChar;
+      CS->columnNo++;
       return returnTok("<", LT);
     }
   }
 
-  if (LastChar == '>')
+  if (CS->LastChar == '>')
   {
-    NextChar = getc(pFile);
-    if (NextChar == '=')
+    CS->NextChar = getc(CS->pFile);
+    if (CS->NextChar == '=')
     { // GE: >=
-      LastChar = getc(pFile);
-      columnNo += 2;
+      CS->LastChar = getc(CS->pFile);
+      CS->columnNo += 2;
       return returnTok(">=", GE);
     }
     else
     {
-      LastChar = NextChar;
-      columnNo++;
+      CS->LastChar = CS->NextChar;
+      CS->columnNo++;
       return returnTok(">", GT);
     }
   }
 
-  if (LastChar == '/')
+  if (CS->LastChar == '[')
+  {
+    CS->NextChar = getc(CS->pFile);
+    if (CS->NextChar == '[')
+    { // ATTR_OPEN: [[
+      CS->LastChar = getc(CS->pFile);
+      CS->columnNo += 2;
+      return returnTok("[[", ATTR_OPEN);
+    }
+    else
+    {
+      CS->LastChar = CS->NextChar;
+      CS->columnNo++;
+      return returnTok("[", int('['));
+    }
+  }
+
+  if (CS->LastChar == ']')
+  {
+    CS->NextChar = getc(CS->pFile);
+    if (CS->NextChar == ']')
+    { // ATTR_CLOSE: ]]
+      CS->LastChar = getc(CS->pFile);
+      CS->columnNo += 2;
+      return returnTok("]]", ATTR_CLOSE);
+    }
+    else
+    {
+      CS->LastChar = CS->NextChar;
+      CS->columnNo++;
+      return returnTok("]", int(']'));
+    }
+  }
+
+  if (CS->LastChar == '"')
+  { // STRING_LIT: "[^"\n]*", the lexeme is what is between the quotes
+    std::string Str;
+    CS->columnNo++;
+    while ((CS->LastChar = getc(CS->pFile)) != '"' && CS->LastChar != '\n' && CS->LastChar != EOF)
+    {
+      Str += CS->LastChar;
+      CS->columnNo++;
+    }
+    if (CS->LastChar != '"')
+      return returnTok("\"" + Str, INVALID); // unterminated, the parser reports it
+    CS->LastChar = getc(CS->pFile);
+    return returnTok(Str, STRING_LIT);
+  }
+
+  if (CS->LastChar == '/')
   { // could be division or could be the start of a comment
-    LastChar = getc(pFile);
-    columnNo++;
-    if (LastChar == '/')
+    CS->LastChar = getc(CS->pFile);
+    CS->columnNo++;
+    if (CS->LastChar == '/')
     { // definitely a comment
       do
       {
-        LastChar = getc(pFile);
-        columnNo++;
-      } while (LastChar != EOF && LastChar != '\n' && LastChar != '\r');
+        CS->LastChar = getc(CS->pFile);
+        CS->columnNo++;
+      } while (CS->LastChar != EOF && CS->LastChar != '\n' && CS->LastChar != '\r');
 
-      if (LastChar != EOF)
+      if (CS->LastChar != EOF)
         return gettok();
     }
     else
@@ -373,17 +424,17 @@ static TOKEN gettok()
   }
 
   // Check for end of file.  Don't eat the EOF.
-  if (LastChar == EOF)
+  if (CS->LastChar == EOF)
   {
-    columnNo++;
+    CS->columnNo++;
     return returnTok("0", EOF_TOK);
   }
 
   // Otherwise, just return the character as its ascii value.
-  int ThisChar = LastChar;
+  int ThisChar = CS->LastChar;
   std::string s(1, ThisChar);
-  LastChar = getc(pFile);
-  columnNo++;
+  CS->LastChar = getc(CS->pFile);
+  CS->columnNo++;
   return returnTok(s, int(ThisChar));
 }
 
@@ -394,22 +445,150 @@ static TOKEN gettok()
 /// CurTok/getNextToken - Provide a simple token buffer.  CurTok is the current
 /// token the parser is looking at.  getNextToken reads another token from the
 /// lexer and updates CurTok with its results.
-static TOKEN CurTok;
-static std::deque<TOKEN> tok_buffer;
+
+/// Token recording - when enabled every token produced by the lexer is
+/// appended to RecordedTokens so a top-level declaration can be identified by
+/// the exact token range it was parsed from (used by incremental compilation).
+/// Each token's line and column are recorded too, since the code generated for
+/// a declaration carries them in its debug info and warnings. Lines are
+/// recorded relative to the first line of the range, so a declaration that only
+/// moves up or down the file records the same range.
+/// Tokens put back into tok_buffer are only recorded once, when first lexed.
+
+static void recordToken(const TOKEN &tok)
+{
+  CS->LastTokenOffset = CS->RecordedTokens.size();
+  CS->LastRecordedToken = tok;
+  CS->RecordedTokens += std::to_string(tok.type) + ":" + std::to_string(tok.lineNo - CS->RecordedFromLine) + ":" +
+                        std::to_string(tok.columnNo) + ":" + tok.lexeme + "\x1f";
+}
+
+// start the recorded range at the most recently lexed token, dropping
+// everything recorded before it
+static void resetRecordedTokens()
+{
+  CS->RecordedTokens.clear();
+  CS->LastTokenOffset = 0;
+  CS->RecordedFromLine = CS->LastRecordedToken.lineNo;
+  recordToken(CS->LastRecordedToken);
+}
+
+/// TokenRing - lock-free single-producer/single-consumer ring the lexer thread
+/// fills when compiling with --pipeline. getNextToken() takes tokens from it
+/// instead of calling gettok() while CS->Tokens is set. Each side records how
+/// long it spent waiting on the other, in seconds.
+class TokenRing
+{
+  static const size_t Size = 1024; // power of two
+  TOKEN Slots[Size];
+  TOKEN EofTok;
+  alignas(64) std::atomic<size_t> Head{0}; // next slot to read, advanced by the consumer
+  alignas(64) std::atomic<size_t> Tail{0}; // next slot to write, advanced by the producer
+  std::atomic<bool> Closed{false}, Cancelled{false};
+
+  static double since(std::chrono::steady_clock::time_point start)
+  {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+
+public:
+  double PushWait = 0, PopWait = 0;
+
+  // returns false once the consumer has given up
+  bool push(TOKEN tok)
+  {
+    size_t tail = Tail.load(std::memory_order_relaxed);
+    if (tail - Head.load(std::memory_order_acquire) == Size)
+    {
+      auto start = std::chrono::steady_clock::now();
+      while (tail - Head.load(std::memory_order_acquire) == Size)
+      {
+        if (Cancelled.load(std::memory_order_relaxed))
+          return false;
+        std::this_thread::yield();
+      }
+      PushWait += since(start);
+    }
+    if (tok.type == EOF_TOK)
+      EofTok = tok;
+    Slots[tail & (Size - 1)] = std::move(tok);
+    Tail.store(tail + 1, std::memory_order_release);
+    return !Cancelled.load(std::memory_order_relaxed);
+  }
+
+  // repeats the EOF token once the producer is done, as gettok() does
+  TOKEN pop()
+  {
+    size_t head = Head.load(std::memory_order_relaxed);
+    if (Tail.load(std::memory_order_acquire) == head)
+    {
+      auto start = std::chrono::steady_clock::now();
+      while (Tail.load(std::memory_order_acquire) == head)
+      {
+        if (Closed.load(std::memory_order_acquire) && Tail.load(std::memory_order_acquire) == head)
+        {
+          PopWait += since(start);
+          return EofTok;
+        }
+        if (Cancelled.load(std::memory_order_relaxed))
+        {
+          TOKEN tok;
+          tok.type = EOF_TOK;
+          return tok;
+        }
+        std::this_thread::yield();
+      }
+      PopWait += since(start);
+    }
+    TOKEN tok = std::move(Slots[head & (Size - 1)]);
+    Head.store(head + 1, std::memory_order_release);
+    return tok;
+  }
+
+  // producer: no more tokens will be pushed
+  void close() { Closed.store(true, std::memory_order_release); }
+
+  // stop both sides, push() fails and pop() returns EOF once the ring is empty
+  void cancel() { Cancelled.store(true); }
+};
 
 static TOKEN getNextToken()
 {
 
-  if (tok_buffer.size() == 0)
-    tok_buffer.push_back(gettok());
+  if (CS->tok_buffer.size() == 0)
+  {
+    if (CS->Tokens)
+      CS->tok_buffer.push_back(CS->Tokens->pop());
+    else if (!CS->Lexed.empty())
+    {
+      CS->tok_buffer.push_back(std::move(CS->Lexed.front()));
+      CS->Lexed.pop_front();
+    }
+    else
+      CS->tok_buffer.push_back(gettok());
+    if (CS->RecordTokens)
+      recordToken(CS->tok_buffer.back());
+  }
 
-  TOKEN temp = tok_buffer.front();
-  tok_buffer.pop_front();
+  TOKEN temp = CS->tok_buffer.front();
+  CS->tok_buffer.pop_front();
 
-  return CurTok = temp;
+  return CS->CurTok = temp;
 }
 
-static void putBackToken(TOKEN tok) { tok_buffer.push_front(tok); }
+// lex the rest of the input up front, getNextToken() then hands the tokens out
+// in order. Only used to time lexing apart from parsing, see timing.hpp
+static void lexAll()
+{
+  TOKEN tok;
+  do
+  {
+    tok = gettok();
+    CS->Lexed.push_back(tok);
+  } while (tok.type != EOF_TOK);
+}
+
+static void putBackToken(TOKEN tok) { CS->tok_buffer.push_front(tok); }
 
 static TOKEN peekNextToken()
 {
@@ -418,37 +597,71 @@ static TOKEN peekNextToken()
   return tok;
 }
 
+// start lexing a new input from the beginning
+static void resetLexer()
+{
+  CS->LastChar = ' ';
+  CS->NextChar = ' ';
+  CS->lineNo = 1;
+  CS->columnNo = 1;
+  CS->CurTok = TOKEN();
+  CS->tok_buffer.clear();
+  CS->RecordedTokens.clear();
+  CS->LastTokenOffset = 0;
+  CS->LastRecordedToken = TOKEN();
+  CS->RecordedFromLine = 0;
+}
+
 //===----------------------------------------------------------------------===//
 // Error handling
 //===----------------------------------------------------------------------===//
-static std::vector<std::string> warnings;
+
+// thrown by error(), abandons compilation of the current input
+// what() is the formatted message to print
+class CompileError : public std::runtime_error
+{
+public:
+  CompileError(std::string message) : std::runtime_error(message) {}
+};
 
 static void error(TOKEN tok, std::string Str)
 {
-  fprintf(stderr, "\033[31mError in `%s` at line %d column %d\n", tok.lexeme.c_str(), tok.lineNo, tok.columnNo);
-  fprintf(stderr, "\033[31mError message: %s\n", Str.c_str());
-  exit(1);
+  std::string errorMessage = "\033[31mError in `" + tok.lexeme + "` at line " + std::to_string(tok.lineNo) + " column " + std::to_string(tok.columnNo) + "\n";
+  errorMessage += "\033[31mError message: " + Str + "\n";
+  throw CompileError(errorMessage);
 }
 
 static void error(std::string Str)
 {
-  fprintf(stderr, "Error: %s\n", Str.c_str());
-  exit(1);
+  throw CompileError("Error: " + Str + "\n");
 }
 
-static void addWarning(TOKEN tok, std::string Str)
+// warnings the current thread gives are dropped while one exists, for code
+// that is generated a second time from the same source. Per thread, as the
+// parser keeps giving warnings while codegen is quiet with --pipeline
+static thread_local unsigned QuietWarningScopes = 0;
+
+class QuietWarnings
 {
-  std::string warningMessage = "\033[33mWarning in `" + tok.lexeme + "` at line " + std::to_string(tok.lineNo) + " column " + std::to_string(tok.columnNo) + "\n";
-  warningMessage += "\033[33mWarning message: " + Str + "\n";
-  warnings.push_back(warningMessage);
+public:
+  QuietWarnings() { QuietWarningScopes++; }
+  ~QuietWarnings() { QuietWarningScopes--; }
+};
+
+// a warning or remark, from any of the --pipeline threads
+static void addWarningText(std::string Text)
+{
+  if (QuietWarningScopes)
+    return;
+  std::lock_guard<std::mutex> L(CS->WarningsLock);
+  CS->warnings.push_back(std::move(Text));
 }
 
-static void printWarnings()
+static void addWarning(TOKEN tok, std::string Str)
 {
-  for (auto warning : warnings)
-  {
-    std::cout << warning + "\n\n";
-  }
+  std::string warningMessage = "\033[33mWarning in `" + tok.lexeme + "` at line " + std::to_string(tok.lineNo) + " column " + std::to_string(tok.columnNo) + "\n";
+  warningMessage += "\033[33mWarning message: " + Str + "\n";
+  addWarningText(warningMessage);
 }
 
 #endif
\ No newline at end of file